@@ -0,0 +1,112 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+
+#include "mtproto/mtp_trace_format.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// Prints the binary MTP trace, written with the "-trace" launch argument
+// or the "tdata/withtrace" file, as text with one record on each line.
+//
+// Usage: trace_decoder <path to DebugLogs/trace.bin>
+
+namespace {
+
+using namespace MTP::Trace;
+
+const char *EventName(Event event) {
+	switch (event) {
+	case Event::Send: return "send";
+	case Event::Receive: return "recv";
+	case Event::TcpWrite: return "tcp-write";
+	case Event::TcpRead: return "tcp-read";
+	case Event::HttpWrite: return "http-write";
+	case Event::HttpRead: return "http-read";
+	case Event::Restart: return "restart";
+	}
+	return "unknown";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	QCoreApplication app(argc, argv);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+
+	const auto args = app.arguments();
+	if (args.size() != 2) {
+		err << "Usage: trace_decoder <trace file>\n";
+		return -1;
+	}
+	QFile file(args[1]);
+	if (!file.open(QIODevice::ReadOnly)) {
+		err << "Could not open '" << args[1] << "'.\n";
+		return -1;
+	}
+	const auto data = file.readAll();
+
+	auto header = Header();
+	if (data.size() < int(sizeof(Header))) {
+		err << "Bad trace file size.\n";
+		return -1;
+	}
+	memcpy(&header, data.constData(), sizeof(Header));
+	if (header.magic != kMagic || header.version != kVersion) {
+		err << "Bad trace file header.\n";
+		return -1;
+	} else if (header.recordSize != sizeof(Record)
+		|| data.size() < int(sizeof(Header))
+			+ qint64(header.recordSize) * header.capacity) {
+		err << "Bad trace file records.\n";
+		return -1;
+	}
+
+	auto records = std::vector<Record>();
+	records.reserve(header.capacity);
+	const auto from = data.constData() + sizeof(Header);
+	for (auto i = uint32_t(0); i != header.capacity; ++i) {
+		auto record = Record();
+		memcpy(&record, from + i * sizeof(Record), sizeof(Record));
+		if (record.sequence != 0) {
+			records.push_back(record);
+		}
+	}
+	std::sort(begin(records), end(records), [](
+			const Record &a,
+			const Record &b) {
+		return a.sequence < b.sequence;
+	});
+
+	const auto start = QDateTime::fromMSecsSinceEpoch(header.startTime);
+	out << "Trace started at " << start.toString(Qt::ISODate)
+		<< ", " << records.size() << " records.\n";
+	for (const auto &record : records) {
+		const auto time = start.addMSecs(record.time);
+		out << record.sequence
+			<< ' ' << time.toString("hh:mm:ss.zzz")
+			<< " dc:" << record.dcId
+			<< ' ' << EventName(record.event);
+		if (record.msgId) {
+			out << " msg_id:" << record.msgId;
+		}
+		if (record.typeId) {
+			out << " type:0x"
+				<< QString::number(record.typeId, 16).rightJustified(8, '0');
+		}
+		out << " size:" << record.size << '\n';
+	}
+	return 0;
+}
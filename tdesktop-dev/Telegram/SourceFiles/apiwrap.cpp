@@ -4329,6 +4329,9 @@ void ApiWrap::sendFiles(
 			default: Unexpected("AlbumType in uploadFilesAfterConfirmation");
 			}
 		}
+		if (file.informationIsScaled) {
+			file.information = nullptr;
+		}
 		tasks.push_back(std::make_unique<FileLoadTask>(
 			file.path,
 			file.content,
@@ -909,6 +909,7 @@ public:
 	AlbumPreview(
 		QWidget *parent,
 		const Storage::PreparedList &list,
+		int count,
 		SendFilesWay way);
 
 	void setSendWay(SendFilesWay way);
@@ -944,6 +945,7 @@ private:
 	void finishDrag();
 
 	const Storage::PreparedList &_list;
+	int _count = 0;
 	SendFilesWay _sendWay = SendFilesWay::Files;
 	style::cursor _cursor = style::cur_default;
 	std::vector<int> _order;
@@ -966,9 +968,11 @@ private:
 SendFilesBox::AlbumPreview::AlbumPreview(
 	QWidget *parent,
 	const Storage::PreparedList &list,
+	int count,
 	SendFilesWay way)
 : RpWidget(parent)
 , _list(list)
+, _count(count)
 , _sendWay(way) {
 	setMouseTracking(true);
 	prepareThumbs();
@@ -1012,14 +1016,13 @@ auto SendFilesBox::AlbumPreview::generateOrderedLayout() const
 }
 
 std::vector<int> SendFilesBox::AlbumPreview::defaultOrder() const {
-	const auto count = int(_list.files.size());
-	return ranges::view::ints(0, count) | ranges::to_vector;
+	return ranges::view::ints(0, _count) | ranges::to_vector;
 }
 
 void SendFilesBox::AlbumPreview::prepareThumbs() {
 	_order = defaultOrder();
 
-	const auto count = int(_list.files.size());
+	const auto count = _count;
 	const auto layout = generateOrderedLayout();
 	_thumbs.reserve(count);
 	for (auto i = 0; i != count; ++i) {
@@ -1383,7 +1386,7 @@ void SendFilesBox::prepareSingleFilePreview() {
 	}
 }
 
-void SendFilesBox::prepareAlbumPreview() {
+void SendFilesBox::prepareAlbumPreview(int count) {
 	Expects(_sendWay != nullptr);
 
 	const auto wrap = Ui::CreateChild<Ui::ScrollArea>(
@@ -1392,6 +1395,7 @@ void SendFilesBox::prepareAlbumPreview() {
 	_albumPreview = wrap->setOwnedWidget(object_ptr<AlbumPreview>(
 		this,
 		_list,
+		count,
 		_sendWay->value()));
 	_preview = wrap;
 	_albumPreview->show();
@@ -1434,6 +1438,7 @@ void SendFilesBox::prepare() {
 	_send = addButton(langFactory(lng_send_button), [this] { send(); });
 	addButton(langFactory(lng_cancel), [this] { closeBox(); });
 	setupCaption();
+	startPreparing();
 	initSendWay();
 	preparePreview();
 	boxClosing() | rpl::start_with_next([=] {
@@ -1490,11 +1495,13 @@ void SendFilesBox::refreshAlbumMediaCount() {
 }
 
 void SendFilesBox::preparePreview() {
-	if (_list.files.size() == 1) {
+	if (!_preparing.empty()) {
+		preparePartialPreview();
+	} else if (_list.files.size() == 1) {
 		prepareSingleFilePreview();
 	} else {
 		if (_list.albumIsPossible) {
-			prepareAlbumPreview();
+			prepareAlbumPreview(_list.files.size());
 		} else {
 			auto desiredPreviewHeight = rpl::single(0);
 			initPreview(std::move(desiredPreviewHeight));
@@ -1502,6 +1509,78 @@ void SendFilesBox::preparePreview() {
 	}
 }
 
+// While the files are being prepared the ones that are ready from the
+// beginning of the list are shown without the reordering.
+void SendFilesBox::preparePartialPreview() {
+	Expects(!_preparing.empty());
+
+	const auto ready = _preparing.front();
+	const auto album = (ready > 0) && std::none_of(
+		begin(_list.files),
+		begin(_list.files) + ready,
+		[](const Storage::PreparedFile &file) {
+			return (file.type == Storage::PreparedFile::AlbumType::None);
+		});
+	if (album) {
+		prepareAlbumPreview(ready);
+		_albumPreview->setAttribute(Qt::WA_TransparentForMouseEvents);
+	} else {
+		auto desiredPreviewHeight = rpl::single(0);
+		initPreview(std::move(desiredPreviewHeight));
+	}
+}
+
+void SendFilesBox::refreshPreview() {
+	delete base::take(_preview);
+	_albumPreview = nullptr;
+
+	preparePreview();
+	updateControlsGeometry();
+	update();
+}
+
+void SendFilesBox::startPreparing() {
+	const auto count = int(_list.files.size());
+	_preparing.clear();
+	for (auto i = 0; i != count; ++i) {
+		_preparing.insert(i);
+	}
+
+	auto [left, right] = base::make_binary_guard();
+	_preparingGuard = std::move(left);
+	Storage::PrepareMediaInBackground(
+		_list,
+		st::sendMediaPreviewSize,
+		std::move(right),
+		[=](int index, Storage::PreparedFile &&file) {
+			filePrepared(index, std::move(file));
+		});
+}
+
+void SendFilesBox::filePrepared(
+		int index,
+		Storage::PreparedFile &&file) {
+	_list.files[index] = std::move(file);
+	_preparing.erase(index);
+	if (_preparing.empty()) {
+		finishPreparing();
+	} else {
+		refreshPreview();
+	}
+}
+
+void SendFilesBox::finishPreparing() {
+	_list.refreshAlbumIsPossible();
+	if (_list.files.size() > 1
+		&& !_list.allFilesForCompress
+		&& !_list.albumIsPossible) {
+		_compressConfirmInitial = CompressConfirm::None;
+	}
+	_compressConfirm = _compressConfirmInitial;
+	initSendWay();
+	refreshPreview();
+}
+
 void SendFilesBox::setupControls() {
 	setupTitleText();
 	setupSendWayControls();
@@ -1512,7 +1591,7 @@ void SendFilesBox::setupSendWayControls() {
 	_sendAlbum.destroy();
 	_sendPhotos.destroy();
 	_sendFiles.destroy();
-	if (_compressConfirm == CompressConfirm::None) {
+	if (_compressConfirm == CompressConfirm::None || !_preparing.empty()) {
 		return;
 	}
 	const auto addRadio = [&](
@@ -1666,7 +1745,9 @@ bool SendFilesBox::canAddFiles(not_null<const QMimeData*> data) const {
 		++filesCount;
 	}
 
-	if (_list.files.size() + filesCount > Storage::MaxAlbumItems()) {
+	if (!_preparing.empty() || _addingLeft > 0) {
+		return false;
+	} else if (_list.files.size() + filesCount > Storage::MaxAlbumItems()) {
 		return false;
 	} else if (_list.files.size() > 1 && !_albumPreview) {
 		return false;
@@ -1678,10 +1759,13 @@ bool SendFilesBox::canAddFiles(not_null<const QMimeData*> data) const {
 }
 
 bool SendFilesBox::addFiles(not_null<const QMimeData*> data) {
+	if (!_preparing.empty() || _addingLeft > 0) {
+		return false;
+	}
 	auto list = [&] {
 		const auto urls = data->hasUrls() ? data->urls() : QList<QUrl>();
 		auto result = canAddUrls(urls)
-			? Storage::PrepareMediaList(urls, st::sendMediaPreviewSize)
+			? Storage::PrepareMediaList(urls)
 			: Storage::PreparedList(
 				Storage::PreparedList::Error::EmptyFile,
 				QString());
@@ -1692,8 +1776,7 @@ bool SendFilesBox::addFiles(not_null<const QMimeData*> data) {
 			if (!image.isNull()) {
 				return Storage::PrepareMediaFromImage(
 					std::move(image),
-					QByteArray(),
-					st::sendMediaPreviewSize);
+					QByteArray());
 			}
 		}
 		return result;
@@ -1704,15 +1787,47 @@ bool SendFilesBox::addFiles(not_null<const QMimeData*> data) {
 		return false;
 	} else if (list.files.size() != 1 && !list.albumIsPossible) {
 		return false;
-	} else if (list.files.front().type
-		== Storage::PreparedFile::AlbumType::None) {
-		return false;
 	} else if (_list.files.size() > 1 && !_albumPreview) {
 		return false;
 	} else if (_list.files.front().type
 		== Storage::PreparedFile::AlbumType::None) {
 		return false;
 	}
+	_adding = std::move(list);
+	_addingLeft = int(_adding.files.size());
+
+	auto [left, right] = base::make_binary_guard();
+	_addingGuard = std::move(left);
+	Storage::PrepareMediaInBackground(
+		_adding,
+		st::sendMediaPreviewSize,
+		std::move(right),
+		[=](int index, Storage::PreparedFile &&file) {
+			addedFilePrepared(index, std::move(file));
+		});
+	return true;
+}
+
+void SendFilesBox::addedFilePrepared(
+		int index,
+		Storage::PreparedFile &&file) {
+	_adding.files[index] = std::move(file);
+	if (!--_addingLeft) {
+		finishAdding();
+	}
+}
+
+// The added files are checked only when they are read, so the ones that
+// can't be grouped with the current files are dropped at that point.
+void SendFilesBox::finishAdding() {
+	auto list = base::take(_adding);
+	list.refreshAlbumIsPossible();
+	if (list.files.size() != 1 && !list.albumIsPossible) {
+		return;
+	} else if (list.files.front().type
+		== Storage::PreparedFile::AlbumType::None) {
+		return;
+	}
 	applyAlbumOrder();
 	delete base::take(_preview);
 	_albumPreview = nullptr;
@@ -1727,11 +1842,19 @@ bool SendFilesBox::addFiles(not_null<const QMimeData*> data) {
 	refreshAlbumMediaCount();
 	preparePreview();
 	updateControlsGeometry();
-	return true;
 }
 
 void SendFilesBox::setupTitleText() {
-	if (_list.files.size() > 1) {
+	if (!_preparing.empty()) {
+		const auto count = int(_list.files.size());
+		const auto ready = count - int(_preparing.size());
+		_titleText = lng_send_files_preparing(
+			lt_ready,
+			QString::number(ready),
+			lt_total,
+			QString::number(count));
+		_titleHeight = st::boxTitleHeight;
+	} else if (_list.files.size() > 1) {
 		const auto onlyImages = (_compressConfirm != CompressConfirm::None)
 			&& (_albumVideosCount == 0);
 		_titleText = onlyImages
@@ -1839,6 +1962,10 @@ void SendFilesBox::setInnerFocus() {
 }
 
 void SendFilesBox::send(bool ctrlShiftEnter) {
+	if (!_preparing.empty()) {
+		return;
+	}
+
 	using Way = SendFilesWay;
 	const auto way = _sendWay ? _sendWay->value() : Way::Files;
 
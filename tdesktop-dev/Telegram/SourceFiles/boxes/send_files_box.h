@@ -91,10 +91,18 @@ private:
 
 	void refreshAlbumMediaCount();
 	void preparePreview();
+	void preparePartialPreview();
 	void prepareSingleFilePreview();
-	void prepareAlbumPreview();
+	void prepareAlbumPreview(int count);
+	void refreshPreview();
 	void applyAlbumOrder();
 
+	void startPreparing();
+	void filePrepared(int index, Storage::PreparedFile &&file);
+	void finishPreparing();
+	void addedFilePrepared(int index, Storage::PreparedFile &&file);
+	void finishAdding();
+
 	void send(bool ctrlShiftEnter = false);
 	void captionResized();
 
@@ -112,6 +120,12 @@ private:
 	int _titleHeight = 0;
 
 	Storage::PreparedList _list;
+	base::flat_set<int> _preparing;
+	base::binary_guard _preparingGuard;
+
+	Storage::PreparedList _adding;
+	int _addingLeft = 0;
+	base::binary_guard _addingGuard;
 
 	CompressConfirm _compressConfirmInitial = CompressConfirm::None;
 	CompressConfirm _compressConfirm = CompressConfirm::None;
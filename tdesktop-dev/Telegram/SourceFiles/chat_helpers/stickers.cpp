@@ -22,6 +22,25 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "styles/style_chat_helpers.h"
 
 namespace Stickers {
+namespace {
+
+constexpr auto kSortKeySlice = 65536;
+constexpr auto kRecentSortKeyBase = kSortKeySlice * 4;
+constexpr auto kFeaturedSortKeyBase = kSortKeySlice * 2;
+
+template <typename Iterator>
+void SortBySeed(Iterator from, Iterator till, uint64 seed) {
+	const auto key = [&](not_null<DocumentData*> document) {
+		return (document->id ^ seed) % kSortKeySlice;
+	};
+	std::sort(from, till, [&](
+			not_null<DocumentData*> a,
+			not_null<DocumentData*> b) {
+		return key(a) > key(b);
+	});
+}
+
+} // namespace
 
 void ApplyArchivedResult(const MTPDmessages_stickerSetInstallResultArchive &d) {
 	auto &v = d.vsets.v;
@@ -680,45 +699,81 @@ void GifsReceived(const QVector<MTPDocument> &items, int32 hash) {
 	Auth().data().notifySavedGifsUpdated();
 }
 
-std::vector<not_null<DocumentData*>> GetListByEmoji(
+std::vector<not_null<DocumentData*>> EmojiIndex::list(
 		not_null<EmojiPtr> emoji,
 		uint64 seed) {
 	const auto original = emoji->original();
+	const auto others = Global::SuggestStickersByEmoji()
+		? Auth().api().stickersByEmoji(original)
+		: nullptr;
+	if (Global::SuggestStickersByEmoji() && !others) {
+		return {};
+	}
+	const auto &candidates = this->candidates(original);
+	const auto &list = candidates.list;
 
-	struct StickerWithDate {
-		not_null<DocumentData*> document;
-		TimeId date = 0;
-	};
-	auto result = std::vector<StickerWithDate>();
-	auto &sets = Auth().data().stickerSetsRef();
-	auto setsToRequest = base::flat_map<uint64, uint64>();
+	auto result = std::vector<not_null<DocumentData*>>();
+	result.reserve(list.size() + (others ? others->size() : 0));
 
-	const auto add = [&](not_null<DocumentData*> document, TimeId date) {
-		if (ranges::find(result, document, [](const StickerWithDate &data) {
-			return data.document;
-		}) == result.end()) {
-			result.push_back({ document, date });
+	// Only the candidates without a date are shuffled by the seed,
+	// each of them inside the range of the same sort key.
+	for (auto i = list.begin(); i != list.end();) {
+		if (!i->seeded) {
+			result.push_back((i++)->document);
+			continue;
 		}
-	};
+		const auto sortKey = i->sortKey;
+		const auto from = result.size();
+		for (; i != list.end() && i->seeded && i->sortKey == sortKey; ++i) {
+			result.push_back(i->document);
+		}
+		SortBySeed(result.begin() + from, result.end(), seed);
+	}
+	if (others) {
+		auto added = base::flat_set<not_null<DocumentData*>>();
+		const auto from = result.size();
+		for (const auto document : *others) {
+			if (!candidates.documents.contains(document)
+				&& added.emplace(document) != added.end()) {
+				result.push_back(document);
+			}
+		}
+		SortBySeed(result.begin() + from, result.end(), seed);
+	}
+	return result;
+}
+
+void EmojiIndex::invalidate() {
+	_candidates.clear();
+}
+
+void EmojiIndex::invalidate(const Set &set) {
+	for (auto i = set.emoji.cbegin(), e = set.emoji.cend(); i != e; ++i) {
+		_candidates.remove(i.key());
+	}
+}
+
+auto EmojiIndex::candidates(not_null<EmojiPtr> original)
+-> const Candidates & {
+	auto i = _candidates.find(original);
+	if (i == _candidates.end()) {
+		i = _candidates.emplace(original, collect(original)).first;
+	}
+	return i->second;
+}
 
-	constexpr auto kSlice = 65536;
-	const auto CreateSortKey = [&](
+auto EmojiIndex::collect(not_null<EmojiPtr> original) -> Candidates {
+	auto result = Candidates();
+	auto &sets = Auth().data().stickerSetsRef();
+	auto setsToRequest = base::flat_map<uint64, uint64>();
+
+	const auto add = [&](
 			not_null<DocumentData*> document,
-			int base) {
-		return TimeId(base + int((document->id ^ seed) % kSlice));
-	};
-	const auto CreateRecentSortKey = [&](not_null<DocumentData*> document) {
-		return CreateSortKey(document, kSlice * 4);
-	};
-	auto myCounter = 0;
-	const auto CreateMySortKey = [&] {
-		return (kSlice * 4 - (++myCounter));
-	};
-	const auto CreateFeaturedSortKey = [&](not_null<DocumentData*> document) {
-		return CreateSortKey(document, kSlice * 2);
-	};
-	const auto CreateOtherSortKey = [&](not_null<DocumentData*> document) {
-		return CreateSortKey(document, kSlice);
+			TimeId sortKey,
+			bool seeded) {
+		if (result.documents.emplace(document) != result.documents.end()) {
+			result.list.push_back({ document, sortKey, seeded });
+		}
 	};
 	const auto InstallDate = [&](not_null<DocumentData*> document) {
 		Expects(document->sticker() != nullptr);
@@ -726,75 +781,72 @@ std::vector<not_null<DocumentData*>> GetListByEmoji(
 		const auto sticker = document->sticker();
 		if (sticker->set.type() == mtpc_inputStickerSetID) {
 			const auto setId = sticker->set.c_inputStickerSetID().vid.v;
-			const auto setIt = sets.find(setId);
-			if (setIt != sets.end()) {
+			const auto setIt = sets.constFind(setId);
+			if (setIt != sets.cend()) {
 				return setIt->installDate;
 			}
 		}
 		return TimeId(0);
 	};
 
-	auto recentIt = sets.find(Stickers::CloudRecentSetId);
+	const auto recentIt = sets.constFind(CloudRecentSetId);
 	if (recentIt != sets.cend()) {
-		auto i = recentIt->emoji.constFind(original);
+		const auto i = recentIt->emoji.constFind(original);
 		if (i != recentIt->emoji.cend()) {
-			result.reserve(i->size());
+			auto usageDates = base::flat_map<DocumentData*, TimeId>();
 			for (const auto document : *i) {
-				const auto usageDate = [&] {
-					if (recentIt->dates.empty()) {
-						return TimeId(0);
-					}
-					const auto index = recentIt->stickers.indexOf(document);
-					if (index < 0) {
-						return TimeId(0);
+				usageDates.emplace(document, TimeId(0));
+			}
+			if (!recentIt->dates.empty()) {
+				const auto &stickers = recentIt->stickers;
+				for (auto index = 0; index != stickers.size(); ++index) {
+					const auto j = usageDates.find(stickers[index]);
+					if (j != usageDates.end() && !j->second) {
+						Assert(index < recentIt->dates.size());
+						j->second = recentIt->dates[index];
 					}
-					Assert(index < recentIt->dates.size());
-					return recentIt->dates[index];
-				}();
+				}
+			}
+			result.list.reserve(i->size());
+			for (const auto document : *i) {
+				const auto usageDate = usageDates[document];
 				const auto date = usageDate
 					? usageDate
 					: InstallDate(document);
-				result.push_back({
-					document,
-					date ? date : CreateRecentSortKey(document) });
+				add(document, date ? date : kRecentSortKeyBase, !date);
 			}
 		}
 	}
-	const auto addList = [&](const Order &order, MTPDstickerSet::Flag skip) {
-		for (const auto setId : order) {
-			auto it = sets.find(setId);
-			if (it == sets.cend() || (it->flags & skip)) {
-				continue;
-			}
-			if (it->emoji.isEmpty()) {
-				setsToRequest.emplace(it->id, it->access);
-				it->flags |= MTPDstickerSet_ClientFlag::f_not_loaded;
-				continue;
-			}
-			auto i = it->emoji.constFind(original);
-			if (i == it->emoji.cend()) {
-				continue;
-			}
-			const auto my = (it->flags & MTPDstickerSet::Flag::f_installed_date);
-			result.reserve(result.size() + i->size());
-			for (const auto document : *i) {
-				const auto installDate = my ? it->installDate : TimeId(0);
-				const auto date = (installDate > 1)
-					? installDate
-					: my
-					? CreateMySortKey()
-					: CreateFeaturedSortKey(document);
-				add(document, date);
+
+	auto myCounter = 0;
+	for (const auto setId : Auth().data().stickerSetsOrder()) {
+		auto it = sets.find(setId);
+		if (it == sets.cend()
+			|| (it->flags & MTPDstickerSet::Flag::f_archived)) {
+			continue;
+		}
+		if (it->emoji.isEmpty()) {
+			setsToRequest.emplace(it->id, it->access);
+			it->flags |= MTPDstickerSet_ClientFlag::f_not_loaded;
+			continue;
+		}
+		const auto i = it->emoji.constFind(original);
+		if (i == it->emoji.cend()) {
+			continue;
+		}
+		const auto my = (it->flags & MTPDstickerSet::Flag::f_installed_date);
+		const auto installDate = my ? it->installDate : TimeId(0);
+		result.list.reserve(result.list.size() + i->size());
+		for (const auto document : *i) {
+			if (installDate > 1) {
+				add(document, installDate, false);
+			} else if (my) {
+				add(document, kRecentSortKeyBase - (++myCounter), false);
+			} else {
+				add(document, kFeaturedSortKeyBase, true);
 			}
 		}
-	};
-
-	addList(
-		Auth().data().stickerSetsOrder(),
-		MTPDstickerSet::Flag::f_archived);
-	//addList(
-	//	Auth().data().featuredStickerSetsOrder(),
-	//	MTPDstickerSet::Flag::f_installed_date);
+	}
 
 	if (!setsToRequest.empty()) {
 		for (const auto [setId, accessHash] : setsToRequest) {
@@ -803,27 +855,19 @@ std::vector<not_null<DocumentData*>> GetListByEmoji(
 		Auth().api().requestStickerSets();
 	}
 
-	if (Global::SuggestStickersByEmoji()) {
-		const auto others = Auth().api().stickersByEmoji(original);
-		if (!others) {
-			return {};
-		}
-		result.reserve(result.size() + others->size());
-		for (const auto document : *others) {
-			add(document, CreateOtherSortKey(document));
-		}
-	}
-
-	ranges::action::sort(
-		result,
+	// The seeded candidates get their final keys inside the slice
+	// above the base, so they stay between the same neighbours.
+	ranges::stable_sort(
+		result.list,
 		std::greater<>(),
-		[](const StickerWithDate &data) { return data.date; });
+		[](const Candidate &data) { return data.sortKey; });
+	return result;
+}
 
-	return ranges::view::all(
-		result
-	) | ranges::view::transform([](const StickerWithDate &data) {
-		return data.document;
-	}) | ranges::to_vector;
+std::vector<not_null<DocumentData*>> GetListByEmoji(
+		not_null<EmojiPtr> emoji,
+		uint64 seed) {
+	return Auth().data().stickersEmojiIndex().list(emoji, seed);
 }
 
 std::optional<std::vector<not_null<EmojiPtr>>> GetEmojiListFromSet(
@@ -900,6 +944,7 @@ Set *FeedSet(const MTPDstickerSet &set) {
 			Auth().data().archivedStickerSetsOrderRef().removeAt(index);
 		}
 	}
+	Auth().data().stickersEmojiIndex().invalidate(it.value());
 	return &it.value();
 }
 
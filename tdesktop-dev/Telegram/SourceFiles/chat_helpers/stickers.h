@@ -58,6 +58,35 @@ struct Set {
 };
 using Sets = QMap<uint64, Set>;
 
+// Stickers suggested by emoji, collected from the sets once per emoji
+// and kept in the final order till the sets change.
+class EmojiIndex {
+public:
+	std::vector<not_null<DocumentData*>> list(
+		not_null<EmojiPtr> emoji,
+		uint64 seed);
+
+	void invalidate();
+	void invalidate(const Set &set);
+
+private:
+	struct Candidate {
+		not_null<DocumentData*> document;
+		TimeId sortKey = 0;
+		bool seeded = false;
+	};
+	struct Candidates {
+		std::vector<Candidate> list;
+		base::flat_set<not_null<DocumentData*>> documents;
+	};
+
+	const Candidates &candidates(not_null<EmojiPtr> original);
+	Candidates collect(not_null<EmojiPtr> original);
+
+	base::flat_map<not_null<EmojiPtr>, Candidates> _candidates;
+
+};
+
 inline MTPInputStickerSet inputSetId(const Set &set) {
 	if (set.id && set.access) {
 		return MTP_inputStickerSetID(MTP_long(set.id), MTP_long(set.access));
@@ -15,6 +15,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtGui/QPainter>
 #include <QtCore/QDir>
 
+#include <array>
+
 #ifdef SUPPORT_IMAGE_GENERATION
 Q_IMPORT_PLUGIN(QWebpPlugin)
 #ifdef Q_OS_MAC
@@ -340,6 +342,12 @@ std::vector<One> Items;\n\
 		return false;
 	}
 	source_->popNamespace().newline().pushNamespace("internal");
+	if (!writeFirstChars("Find", data_.map)) {
+		return false;
+	}
+	if (!writeFirstChars("Replace", data_.replaces)) {
+		return false;
+	}
 	source_->stream() << "\
 \n\
 int FullCount() {\n\
@@ -351,6 +359,9 @@ EmojiPtr ByIndex(int index) {\n\
 }\n\
 \n\
 EmojiPtr FindReplace(const QChar *start, const QChar *end, int *outLength) {\n\
+	if (start == end || !IsReplaceStart(start->unicode())) {\n\
+		return nullptr;\n\
+	}\n\
 	auto index = FindReplaceIndex(start, end, outLength);\n\
 	return index ? &Items[index - 1] : nullptr;\n\
 }\n\
@@ -360,6 +371,9 @@ const std::vector<std::pair<QString, int>> GetReplacementPairs() {\n\
 }\n\
 \n\
 EmojiPtr Find(const QChar *start, const QChar *end, int *outLength) {\n\
+	if (start == end || !IsFindStart(start->unicode())) {\n\
+		return nullptr;\n\
+	}\n\
 	auto index = FindIndex(start, end, outLength);\n\
 	return index ? &Items[index - 1] : nullptr;\n\
 }\n\
@@ -406,6 +420,29 @@ EmojiPtr ByIndex(int index);\n\
 \n\
 EmojiPtr Find(const QChar *ch, const QChar *end, int *outLength = nullptr);\n\
 \n\
+extern const uchar FindFirstPages[256];\n\
+extern const uint64 FindFirstBits[][4];\n\
+extern const uchar ReplaceFirstPages[256];\n\
+extern const uint64 ReplaceFirstBits[][4];\n\
+\n\
+// A bit for each code unit that starts at least one sequence,\n\
+// pages of 256 code units without any such bits are not stored.\n\
+inline bool IsFirstChar(\n\
+		const uchar *pages,\n\
+		const uint64 (*bits)[4],\n\
+		ushort ch) {\n\
+	const auto page = pages[ch >> 8];\n\
+	return page && ((bits[page - 1][(ch >> 6) & 0x03] >> (ch & 0x3F)) & 1);\n\
+}\n\
+\n\
+inline bool IsFindStart(ushort ch) {\n\
+	return IsFirstChar(FindFirstPages, FindFirstBits, ch);\n\
+}\n\
+\n\
+inline bool IsReplaceStart(ushort ch) {\n\
+	return IsFirstChar(ReplaceFirstPages, ReplaceFirstBits, ch);\n\
+}\n\
+\n\
 inline bool IsReplaceEdge(const QChar *ch) {\n\
 	return true;\n\
 \n\
@@ -608,6 +645,51 @@ EmojiPack GetSection(Section section) {\n\
 	return true;
 }
 
+bool Generator::writeFirstChars(
+		const QString &name,
+		const std::map<QString, int, std::greater<QString>> &dictionary) {
+	auto pages = std::map<int, std::array<quint64, 4>>();
+	for (const auto &item : dictionary) {
+		if (item.first.isEmpty()) {
+			logDataError() << "empty key in " << name.toStdString() << " dictionary.";
+			return false;
+		}
+		const auto ch = item.first[0].unicode();
+		auto &bits = pages[ch >> 8];
+		bits[(ch >> 6) & 0x03] |= (quint64(1) << (ch & 0x3F));
+	}
+	auto indices = std::map<int, int>();
+	for (const auto &page : pages) {
+		indices.emplace(page.first, int(indices.size()) + 1);
+	}
+
+	source_->stream() << "\
+\n\
+const uchar " << name << "FirstPages[256] = {";
+	for (auto i = 0; i != 256; ++i) {
+		const auto index = indices.find(i);
+		source_->stream()
+			<< ((i % 32) ? " " : "\n\t")
+			<< ((index != end(indices)) ? index->second : 0)
+			<< ",";
+	}
+	source_->stream() << "\n\
+};\n\
+\n\
+const uint64 " << name << "FirstBits[][4] = {\n";
+	for (const auto &page : pages) {
+		source_->stream() << "\t{";
+		for (const auto bits : page.second) {
+			source_->stream()
+				<< " 0x" << QString::number(bits, 16) << "ULL,";
+		}
+		source_->stream() << " },\n";
+	}
+	source_->stream() << "\
+};\n";
+	return true;
+}
+
 bool Generator::writeFindReplace() {
 	source_->stream() << "\
 \n\
@@ -46,6 +46,9 @@ private:
 	bool writeSections();
 	bool writeReplacements();
 	bool writeGetSections();
+	bool writeFirstChars(
+		const QString &name,
+		const std::map<QString, int, std::greater<QString>> &dictionary);
 	bool writeFindReplace();
 	bool writeFind();
 	bool writeFindFromDictionary(
@@ -431,6 +431,7 @@ public:\n\
 	palette() = default;\n\
 	palette(const palette &other) = delete;\n\
 \n\
+	// All the colors in a fixed order, valid while Checksum() is the same.\n\
 	QByteArray save() const;\n\
 	bool load(const QByteArray &cache);\n\
 \n\
@@ -961,9 +962,18 @@ bool palette::load(const QByteArray &cache) {\n\
 	if (cache.size() != " << (count * 4) << ") return false;\n\
 \n\
 	auto p = reinterpret_cast<const uchar*>(cache.constData());\n\
-	for (auto i = 0; i != " << count << "; ++i) {\n\
-		setData(i, { p[i * 4 + 0], p[i * 4 + 1], p[i * 4 + 2], p[i * 4 + 3] });\n\
+	for (auto i = 0; i != " << count << "; ++i, p += 4) {\n\
+		// Keep the pens and brushes of the colors that didn't change.\n\
+		if (_status[i] != Status::Initial\n\
+			&& data(i)->c == QColor(int(p[0]), int(p[1]), int(p[2]), int(p[3]))) {\n\
+			_status[i] = Status::Loaded;\n\
+			continue;\n\
+		}\n\
+		setData(i, { p[0], p[1], p[2], p[3] });\n\
 	}\n\
+\n\
+	// All the colors are loaded, so it only marks the palette ready.\n\
+	finalize();\n\
 	return true;\n\
 }\n\
 \n\
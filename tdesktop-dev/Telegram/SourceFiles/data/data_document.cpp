@@ -16,6 +16,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/media_active_cache.h"
 #include "core/mime_type.h"
 #include "media/media_audio.h"
+#include "media/streaming/media_streaming_loader_mtproto.h"
 #include "storage/localstorage.h"
 #include "platform/platform_specific.h"
 #include "history/history.h"
@@ -451,16 +452,6 @@ Data::FileOrigin StickerData::setOrigin() const {
 	});
 }
 
-VoiceData::~VoiceData() {
-	if (!waveform.isEmpty()
-		&& waveform[0] == -1
-		&& waveform.size() > int32(sizeof(TaskId))) {
-		TaskId taskId = 0;
-		memcpy(&taskId, waveform.constData() + 1, sizeof(taskId));
-		Local::cancelTask(taskId);
-	}
-}
-
 DocumentData::DocumentData(DocumentId id, not_null<AuthSession*> session)
 : id(id)
 , _session(session) {
@@ -573,6 +564,10 @@ Storage::Cache::Key DocumentData::goodThumbnailCacheKey() const {
 	return Data::DocumentThumbCacheKey(_dc, id);
 }
 
+Storage::Cache::Key DocumentData::waveformCacheKey() const {
+	return Data::DocumentWaveformCacheKey(_dc, id);
+}
+
 Image *DocumentData::goodThumbnail() const {
 	return _goodThumbnail.get();
 }
@@ -1359,6 +1354,21 @@ bool DocumentData::supportsStreaming() const {
 	return _supportsStreaming;
 }
 
+auto DocumentData::createStreamingLoader() const
+-> std::unique_ptr<Media::Streaming::Loader> {
+	if (!hasRemoteLocation() || size <= 0) {
+		return nullptr;
+	}
+	return std::make_unique<Media::Streaming::LoaderMtproto>(
+		&_session->downloader(),
+		_dc,
+		MTP_inputDocumentFileLocation(
+			MTP_long(id),
+			MTP_long(_access),
+			MTP_bytes(_fileReference)),
+		size);
+}
+
 void DocumentData::recountIsImage() {
 	_isImage = !isAnimation()
 		&& !isVideoFile()
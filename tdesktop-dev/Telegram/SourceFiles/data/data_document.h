@@ -13,6 +13,12 @@ namespace Images {
 class Source;
 } // namespace Images
 
+namespace Media {
+namespace Streaming {
+class Loader;
+} // namespace Streaming
+} // namespace Media
+
 namespace Storage {
 namespace Cache {
 struct Key;
@@ -60,8 +66,6 @@ struct SongData : public DocumentAdditionalData {
 };
 
 struct VoiceData : public DocumentAdditionalData {
-	~VoiceData();
-
 	int duration = 0;
 	VoiceWaveform waveform;
 	char wavemax = 0;
@@ -154,6 +158,9 @@ public:
 	bool isImage() const;
 	void recountIsImage();
 	bool supportsStreaming() const;
+
+	// Nullptr if the document can't be loaded by parts in any order.
+	std::unique_ptr<Media::Streaming::Loader> createStreamingLoader() const;
 	void setData(const QByteArray &data) {
 		_data = data;
 	}
@@ -162,6 +169,7 @@ public:
 
 	Image *goodThumbnail() const;
 	Storage::Cache::Key goodThumbnailCacheKey() const;
+	Storage::Cache::Key waveformCacheKey() const;
 	void setGoodThumbnail(QImage &&image, QByteArray &&bytes);
 	void refreshGoodThumbnail();
 	void replaceGoodThumbnail(std::unique_ptr<Images::Source> &&source);
@@ -73,7 +73,8 @@ Session::Session(not_null<AuthSession*> session)
 	Local::cachePath(),
 	Local::cacheSettings()))
 , _groups(this)
-, _unmuteByFinishedTimer([=] { unmuteByFinished(); }) {
+, _unmuteByFinishedTimer([=] { unmuteByFinished(); })
+, _waveforms(this) {
 	_cache->open(Local::cacheKey());
 
 	setupContactViewsViewer();
@@ -382,6 +383,15 @@ rpl::producer<not_null<ViewElement*>> Session::viewResizeRequest() const {
 	return _viewResizeRequest.events();
 }
 
+void Session::requestHistoryResize(not_null<History*> history) {
+	history->setHasPendingResizedItems();
+	_historyResizeRequest.fire_copy(history);
+}
+
+rpl::producer<not_null<History*>> Session::historyResizeRequest() const {
+	return _historyResizeRequest.events();
+}
+
 void Session::requestItemViewRefresh(not_null<HistoryItem*> item) {
 	if (const auto view = item->mainView()) {
 		view->setPendingResize();
@@ -512,6 +522,8 @@ rpl::producer<FeedUpdate> Session::feedUpdated() const {
 }
 
 void Session::notifyStickersUpdated() {
+	// Any set could be changed, so the whole emoji index is rebuilt lazily.
+	_stickersEmojiIndex.invalidate();
 	_stickersUpdated.fire({});
 }
 
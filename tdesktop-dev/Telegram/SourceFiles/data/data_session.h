@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "chat_helpers/stickers.h"
 #include "dialogs/dialogs_key.h"
 #include "data/data_groups.h"
+#include "data/data_waveforms.h"
 #include "history/history_location_manager.h"
 #include "base/timer.h"
 
@@ -112,6 +113,8 @@ public:
 	[[nodiscard]] rpl::producer<not_null<const HistoryItem*>> itemResizeRequest() const;
 	void requestViewResize(not_null<ViewElement*> view);
 	[[nodiscard]] rpl::producer<not_null<ViewElement*>> viewResizeRequest() const;
+	void requestHistoryResize(not_null<History*> history);
+	[[nodiscard]] rpl::producer<not_null<History*>> historyResizeRequest() const;
 	void requestItemViewRefresh(not_null<HistoryItem*> item);
 	[[nodiscard]] rpl::producer<not_null<HistoryItem*>> itemViewRefreshRequest() const;
 	void requestItemTextRefresh(not_null<HistoryItem*> item);
@@ -205,6 +208,9 @@ public:
 	Stickers::Order &stickerSetsOrderRef() {
 		return _stickerSetsOrder;
 	}
+	Stickers::EmojiIndex &stickersEmojiIndex() {
+		return _stickersEmojiIndex;
+	}
 	const Stickers::Order &featuredStickerSetsOrder() const {
 		return _featuredStickerSetsOrder;
 	}
@@ -438,6 +444,9 @@ public:
 	const Groups &groups() const {
 		return _groups;
 	}
+	Waveforms &waveforms() {
+		return _waveforms;
+	}
 
 private:
 	void suggestStartExport();
@@ -562,6 +571,7 @@ private:
 	rpl::event_stream<not_null<const ViewElement*>> _viewRepaintRequest;
 	rpl::event_stream<not_null<const HistoryItem*>> _itemResizeRequest;
 	rpl::event_stream<not_null<ViewElement*>> _viewResizeRequest;
+	rpl::event_stream<not_null<History*>> _historyResizeRequest;
 	rpl::event_stream<not_null<HistoryItem*>> _itemViewRefreshRequest;
 	rpl::event_stream<not_null<HistoryItem*>> _itemTextRefreshRequest;
 	rpl::event_stream<not_null<HistoryItem*>> _animationPlayInlineRequest;
@@ -588,6 +598,7 @@ private:
 	Stickers::Order _featuredStickerSetsOrder;
 	Stickers::Order _archivedStickerSetsOrder;
 	Stickers::SavedGifs _savedGifs;
+	Stickers::EmojiIndex _stickersEmojiIndex;
 
 	std::unordered_map<
 		PhotoId,
@@ -660,6 +671,8 @@ private:
 
 	rpl::event_stream<> _newAuthorizationChecks;
 
+	Waveforms _waveforms;
+
 	rpl::lifetime _lifetime;
 
 };
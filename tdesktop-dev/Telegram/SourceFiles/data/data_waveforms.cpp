@@ -0,0 +1,247 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_waveforms.h"
+
+#include "data/data_session.h"
+#include "data/data_document.h"
+#include "media/media_audio.h"
+#include "storage/cache/storage_cache_database.h"
+
+namespace Data {
+namespace {
+
+// Voice messages are small, so a batch of them is decoded by one task
+// without paying for a thread pool round trip for each of them.
+constexpr auto kBatchSize = 8;
+
+int MaxTasksInFlight() {
+	static const auto result = std::max(QThread::idealThreadCount() / 2, 1);
+	return result;
+}
+
+bool Counting(not_null<VoiceData*> voice) {
+	return !voice->waveform.isEmpty() && voice->waveform[0] == -1;
+}
+
+char WaveformMax(const VoiceWaveform &waveform) {
+	Expects(!waveform.isEmpty());
+
+	return char(*std::max_element(waveform.begin(), waveform.end()));
+}
+
+bool ValidWaveform(const VoiceWaveform &waveform) {
+	if (waveform.isEmpty()
+		|| waveform.size() > Media::Player::kWaveformSamplesCount) {
+		return false;
+	}
+	for (const auto value : waveform) {
+		if (value < 0 || value > 31) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+Waveforms::Waveforms(not_null<Session*> owner) : _owner(owner) {
+}
+
+Waveforms::~Waveforms() {
+	for (const auto &job : _queued) {
+		if (job.data.isEmpty()) {
+			job.location.accessDisable();
+		}
+	}
+}
+
+void Waveforms::count(not_null<DocumentData*> document) {
+	const auto voice = document->voice();
+	if (!voice || Counting(voice)) {
+		return;
+	}
+	voice->waveform = VoiceWaveform(1, -1);
+
+	auto callback = [=, weak = base::make_weak(this)](
+			QByteArray &&value) mutable {
+		crl::on_main(weak, [=, value = std::move(value)]() mutable {
+			applyCached(document, std::move(value));
+		});
+	};
+	_owner->cache().get(document->waveformCacheKey(), std::move(callback));
+}
+
+void Waveforms::applyCached(
+		not_null<DocumentData*> document,
+		QByteArray &&value) {
+	const auto voice = document->voice();
+	if (!voice || !Counting(voice)) {
+		return;
+	}
+	auto waveform = documentWaveformDecode(value);
+	if (ValidWaveform(waveform)) {
+		apply(document, std::move(waveform));
+	} else {
+		enqueue(document);
+	}
+}
+
+void Waveforms::enqueue(not_null<DocumentData*> document) {
+	auto job = Job{ document, document->location(true), document->data() };
+	if (job.data.isEmpty() && !job.location.accessEnable()) {
+		apply(document, VoiceWaveform());
+		return;
+	}
+	_queued.push_back(std::move(job));
+	scheduleTasks();
+}
+
+// Documents are enqueued one by one as the cache answers come,
+// so the tasks are started later to collect them in full batches.
+void Waveforms::scheduleTasks() {
+	if (_tasksScheduled) {
+		return;
+	}
+	_tasksScheduled = true;
+	crl::on_main(this, [=] {
+		_tasksScheduled = false;
+		startTasks();
+	});
+}
+
+void Waveforms::startTasks() {
+	while (!_queued.empty() && _tasksInFlight < MaxTasksInFlight()) {
+		const auto size = std::min(int(_queued.size()), kBatchSize);
+		auto jobs = std::vector<Job>(
+			std::make_move_iterator(begin(_queued)),
+			std::make_move_iterator(begin(_queued) + size));
+		_queued.erase(begin(_queued), begin(_queued) + size);
+
+		++_tasksInFlight;
+		crl::async([
+			weak = base::make_weak(this),
+			jobs = std::move(jobs)
+		]() mutable {
+			const auto instructions
+				= Media::Audio::Kernels::SupportedInstructions();
+			for (auto &job : jobs) {
+				job.result = audioCountWaveform(
+					job.location,
+					job.data,
+					instructions);
+			}
+			crl::on_main(weak, [=, jobs = std::move(jobs)]() mutable {
+				weak->finishBatch(std::move(jobs));
+			});
+		});
+	}
+}
+
+void Waveforms::finishBatch(std::vector<Job> &&jobs) {
+	--_tasksInFlight;
+	for (auto &job : jobs) {
+		if (job.data.isEmpty()) {
+			job.location.accessDisable();
+		}
+		if (!job.result.isEmpty()) {
+			_owner->cache().put(
+				job.document->waveformCacheKey(),
+				Storage::Cache::Database::TaggedValue(
+					documentWaveformEncode5bit(job.result),
+					kWaveformCacheTag));
+		}
+		const auto voice = job.document->voice();
+		if (voice && Counting(voice)) {
+			apply(job.document, std::move(job.result));
+		}
+	}
+	startTasks();
+}
+
+void Waveforms::apply(
+		not_null<DocumentData*> document,
+		VoiceWaveform &&waveform) {
+	const auto voice = document->voice();
+	Assert(voice != nullptr);
+
+	if (waveform.isEmpty()) {
+		voice->waveform = VoiceWaveform(1, -2);
+		voice->wavemax = 0;
+	} else {
+		voice->wavemax = WaveformMax(waveform);
+		voice->waveform = std::move(waveform);
+	}
+	_owner->requestDocumentViewRepaint(document);
+}
+
+QString BenchmarkWaveforms(const QStringList &paths) {
+	using Media::Audio::Kernels::Instructions;
+
+	auto files = std::vector<QByteArray>();
+	auto bytes = int64(0);
+	for (const auto &path : paths) {
+		auto file = QFile(path);
+		if (file.open(QIODevice::ReadOnly)) {
+			files.push_back(file.readAll());
+			bytes += files.back().size();
+		}
+	}
+	const auto count = int(files.size());
+
+	auto sequential = std::vector<VoiceWaveform>(count);
+	const auto sequentialStart = getms(true);
+	for (auto i = 0; i != count; ++i) {
+		sequential[i] = audioCountWaveform(
+			FileLocation(),
+			files[i],
+			Instructions::Scalar);
+	}
+	const auto sequentialTime = getms(true) - sequentialStart;
+
+	// The batches are started all at once, the pool limits the threads.
+	auto batched = std::vector<VoiceWaveform>(count);
+	auto finished = QSemaphore();
+	auto batches = 0;
+	const auto batchedStart = getms(true);
+	const auto instructions = Media::Audio::Kernels::SupportedInstructions();
+	for (auto from = 0; from < count; from += kBatchSize) {
+		const auto till = std::min(from + kBatchSize, count);
+		crl::async([&, from, till] {
+			for (auto i = from; i != till; ++i) {
+				batched[i] = audioCountWaveform(
+					FileLocation(),
+					files[i],
+					instructions);
+			}
+			finished.release();
+		});
+		++batches;
+	}
+	finished.acquire(batches);
+	const auto batchedTime = getms(true) - batchedStart;
+
+	auto failed = 0;
+	for (const auto &waveform : sequential) {
+		if (waveform.isEmpty()) {
+			++failed;
+		}
+	}
+	const auto same = (batched == sequential);
+	return qsl("Files: %1, %2 KB, failed %3\n"
+		"Sequential scalar: %4 ms\n"
+		"Batched by %5: %6 ms%7"
+		).arg(count
+		).arg(bytes / 1024
+		).arg(failed
+		).arg(sequentialTime
+		).arg(kBatchSize
+		).arg(batchedTime
+		).arg(same ? QString() : qsl(", DIFFERENT OUTPUT"));
+}
+
+} // namespace Data
@@ -0,0 +1,55 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "data/data_types.h"
+#include "ui/image/image_location.h"
+#include "base/weak_ptr.h"
+
+namespace Data {
+
+class Session;
+
+// Counts the waveforms of loaded voice messages that came without one.
+// The results are kept in the cache database, the misses are decoded
+// in batches by a few tasks in the thread pool.
+class Waveforms final : public base::has_weak_ptr {
+public:
+	explicit Waveforms(not_null<Session*> owner);
+	~Waveforms();
+
+	void count(not_null<DocumentData*> document);
+
+private:
+	struct Job {
+		not_null<DocumentData*> document;
+		FileLocation location;
+		QByteArray data;
+		VoiceWaveform result;
+	};
+
+	void applyCached(not_null<DocumentData*> document, QByteArray &&value);
+	void enqueue(not_null<DocumentData*> document);
+	void scheduleTasks();
+	void startTasks();
+	void finishBatch(std::vector<Job> &&jobs);
+	void apply(not_null<DocumentData*> document, VoiceWaveform &&waveform);
+
+	not_null<Session*> _owner;
+	std::deque<Job> _queued;
+	int _tasksInFlight = 0;
+	bool _tasksScheduled = false;
+
+};
+
+// Counts the waveforms of the files once one by one with scalar code and
+// once in the batches the service uses with the best instruction set.
+// Returns a human readable report with the timings.
+QString BenchmarkWaveforms(const QStringList &paths);
+
+} // namespace Data
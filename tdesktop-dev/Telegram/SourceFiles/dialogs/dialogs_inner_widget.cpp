@@ -1840,6 +1840,8 @@ void DialogsInner::applyDialog(const MTPDdialog &dialog) {
 //}
 
 void DialogsInner::addSavedPeersAfter(const QDateTime &date) {
+	Local::readSavedPeers();
+
 	auto &saved = cRefSavedPeersByTime();
 	while (!saved.isEmpty() && (date.isNull() || date < saved.lastKey())) {
 		const auto lastDate = saved.lastKey();
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "export/export_api_wrap.h"
 
 #include "export/export_settings.h"
+#include "export/export_incremental.h"
 #include "export/data/export_data_types.h"
 #include "export/output/export_output_result.h"
 #include "export/output/export_output_file.h"
@@ -393,12 +394,15 @@ rpl::producer<Output::Result> ApiWrap::ioErrors() const {
 void ApiWrap::startExport(
 		const Settings &settings,
 		Output::Stats *stats,
+		IncrementalState *incremental,
 		FnMut<void(StartInfo)> done) {
 	Expects(_settings == nullptr);
 	Expects(_startProcess == nullptr);
+	Expects(!settings.incremental || incremental != nullptr);
 
 	_settings = std::make_unique<Settings>(settings);
 	_stats = stats;
+	_incremental = settings.incremental ? incremental : nullptr;
 	_startProcess = std::make_unique<StartProcess>();
 	_startProcess->done = std::move(done);
 
@@ -564,6 +568,24 @@ bool ApiWrap::useOnlyLastSplit() const {
 	return !(_settings->types & Settings::Type::NonChannelChatsMask);
 }
 
+int32 ApiWrap::splitKey(int splitIndex) const {
+	Expects(splitIndex >= 0 && splitIndex < _splits.size());
+
+	return _splits[splitIndex].c_messageRange().vmin_id.v;
+}
+
+int32 ApiWrap::incrementalMinId(int localSplitIndex) const {
+	Expects(_chatProcess != nullptr);
+	Expects(localSplitIndex < _chatProcess->info.splits.size());
+
+	if (!_incremental) {
+		return 0;
+	}
+	return _incremental->lastExportedId(
+		_chatProcess->info.peerId,
+		splitKey(_chatProcess->info.splits[localSplitIndex]));
+}
+
 void ApiWrap::requestLeftChannelsList(
 		Fn<bool(int count)> progress,
 		FnMut<void(Data::DialogsInfo&&)> done) {
@@ -735,6 +757,18 @@ void ApiWrap::loadUserpicsFiles(Data::UserpicsSlice &&slice) {
 
 	if (slice.list.empty()) {
 		_userpicsProcess->lastSlice = true;
+	} else {
+		_userpicsProcess->processed += slice.list.size();
+		_userpicsProcess->maxId = slice.list.back().id;
+	}
+	if (_incremental) {
+		// Don't download again the photos exported in previous runs.
+		const auto exported = [&](const Data::Photo &photo) {
+			return _incremental->userpicExported(photo.id);
+		};
+		slice.list.erase(
+			ranges::remove_if(slice.list, exported),
+			end(slice.list));
 	}
 	_userpicsProcess->slice = std::move(slice);
 	_userpicsProcess->fileIndex = 0;
@@ -765,8 +799,11 @@ void ApiWrap::finishUserpicsSlice() {
 
 	auto slice = *base::take(_userpicsProcess->slice);
 	if (!slice.list.empty()) {
-		_userpicsProcess->processed += slice.list.size();
-		_userpicsProcess->maxId = slice.list.back().id;
+		if (_incremental) {
+			for (const auto &photo : slice.list) {
+				_incremental->exportedUserpic(photo.id);
+			}
+		}
 		if (!_userpicsProcess->handleSlice(std::move(slice))) {
 			return;
 		}
@@ -922,11 +959,14 @@ void ApiWrap::requestMessagesCount(int localSplitIndex) {
 	Expects(_chatProcess != nullptr);
 	Expects(localSplitIndex < _chatProcess->info.splits.size());
 
+	// In incremental mode min_id makes the result empty if there are
+	// no new messages in this split, so it will be skipped below.
 	requestChatMessages(
 		_chatProcess->info.splits[localSplitIndex],
 		0, // offset_id
 		0, // add_offset
 		1, // limit
+		incrementalMinId(localSplitIndex),
 		[=](const MTPmessages_Messages &result) {
 		Expects(_chatProcess != nullptr);
 
@@ -952,10 +992,71 @@ void ApiWrap::requestMessagesCount(int localSplitIndex) {
 			messagesCountLoaded(localSplitIndex, 0);
 			return;
 		}
+		const auto minId = incrementalMinId(localSplitIndex);
+		if (minId > 0) {
+			// The server count includes already exported messages.
+			requestNewMessagesCount(localSplitIndex, minId + 1, 0);
+			return;
+		}
 		checkFirstMessageDate(localSplitIndex, count);
 	});
 }
 
+void ApiWrap::requestNewMessagesCount(
+		int localSplitIndex,
+		int offsetId,
+		int counted) {
+	Expects(_chatProcess != nullptr);
+	Expects(localSplitIndex < _chatProcess->info.splits.size());
+
+	const auto minId = incrementalMinId(localSplitIndex);
+	requestChatMessages(
+		_chatProcess->info.splits[localSplitIndex],
+		offsetId,
+		-kMessagesSliceLimit,
+		kMessagesSliceLimit,
+		minId,
+		[=](const MTPmessages_Messages &result) {
+		Expects(_chatProcess != nullptr);
+
+		auto ids = std::vector<int32>();
+		auto lastSlice = false;
+		const auto valid = result.match(
+		[&](const MTPDmessages_messagesNotModified &data) {
+			return false;
+		}, [&](const auto &data) {
+			if constexpr (MTPDmessages_messages::Is<decltype(data)>()) {
+				lastSlice = true;
+			}
+			ids.reserve(data.vmessages.v.size());
+			for (const auto &message : data.vmessages.v) {
+				ids.push_back(message.match([](const auto &data) {
+					return data.vid.v;
+				}));
+			}
+			return true;
+		});
+		if (!valid) {
+			error("Unexpected messagesNotModified received.");
+			return;
+		}
+		const auto newer = CountNewMessages(
+			ids,
+			minId,
+			counted,
+			lastSlice,
+			kMessagesSliceLimit);
+		if (!newer.nextOffsetId) {
+			checkFirstMessageDate(localSplitIndex, newer.count);
+		} else {
+			requestNewMessagesCount(
+				localSplitIndex,
+				newer.nextOffsetId,
+				newer.count);
+		}
+	});
+}
+
 void ApiWrap::checkFirstMessageDate(int localSplitIndex, int count) {
 	Expects(_chatProcess != nullptr);
 	Expects(localSplitIndex < _chatProcess->info.splits.size());
@@ -971,6 +1072,7 @@ void ApiWrap::checkFirstMessageDate(int localSplitIndex, int count) {
 		1, // offset_id
 		-1, // add_offset
 		1, // limit
+		0, // min_id
 		[=](const MTPmessages_Messages &result) {
 		Expects(_chatProcess != nullptr);
 
@@ -1246,11 +1348,15 @@ void ApiWrap::requestMessagesSlice() {
 		loadMessagesFiles({});
 		return;
 	}
+	const auto offsetId = NewMessagesOffsetId(
+		_chatProcess->largestIdPlusOne,
+		incrementalMinId(_chatProcess->localSplitIndex));
 	requestChatMessages(
 		_chatProcess->info.splits[_chatProcess->localSplitIndex],
-		_chatProcess->largestIdPlusOne,
+		offsetId,
 		-kMessagesSliceLimit,
 		kMessagesSliceLimit,
+		0, // min_id
 		[=](const MTPmessages_Messages &result) {
 		Expects(_chatProcess != nullptr);
 
@@ -1275,6 +1381,7 @@ void ApiWrap::requestChatMessages(
 		int offsetId,
 		int addOffset,
 		int limit,
+		int minId,
 		FnMut<void(MTPmessages_Messages&&)> done) {
 	Expects(_chatProcess != nullptr);
 
@@ -1297,7 +1404,7 @@ void ApiWrap::requestChatMessages(
 			MTP_int(addOffset),
 			MTP_int(limit),
 			MTP_int(0), // max_id
-			MTP_int(0), // min_id
+			MTP_int(minId),
 			MTP_int(0) // hash
 		)).done(doneHandler).send();
 	} else {
@@ -1308,7 +1415,7 @@ void ApiWrap::requestChatMessages(
 			MTP_int(addOffset),
 			MTP_int(limit),
 			MTP_int(0), // max_id
-			MTP_int(0), // min_id
+			MTP_int(minId),
 			MTP_int(0)  // hash
 		)).fail([=](const RPCError &error) {
 			Expects(_chatProcess != nullptr);
@@ -1325,6 +1432,7 @@ void ApiWrap::requestChatMessages(
 						offsetId,
 						addOffset,
 						limit,
+						minId,
 						base::take(_chatProcess->requestDone));
 					return true;
 				}
@@ -1390,10 +1498,19 @@ void ApiWrap::finishMessagesSlice() {
 
 	auto slice = *base::take(_chatProcess->slice);
 	if (!slice.list.empty()) {
-		_chatProcess->largestIdPlusOne = slice.list.back().id + 1;
+		const auto lastId = slice.list.back().id;
+		_chatProcess->largestIdPlusOne = lastId + 1;
 		if (!_chatProcess->handleSlice(std::move(slice))) {
 			return;
 		}
+		if (_incremental) {
+			const auto splitIndex = _chatProcess->info.splits[
+				_chatProcess->localSplitIndex];
+			_incremental->exported(
+				_chatProcess->info.peerId,
+				splitKey(splitIndex),
+				lastId);
+		}
 	}
 	if (_chatProcess->lastSlice
 		&& (++_chatProcess->localSplitIndex
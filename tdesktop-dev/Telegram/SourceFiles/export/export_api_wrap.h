@@ -31,6 +31,7 @@ class Stats;
 } // namespace Output
 
 struct Settings;
+class IncrementalState;
 
 class ApiWrap {
 public:
@@ -46,6 +47,7 @@ public:
 	void startExport(
 		const Settings &settings,
 		Output::Stats *stats,
+		IncrementalState *incremental,
 		FnMut<void(StartInfo)> done);
 
 	void requestDialogsList(
@@ -120,6 +122,8 @@ private:
 	void otherDataDone(const QString &relativePath);
 
 	bool useOnlyLastSplit() const;
+	int32 splitKey(int splitIndex) const;
+	int32 incrementalMinId(int localSplitIndex) const;
 
 	void requestDialogsSlice();
 	void appendDialogsSlice(Data::DialogsInfo &&info);
@@ -141,6 +145,10 @@ private:
 		int splitIndex);
 
 	void requestMessagesCount(int localSplitIndex);
+	void requestNewMessagesCount(
+		int localSplitIndex,
+		int offsetId,
+		int counted);
 	void checkFirstMessageDate(int localSplitIndex, int count);
 	void messagesCountLoaded(int localSplitIndex, int count);
 	void requestMessagesSlice();
@@ -149,6 +157,7 @@ private:
 		int offsetId,
 		int addOffset,
 		int limit,
+		int minId,
 		FnMut<void(MTPmessages_Messages&&)> done);
 	void loadMessagesFiles(Data::MessagesSlice &&slice);
 	void loadNextMessageFile();
@@ -195,6 +204,7 @@ private:
 	MTP::ConcurrentSender _mtp;
 	std::optional<uint64> _takeoutId;
 	Output::Stats *_stats = nullptr;
+	IncrementalState *_incremental = nullptr;
 
 	std::unique_ptr<Settings> _settings;
 	MTPInputUser _user = MTP_inputUserSelf();
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "export/export_api_wrap.h"
 #include "export/export_settings.h"
+#include "export/export_incremental.h"
 #include "export/data/export_data_types.h"
 #include "export/output/export_output_abstract.h"
 #include "export/output/export_output_result.h"
@@ -60,6 +61,8 @@ private:
 	void ioError(const QString &path);
 	bool ioCatchError(Output::Result result);
 	void setFinishedState();
+	bool loadIncrementalState();
+	bool saveIncrementalState();
 
 	//void requestPasswordState();
 	//void passwordStateDone(const MTPaccount_Password &password);
@@ -116,6 +119,8 @@ private:
 	rpl::event_stream<State> _stateChanges;
 
 	Output::Stats _stats;
+	IncrementalState _incremental;
+	QString _incrementalPath;
 
 	std::vector<int> _substepsInStep;
 	int _substepsTotal = 0;
@@ -237,6 +242,15 @@ void Controller::startExport(
 	_settings = NormalizeSettings(settings);
 	_environment = environment;
 
+	if (_settings.incremental) {
+		// Keep the state in the root folder, write each delta
+		// export to a new dated sub folder next to it.
+		_settings.forceSubPath = true;
+		_incrementalPath = IncrementalState::FilePath(_settings.path);
+		if (!loadIncrementalState()) {
+			return;
+		}
+	}
 	_settings.path = Output::NormalizePath(_settings);
 	_writer = Output::CreateWriter(_settings.format);
 	fillExportSteps();
@@ -313,6 +327,8 @@ void Controller::exportNext() {
 	if (++_stepIndex >= _steps.size()) {
 		if (ioCatchError(_writer->finish())) {
 			return;
+		} else if (!saveIncrementalState()) {
+			return;
 		}
 		_api.finishExport([=] {
 			setFinishedState();
@@ -336,7 +352,7 @@ void Controller::exportNext() {
 
 void Controller::initialize() {
 	setState(stateInitializing());
-	_api.startExport(_settings, &_stats, [=](ApiWrap::StartInfo info) {
+	_api.startExport(_settings, &_stats, &_incremental, [=](ApiWrap::StartInfo info) {
 		initialized(info);
 	});
 }
@@ -578,6 +594,28 @@ int Controller::substepsInStep(Step step) const {
 	return _substepsInStep[static_cast<int>(step)];
 }
 
+bool Controller::loadIncrementalState() {
+	Expects(_settings.incremental);
+
+	auto loaded = IncrementalState::Load(_incrementalPath);
+	if (!loaded) {
+		ioError(_incrementalPath);
+		return false;
+	}
+	_incremental = std::move(*loaded);
+	return true;
+}
+
+bool Controller::saveIncrementalState() {
+	if (!_settings.incremental) {
+		return true;
+	} else if (!_incremental.save(_incrementalPath)) {
+		ioError(_incrementalPath);
+		return false;
+	}
+	return true;
+}
+
 void Controller::setFinishedState() {
 	setState(FinishedState{
 		_writer->mainFilePath(),
@@ -0,0 +1,149 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "export/export_incremental.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QJsonArray>
+
+namespace Export {
+namespace {
+
+constexpr auto kVersion = 1;
+constexpr auto kFileName = "export_incremental.json";
+
+} // namespace
+
+QString IncrementalState::FilePath(const QString &folder) {
+	return (folder.endsWith('/') ? folder : (folder + '/')) + kFileName;
+}
+
+std::optional<IncrementalState> IncrementalState::Load(
+		const QString &path) {
+	QFile file(path);
+	if (!file.exists()) {
+		return IncrementalState();
+	} else if (!file.open(QIODevice::ReadOnly)) {
+		return std::nullopt;
+	}
+	auto error = QJsonParseError{ 0, QJsonParseError::NoError };
+	const auto document = QJsonDocument::fromJson(file.readAll(), &error);
+	if (error.error != QJsonParseError::NoError || !document.isObject()) {
+		return std::nullopt;
+	}
+	const auto root = document.object();
+	if (root.value("version").toInt() != kVersion) {
+		return std::nullopt;
+	}
+	auto result = IncrementalState();
+	for (const auto &value : root.value("userpics").toArray()) {
+		auto ok = false;
+		const auto photoId = value.toString().toULongLong(&ok);
+		if (!ok) {
+			return std::nullopt;
+		}
+		result.exportedUserpic(photoId);
+	}
+	for (const auto &value : root.value("peers").toArray()) {
+		const auto entry = value.toObject();
+		auto ok = false;
+		const auto peerId = entry.value("peer").toString().toULongLong(&ok);
+		const auto splitKey = entry.value("split").toInt();
+		const auto messageId = entry.value("last_id").toInt();
+		if (!ok || !peerId || messageId <= 0) {
+			return std::nullopt;
+		}
+		result.exported(peerId, splitKey, messageId);
+	}
+	return result;
+}
+
+bool IncrementalState::save(const QString &path) const {
+	auto peers = QJsonArray();
+	for (const auto &[key, messageId] : _lastIds) {
+		auto entry = QJsonObject();
+		entry.insert("peer", QString::number(key.first));
+		entry.insert("split", key.second);
+		entry.insert("last_id", messageId);
+		peers.append(entry);
+	}
+	auto userpics = QJsonArray();
+	for (const auto photoId : _userpics) {
+		userpics.append(QString::number(photoId));
+	}
+	auto root = QJsonObject();
+	root.insert("version", kVersion);
+	root.insert("peers", peers);
+	root.insert("userpics", userpics);
+
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+	const auto bytes = QJsonDocument(root).toJson(QJsonDocument::Indented);
+	if (file.write(bytes) != bytes.size()) {
+		file.cancelWriting();
+		return false;
+	}
+	return file.commit();
+}
+
+bool IncrementalState::empty() const {
+	return _lastIds.empty() && _userpics.empty();
+}
+
+int32 IncrementalState::lastExportedId(
+		PeerId peerId,
+		int32 splitKey) const {
+	const auto i = _lastIds.find(std::make_pair(peerId, splitKey));
+	return (i != end(_lastIds)) ? i->second : 0;
+}
+
+void IncrementalState::exported(
+		PeerId peerId,
+		int32 splitKey,
+		int32 messageId) {
+	auto &lastId = _lastIds[std::make_pair(peerId, splitKey)];
+	lastId = std::max(lastId, messageId);
+}
+
+bool IncrementalState::userpicExported(uint64 photoId) const {
+	return _userpics.contains(photoId);
+}
+
+void IncrementalState::exportedUserpic(uint64 photoId) {
+	_userpics.emplace(photoId);
+}
+
+NewMessagesCount CountNewMessages(
+		const std::vector<int32> &ids,
+		int32 lastExportedId,
+		int counted,
+		bool lastSlice,
+		int sliceLimit) {
+	auto result = NewMessagesCount{ counted };
+	auto largestId = 0;
+	for (const auto id : ids) {
+		if (id > lastExportedId) {
+			++result.count;
+		}
+		largestId = std::max(largestId, id);
+	}
+	if (!lastSlice && int(ids.size()) >= sliceLimit && largestId) {
+		result.nextOffsetId = largestId + 1;
+	}
+	return result;
+}
+
+int32 NewMessagesOffsetId(int32 largestIdPlusOne, int32 lastExportedId) {
+	return std::max(largestIdPlusOne, lastExportedId + 1);
+}
+
+} // namespace Export
@@ -0,0 +1,69 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+#include "base/flat_map.h"
+#include "base/flat_set.h"
+
+#include <QtCore/QString>
+
+#include <vector>
+
+namespace Export {
+
+// Remembers the largest exported message id for each (peer, split) pair,
+// so that the next incremental export requests only newer messages.
+// Userpics are not ordered by id, so all exported photo ids are kept.
+//
+// Splits are identified by the min_id of their MTPMessageRange, because
+// split indices may shift when the server adds new splits.
+class IncrementalState {
+public:
+	using PeerId = uint64;
+
+	static QString FilePath(const QString &folder);
+
+	// Returns an empty state if the file doesn't exist.
+	// Returns std::nullopt if the file exists, but can't be parsed.
+	static std::optional<IncrementalState> Load(const QString &path);
+	bool save(const QString &path) const;
+
+	bool empty() const;
+	int32 lastExportedId(PeerId peerId, int32 splitKey) const;
+	void exported(PeerId peerId, int32 splitKey, int32 messageId);
+
+	bool userpicExported(uint64 photoId) const;
+	void exportedUserpic(uint64 photoId);
+
+private:
+	base::flat_map<std::pair<PeerId, int32>, int32> _lastIds;
+	base::flat_set<uint64> _userpics;
+
+};
+
+// History slices for counting new messages are requested upwards from
+// offset_id with add_offset == -limit. The count in messagesSlice is the
+// whole history size even with min_id, so the new ones are counted here.
+struct NewMessagesCount {
+	int count = 0;
+	int32 nextOffsetId = 0; // Zero if the counting is finished.
+};
+
+NewMessagesCount CountNewMessages(
+	const std::vector<int32> &ids,
+	int32 lastExportedId,
+	int counted,
+	bool lastSlice,
+	int sliceLimit);
+
+// The first slice of an incremental export starts right after the last
+// exported message, the following ones right after the previous slice.
+int32 NewMessagesOffsetId(int32 largestIdPlusOne, int32 lastExportedId);
+
+} // namespace Export
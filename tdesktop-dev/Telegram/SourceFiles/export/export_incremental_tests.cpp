@@ -0,0 +1,176 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "export/export_incremental.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QDir>
+
+namespace {
+
+using Export::IncrementalState;
+
+constexpr auto kSliceLimit = 100;
+
+// Plays the server part of messages.getHistory for a single chat.
+class History {
+public:
+	void add(int32 messageId) {
+		_list.push_back(messageId);
+	}
+
+	// offset_id / add_offset == -limit / limit / min_id request,
+	// like the one ApiWrap sends to count and load new messages.
+	std::vector<int32> slice(int32 offsetId, int32 minId) const {
+		auto result = std::vector<int32>();
+		for (const auto id : _list) {
+			if (id >= offsetId
+				&& id > minId
+				&& int(result.size()) < kSliceLimit) {
+				result.push_back(id);
+			}
+		}
+		return result;
+	}
+
+	int32 lastId() const {
+		return _list.empty() ? 0 : _list.back();
+	}
+
+private:
+	std::vector<int32> _list; // Oldest first.
+
+};
+
+struct CountResult {
+	int count = 0;
+	int requests = 0;
+};
+
+CountResult CountNew(const History &history, int32 lastExportedId) {
+	auto result = CountResult();
+	auto offsetId = Export::NewMessagesOffsetId(0, lastExportedId);
+	while (true) {
+		++result.requests;
+		const auto ids = history.slice(offsetId, lastExportedId);
+		const auto counted = Export::CountNewMessages(
+			ids,
+			lastExportedId,
+			result.count,
+			false,
+			kSliceLimit);
+		result.count = counted.count;
+		if (!counted.nextOffsetId) {
+			return result;
+		}
+		offsetId = counted.nextOffsetId;
+	}
+}
+
+} // namespace
+
+TEST_CASE("incremental export counts only new messages", "[export]") {
+	auto history = History();
+	for (auto id = 1; id != 8; ++id) {
+		history.add(id);
+	}
+	const auto lastExportedId = history.lastId();
+
+	SECTION("nothing is counted without new messages") {
+		const auto counted = CountNew(history, lastExportedId);
+		REQUIRE(counted.count == 0);
+		REQUIRE(counted.requests == 1);
+	}
+
+	SECTION("only the newer messages are counted") {
+		history.add(10);
+		history.add(11);
+		const auto counted = CountNew(history, lastExportedId);
+		REQUIRE(counted.count == 2);
+		REQUIRE(counted.requests == 1);
+	}
+
+	SECTION("new messages are counted across several slices") {
+		for (auto id = 8; id != 258; ++id) {
+			history.add(id);
+		}
+		const auto counted = CountNew(history, lastExportedId);
+		REQUIRE(counted.count == 250);
+		REQUIRE(counted.requests == 3);
+	}
+
+	SECTION("the last slice stops the counting") {
+		const auto counted = Export::CountNewMessages(
+			std::vector<int32>(kSliceLimit, 10),
+			lastExportedId,
+			5,
+			true,
+			kSliceLimit);
+		REQUIRE(counted.count == 5 + kSliceLimit);
+		REQUIRE(counted.nextOffsetId == 0);
+	}
+}
+
+TEST_CASE("incremental export slices start after the last one", "[export]") {
+	REQUIRE(Export::NewMessagesOffsetId(0, 0) == 1);
+	REQUIRE(Export::NewMessagesOffsetId(0, 7) == 8);
+	REQUIRE(Export::NewMessagesOffsetId(108, 7) == 108);
+}
+
+TEST_CASE("incremental export remembers exported userpics", "[export]") {
+	auto state = IncrementalState();
+	REQUIRE(!state.userpicExported(0xFFFFFFFF00000001ULL));
+
+	state.exportedUserpic(0xFFFFFFFF00000001ULL);
+	state.exportedUserpic(5);
+	REQUIRE(!state.empty());
+	REQUIRE(state.userpicExported(0xFFFFFFFF00000001ULL));
+	REQUIRE(state.userpicExported(5));
+	REQUIRE(!state.userpicExported(6));
+}
+
+TEST_CASE("incremental export state is persistent", "[export]") {
+	const auto folder = QDir::currentPath() + "/export_incremental_test";
+	QDir(folder).removeRecursively();
+	QDir().mkpath(folder);
+	const auto path = IncrementalState::FilePath(folder);
+
+	SECTION("missing file gives empty state") {
+		const auto loaded = IncrementalState::Load(path);
+		REQUIRE(loaded.has_value());
+		REQUIRE(loaded->empty());
+	}
+
+	SECTION("state survives save and load") {
+		auto state = IncrementalState();
+		state.exported(0xFFFFFFFF00000001ULL, 1, 100);
+		state.exported(0xFFFFFFFF00000001ULL, 1, 50);
+		state.exported(2, 200, 300);
+		state.exportedUserpic(0xFFFFFFFF00000002ULL);
+		REQUIRE(state.save(path));
+
+		const auto loaded = IncrementalState::Load(path);
+		REQUIRE(loaded.has_value());
+		REQUIRE(loaded->lastExportedId(0xFFFFFFFF00000001ULL, 1) == 100);
+		REQUIRE(loaded->lastExportedId(2, 200) == 300);
+		REQUIRE(loaded->lastExportedId(2, 1) == 0);
+		REQUIRE(loaded->userpicExported(0xFFFFFFFF00000002ULL));
+		REQUIRE(!loaded->userpicExported(2));
+	}
+
+	SECTION("broken file is reported") {
+		QFile file(path);
+		REQUIRE(file.open(QIODevice::WriteOnly));
+		file.write("{ broken");
+		file.close();
+		REQUIRE(!IncrementalState::Load(path).has_value());
+	}
+
+	QDir(folder).removeRecursively();
+}
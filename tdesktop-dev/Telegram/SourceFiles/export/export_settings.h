@@ -83,6 +83,10 @@ struct Settings {
 
 	TimeId availableAt = 0;
 
+	// Export only messages newer than the ones exported last time
+	// to the same path, each run goes to a new dated sub folder.
+	bool incremental = false;
+
 	bool onlySinglePeer() const {
 		return singlePeer.type() != mtpc_inputPeerEmpty;
 	}
@@ -76,6 +76,8 @@ private:
 		not_null<Ui::VerticalLayout*> container);
 	void addLimitsLabel(
 		not_null<Ui::VerticalLayout*> container);
+	void addIncrementalOption(
+		not_null<Ui::VerticalLayout*> container);
 	void chooseFolder();
 	void refreshButtons(
 		not_null<Ui::RpWidget*> container,
@@ -27,6 +27,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history_media.h"
 #include "styles/style_history.h"
 #include "data/data_session.h"
+#include "mtproto/mtp_trace.h"
 
 namespace App {
 namespace internal {
@@ -483,6 +484,12 @@ void ComputeDebugMode() {
 	}
 }
 
+void ComputeTraceMode() {
+	if (QFile(cWorkingDir() + qsl("tdata/withtrace")).exists()) {
+		MTP::Trace::SetEnabled(true);
+	}
+}
+
 void ComputeInstallBetaVersions() {
 	const auto installBetaSettingPath = InstallBetaVersionsSettingPath();
 	if (cAlphaVersion()) {
@@ -523,6 +530,7 @@ void WorkingDirReady() {
 
 	ComputeTestMode();
 	ComputeDebugMode();
+	ComputeTraceMode();
 	ComputeInstallBetaVersions();
 	ComputeUserTag();
 }
@@ -35,8 +35,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_feed.h"
 #include "ui/image/image.h"
 #include "ui/text_options.h"
+#include "ui/text/text_prepare.h"
 #include "core/crash_reports.h"
 
+#include <chrono>
+
 namespace {
 
 constexpr auto kStatusShowClientsideTyping = 6000;
@@ -54,6 +57,10 @@ constexpr auto kStatusShowClientsidePlayGame = 10000;
 constexpr auto kSetMyActionForMs = 10000;
 constexpr auto kNewBlockEachMessage = 50;
 constexpr auto kSkipCloudDraftsFor = TimeId(3);
+constexpr auto kRelayoutSliceDuration = std::chrono::milliseconds(8);
+constexpr auto kRelayoutSliceDelay = TimeMs(16);
+constexpr auto kPrepareTextMinLength = 512;
+constexpr auto kPrepareTextsMinCount = 2;
 
 void checkForSwitchInlineButton(HistoryItem *item) {
 	if (item->out() || !item->hasSwitchInlineButton()) {
@@ -332,7 +339,8 @@ History::History(const PeerId &peerId)
 , peer(App::peer(peerId))
 , cloudDraftTextCache(st::dialogsTextWidthMin)
 , _mute(Auth().data().notifyIsMuted(peer))
-, _sendActionText(st::dialogsTextWidthMin) {
+, _sendActionText(st::dialogsTextWidthMin)
+, _relayoutTimer([=] { relayoutStaleBlocks(); }) {
 	if (const auto user = peer->asUser()) {
 		if (user->botInfo) {
 			_outboxReadBefore = std::numeric_limits<MsgId>::max();
@@ -772,6 +780,8 @@ HistoryItem *History::createItem(
 
 std::vector<not_null<HistoryItem*>> History::createItems(
 		const QVector<MTPMessage> &data) {
+	prepareTexts(data);
+
 	auto result = std::vector<not_null<HistoryItem*>>();
 	result.reserve(data.size());
 	for (auto i = data.cend(), e = data.cbegin(); i != e;) {
@@ -780,9 +790,69 @@ std::vector<not_null<HistoryItem*>> History::createItems(
 			result.push_back(item);
 		}
 	}
+
+	// Some of the texts were not used, for example consumed by media.
+	_preparedTexts.clear();
 	return result;
 }
 
+void History::prepareTexts(const QVector<MTPMessage> &data) {
+	auto ids = std::vector<MsgId>();
+	auto prepared = std::vector<PreparedText>();
+	auto requests = std::vector<Ui::TextPrepareRequest>();
+	for (const auto &message : data) {
+		if (message.type() != mtpc_message) {
+			continue;
+		}
+		const auto &fields = message.c_message();
+		if (fields.vmessage.v.size() < kPrepareTextMinLength) {
+			continue;
+		}
+		const auto author = fields.is_post()
+			? peer
+			: fields.has_from_id()
+			? not_null<PeerData*>(App::user(fields.vfrom_id.v))
+			: peer;
+		const auto options = &Ui::ItemTextOptions(this, author);
+		auto text = TextWithEntities{
+			TextUtilities::Clean(qs(fields.vmessage)),
+			(fields.has_entities()
+				? TextUtilities::EntitiesFromMTP(fields.ventities.v)
+				: EntitiesInText())
+		};
+		ids.push_back(fields.vid.v);
+		prepared.push_back({ text.text, options });
+		requests.push_back({
+			&st::messageTextStyle,
+			std::move(text),
+			options,
+			int(st::msgMinWidth)
+		});
+	}
+	if (int(requests.size()) < kPrepareTextsMinCount) {
+		return;
+	}
+	auto texts = Ui::PrepareTexts(std::move(requests));
+	for (auto i = 0, count = int(texts.size()); i != count; ++i) {
+		prepared[i].text = std::move(texts[i]);
+		_preparedTexts.emplace(ids[i], std::move(prepared[i]));
+	}
+}
+
+std::optional<Text> History::takePreparedText(
+		MsgId msgId,
+		const QString &text,
+		not_null<const TextParseOptions*> options) {
+	auto prepared = _preparedTexts.take(msgId);
+	if (!prepared
+		|| prepared->options != options
+		|| prepared->original != text
+		|| prepared->text.isEmpty()) {
+		return std::nullopt;
+	}
+	return std::move(prepared->text);
+}
+
 not_null<HistoryItem*> History::addNewService(
 		MsgId msgId,
 		TimeId date,
@@ -2542,21 +2612,152 @@ HistoryItem *History::lastSentMessage() const {
 	return nullptr;
 }
 
-void History::resizeToWidth(int newWidth) {
+void History::resizeToWidth(int newWidth, int visibleHeight) {
 	const auto resizeAllItems = (_width != newWidth);
 
 	if (!resizeAllItems && !hasPendingResizedItems()) {
+		// Stale blocks of a hidden history are refined when it is shown.
+		if (_hasStaleBlocks && !_relayoutTimer.isActive()) {
+			_relayoutTimer.callOnce(kRelayoutSliceDelay);
+		}
 		return;
 	}
 	_flags &= ~(Flag::f_has_pending_resized_items);
 
+	const auto started = std::chrono::steady_clock::now();
+	const auto [relayoutFrom, relayoutTill] = countRelayoutRange(
+		visibleHeight);
+
 	_width = newWidth;
-	int y = 0;
-	for (const auto &block : blocks) {
+	auto measured = 0;
+	auto stale = 0;
+	auto y = 0;
+	for (auto i = 0, count = int(blocks.size()); i != count; ++i) {
+		const auto &block = blocks[i];
+		const auto relayout = (block->layoutWidth() != newWidth)
+			&& (!block->layoutWidth()
+				|| (i >= relayoutFrom && i < relayoutTill));
+		if (relayout) {
+			measured += block->messages.size();
+		} else if (block->layoutWidth() != newWidth) {
+			++stale;
+		}
 		block->setY(y);
-		y += block->resizeGetHeight(newWidth, resizeAllItems);
+		y += block->resizeGetHeight(newWidth, relayout);
 	}
 	_height = y;
+
+	_hasStaleBlocks = (stale > 0);
+	if (_hasStaleBlocks) {
+		_relayoutTimer.callOnce(kRelayoutSliceDelay);
+	}
+	if (measured) {
+		const auto duration = std::chrono::duration_cast<
+			std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - started).count();
+		DEBUG_LOG(("History Relayout: %1 items in %2 us, %3 blocks stale."
+			).arg(measured
+			).arg(duration
+			).arg(stale));
+	}
+}
+
+int History::relayoutAnchorBlock() const {
+	Expects(!blocks.empty());
+
+	return scrollTopItem
+		? scrollTopItem->block()->indexInHistory()
+		: (int(blocks.size()) - 1);
+}
+
+std::pair<int, int> History::countRelayoutRange(int visibleHeight) const {
+	if (blocks.empty()) {
+		return { 0, 0 };
+	}
+
+	// Without scrollTopItem we're at the bottom of the history.
+	const auto anchor = relayoutAnchorBlock();
+	const auto count = int(blocks.size());
+	auto above = scrollTopItem ? visibleHeight : (2 * visibleHeight);
+	auto below = 2 * visibleHeight;
+	auto from = anchor;
+	auto till = anchor + 1;
+	while (from > 0 && above > 0) {
+		above -= blocks[--from]->height();
+	}
+	below -= blocks[anchor]->height();
+	while (till < count && below > 0) {
+		below -= blocks[till++]->height();
+	}
+	return { from, till };
+}
+
+bool History::shownInHistoryWidget() const {
+	const auto main = App::main();
+	const auto shown = main ? main->peer() : nullptr;
+	if (!shown) {
+		return false;
+	} else if (shown == peer) {
+		return true;
+	}
+	const auto from = shown->migrateFrom();
+	return from && (from == peer.get());
+}
+
+void History::relayoutStaleBlocks() {
+	if (blocks.empty() || !_width || !shownInHistoryWidget()) {
+		return;
+	}
+	const auto started = std::chrono::steady_clock::now();
+	const auto deadline = started + kRelayoutSliceDuration;
+
+	// Refine the blocks closest to the scroll anchor first.
+	const auto anchor = relayoutAnchorBlock();
+	const auto count = int(blocks.size());
+	auto measured = 0;
+	auto finished = true;
+	auto heightChanged = false;
+	for (auto step = 0; step != 2 * count; ++step) {
+		const auto shift = (step + 1) / 2;
+		const auto index = (step % 2) ? (anchor - shift) : (anchor + shift);
+		if (index < 0 || index >= count) {
+			continue;
+		}
+		const auto &block = blocks[index];
+		if (block->layoutWidth() == _width) {
+			continue;
+		} else if (measured && std::chrono::steady_clock::now() >= deadline) {
+			finished = false;
+			break;
+		}
+		const auto wasHeight = block->height();
+		if (block->resizeGetHeight(_width, true) != wasHeight) {
+			heightChanged = true;
+		}
+		measured += block->messages.size();
+	}
+	if (finished) {
+		_hasStaleBlocks = false;
+	}
+	if (!measured) {
+		return;
+	}
+	const auto duration = std::chrono::duration_cast<
+		std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - started).count();
+	DEBUG_LOG(("History Relayout: %1 stale items in %2 us, finished: %3."
+		).arg(measured
+		).arg(duration
+		).arg(Logs::b(finished)));
+
+	// Block positions and the scroll position anchored to scrollTopItem
+	// will be updated by the history widget in resizeToWidth().
+	if (heightChanged) {
+		Auth().data().requestHistoryResize(this);
+	}
+	if (!finished) {
+		_relayoutTimer.callOnce(kRelayoutSliceDelay);
+	}
 }
 
 ChannelId History::channelId() const {
@@ -2920,6 +3121,9 @@ HistoryBlock::HistoryBlock(not_null<History*> history)
 }
 
 int HistoryBlock::resizeGetHeight(int newWidth, bool resizeAllItems) {
+	if (resizeAllItems) {
+		_layoutWidth = newWidth;
+	}
 	auto y = 0;
 	for (const auto &message : messages) {
 		message->setY(y);
@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/timer.h"
 #include "base/variant.h"
 #include "base/flat_set.h"
+#include "base/flat_map.h"
 #include "base/flags.h"
 
 class History;
@@ -217,6 +218,12 @@ public:
 	void addOlderSlice(const QVector<MTPMessage> &slice);
 	void addNewerSlice(const QVector<MTPMessage> &slice);
 
+	// Returns the text parsed in advance for the message being created.
+	std::optional<Text> takePreparedText(
+		MsgId msgId,
+		const QString &text,
+		not_null<const TextParseOptions*> options);
+
 	void newItemAdded(not_null<HistoryItem*> item);
 
 	int countUnread(MsgId upTo);
@@ -267,7 +274,9 @@ public:
 	MsgId msgIdForRead() const;
 	HistoryItem *lastSentMessage() const;
 
-	void resizeToWidth(int newWidth);
+	// Measures only the blocks near the visible area immediately,
+	// other blocks keep their heights until relayoutStaleBlocks().
+	void resizeToWidth(int newWidth, int visibleHeight);
 	int height() const;
 
 	void itemRemoved(not_null<HistoryItem*> item);
@@ -427,6 +436,16 @@ private:
 
 	HistoryItem *addNewToLastBlock(const MTPMessage &msg, NewMessageType type);
 
+	// Blocks [from, till) around the scroll anchor, using current heights.
+	std::pair<int, int> countRelayoutRange(int visibleHeight) const;
+	int relayoutAnchorBlock() const;
+	void relayoutStaleBlocks();
+	bool shownInHistoryWidget() const;
+
+	// Parses texts of the long messages from a slice in parallel
+	// before the items for them are created in createItems().
+	void prepareTexts(const QVector<MTPMessage> &data);
+
 	// this method just removes a block from the blocks list
 	// when the last item from this block was detached and
 	// calls the required previousItemChanged()
@@ -530,6 +549,13 @@ private:
 	};
 	std::unique_ptr<BuildingBlock> _buildingFrontBlock;
 
+	struct PreparedText {
+		QString original;
+		const TextParseOptions *options = nullptr;
+		Text text;
+	};
+	base::flat_map<MsgId, PreparedText> _preparedTexts;
+
 	std::unique_ptr<Data::Draft> _localDraft, _cloudDraft;
 	std::unique_ptr<Data::Draft> _editDraft;
 	std::optional<QString> _lastSentDraftText;
@@ -547,6 +573,9 @@ private:
 
 	std::weak_ptr<AdminLog::LocalIdManager> _adminLogIdManager;
 
+	base::Timer _relayoutTimer;
+	bool _hasStaleBlocks = false;
+
  };
 
 class HistoryBlock {
@@ -564,6 +593,11 @@ public:
 	void refreshView(not_null<Element*> view);
 
 	int resizeGetHeight(int newWidth, bool resizeAllItems);
+
+	// Width for which all the items were measured, zero if never.
+	int layoutWidth() const {
+		return _layoutWidth;
+	}
 	int y() const {
 		return _y;
 	}
@@ -607,6 +641,7 @@ protected:
 
 	int _y = 0;
 	int _height = 0;
+	int _layoutWidth = 0;
 	int _indexInHistory = -1;
 
 };
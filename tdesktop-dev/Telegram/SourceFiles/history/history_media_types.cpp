@@ -1627,7 +1627,7 @@ void HistoryDocument::draw(Painter &p, const QRect &r, TextSelection selection,
 			if (wf->isEmpty()) {
 				wf = nullptr;
 				if (loaded) {
-					Local::countVoiceWaveform(_data);
+					Auth().data().waveforms().count(_data);
 				}
 			} else if (wf->at(0) < 0) {
 				wf = nullptr;
@@ -976,6 +976,13 @@ void HistoryMessage::setText(const TextWithEntities &textWithEntities) {
 
 	if (_media && _media->consumeMessageText(textWithEntities)) {
 		setEmptyText();
+	} else if (auto prepared = history()->takePreparedText(
+			id,
+			textWithEntities.text,
+			&Ui::ItemTextOptions(this))) {
+		_text = std::move(*prepared);
+		_textWidth = -1;
+		_textHeight = 0;
 	} else {
 		_text.setMarkedText(
 			st::messageTextStyle,
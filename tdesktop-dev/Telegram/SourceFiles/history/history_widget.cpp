@@ -374,6 +374,12 @@ HistoryWidget::HistoryWidget(
 			updateHistoryGeometry();
 		}
 	}, lifetime());
+	Auth().data().historyResizeRequest(
+	) | rpl::start_with_next([this](auto history) {
+		if (_list && (_history == history || _migrated == history)) {
+			updateHistoryGeometry();
+		}
+	}, lifetime());
 	Auth().data().itemViewRefreshRequest(
 	) | rpl::start_with_next([this](auto item) {
 		// While HistoryInner doesn't own item views we must refresh them
@@ -1822,6 +1828,7 @@ bool HistoryWidget::contentOverlapped(const QRect &globalRect) {
 }
 
 void HistoryWidget::updateReportSpamStatus() {
+	Local::readReportSpamStatuses();
 	if (!_peer || (_peer->isUser() && (_peer->id == Auth().userPeerId() || isNotificationsUser(_peer->id) || isServiceUser(_peer->id) || _peer->asUser()->botInfo))) {
 		setReportSpamStatus(dbiprsHidden);
 		return;
@@ -3063,9 +3070,7 @@ void HistoryWidget::chooseAttach() {
 				uploadFile(result.remoteContent, SendMediaType::File);
 			}
 		} else {
-			auto list = Storage::PrepareMediaList(
-				result.paths,
-				st::sendMediaPreviewSize);
+			auto list = Storage::PrepareMediaList(result.paths);
 			if (list.allFilesForCompress || list.albumIsPossible) {
 				confirmSendingFiles(std::move(list), CompressConfirm::Auto);
 			} else if (!showSendingFilesError(list)) {
@@ -3981,7 +3986,7 @@ bool HistoryWidget::confirmSendingFiles(
 		CompressConfirm compressed,
 		const QString &insertTextOnCancel) {
 	return confirmSendingFiles(
-		Storage::PrepareMediaList(files, st::sendMediaPreviewSize),
+		Storage::PrepareMediaList(files),
 		compressed,
 		insertTextOnCancel);
 }
@@ -4063,8 +4068,7 @@ bool HistoryWidget::confirmSendingFiles(
 
 	auto list = Storage::PrepareMediaFromImage(
 		std::move(image),
-		std::move(content),
-		st::sendMediaPreviewSize);
+		std::move(content));
 	return confirmSendingFiles(
 		std::move(list),
 		compressed,
@@ -4103,9 +4107,7 @@ bool HistoryWidget::confirmSendingFiles(
 	const auto hasImage = data->hasImage();
 
 	if (const auto urls = data->urls(); !urls.empty()) {
-		auto list = Storage::PrepareMediaList(
-			urls,
-			st::sendMediaPreviewSize);
+		auto list = Storage::PrepareMediaList(urls);
 		if (list.error != Storage::PreparedList::Error::NonLocalUrl) {
 			if (list.error == Storage::PreparedList::Error::None
 				|| !hasImage) {
@@ -4465,6 +4467,7 @@ void HistoryWidget::reportSpamDone(PeerData *peer, const MTPBool &result, mtpReq
 	if (req == _reportSpamRequest) {
 		_reportSpamRequest = 0;
 	}
+	Local::readReportSpamStatuses();
 	cRefReportSpamStatuses().insert(peer->id, dbiprsReportSent);
 	Local::writeReportSpamStatuses();
 	if (_peer == peer) {
@@ -4486,6 +4489,7 @@ bool HistoryWidget::reportSpamFail(const RPCError &error, mtpRequestId req) {
 
 void HistoryWidget::onReportSpamHide() {
 	if (_peer) {
+		Local::readReportSpamStatuses();
 		cRefReportSpamStatuses().insert(_peer->id, dbiprsHidden);
 		Local::writeReportSpamStatuses();
 
@@ -19,7 +19,7 @@ namespace Lang {
 namespace {
 
 const auto kSerializeVersionTag = qsl("#new");
-constexpr auto kSerializeVersion = 1;
+constexpr auto kSerializeVersion = 2;
 constexpr auto kDefaultLanguage = str_const("en");
 constexpr auto kCloudLangPackName = str_const("tdesktop");
 constexpr auto kCustomLanguage = str_const("#custom");
@@ -190,6 +190,111 @@ QString PluralCodeForCustom(
 	return DefaultLanguageId();
 }
 
+// Values of the keys set by the pack, already parsed, stored as a table
+// of offsets by LangKey, the UTF-16 data and a byte of flags per key.
+// Keys are numbered differently in other app versions, so the table is
+// used only by the same app version that has written it.
+struct CompiledHeader {
+	qint32 appVersion = 0;
+	qint32 keysCount = 0;
+	qint32 dataSize = 0;
+};
+
+QByteArray CompileValues(
+		const std::vector<QString> &values,
+		const std::vector<uchar> &set) {
+	Expects(values.size() == kLangKeysCount);
+	Expects(set.size() == kLangKeysCount);
+
+	auto header = CompiledHeader();
+	header.appVersion = AppVersion;
+	header.keysCount = kLangKeysCount;
+	for (auto i = 0; i != kLangKeysCount; ++i) {
+		if (set[i]) {
+			header.dataSize += values[i].size();
+		}
+	}
+	const auto offsetsSize = (kLangKeysCount + 1) * sizeof(quint32);
+	const auto dataSize = header.dataSize * sizeof(QChar);
+	auto result = QByteArray(
+		int(sizeof(CompiledHeader) + offsetsSize + dataSize + kLangKeysCount),
+		Qt::Uninitialized);
+	auto offsets = std::vector<quint32>();
+	offsets.reserve(kLangKeysCount + 1);
+	auto data = result.data() + sizeof(CompiledHeader) + offsetsSize;
+	auto offset = quint32(0);
+	for (auto i = 0; i != kLangKeysCount; ++i) {
+		offsets.push_back(offset);
+		if (set[i]) {
+			const auto &value = values[i];
+			memcpy(
+				data + offset * sizeof(QChar),
+				value.constData(),
+				value.size() * sizeof(QChar));
+			offset += value.size();
+		}
+	}
+	offsets.push_back(offset);
+	memcpy(result.data(), &header, sizeof(CompiledHeader));
+	memcpy(
+		result.data() + sizeof(CompiledHeader),
+		offsets.data(),
+		offsetsSize);
+	memcpy(data + dataSize, set.data(), kLangKeysCount);
+	return result;
+}
+
+bool FillFromCompiled(
+		const QByteArray &compiled,
+		std::vector<QString> &values,
+		std::vector<uchar> &set) {
+	Expects(values.size() == kLangKeysCount);
+	Expects(set.size() == kLangKeysCount);
+
+	const auto size = std::size_t(compiled.size());
+	auto header = CompiledHeader();
+	if (size < sizeof(CompiledHeader)) {
+		return false;
+	}
+	memcpy(&header, compiled.constData(), sizeof(CompiledHeader));
+	const auto offsetsSize = (kLangKeysCount + 1) * sizeof(quint32);
+	if (header.appVersion != AppVersion
+		|| header.keysCount != kLangKeysCount
+		|| header.dataSize < 0
+		|| size != sizeof(CompiledHeader)
+			+ offsetsSize
+			+ header.dataSize * sizeof(QChar)
+			+ kLangKeysCount) {
+		return false;
+	}
+	auto offsets = std::vector<quint32>(kLangKeysCount + 1);
+	memcpy(
+		offsets.data(),
+		compiled.constData() + sizeof(CompiledHeader),
+		offsetsSize);
+	if (offsets.front() != 0 || offsets.back() != quint32(header.dataSize)) {
+		return false;
+	}
+	for (auto i = 0; i != kLangKeysCount; ++i) {
+		if (offsets[i] > offsets[i + 1]) {
+			return false;
+		}
+	}
+	const auto data = reinterpret_cast<const QChar*>(
+		compiled.constData() + sizeof(CompiledHeader) + offsetsSize);
+	const auto flags = reinterpret_cast<const uchar*>(
+		data + header.dataSize);
+	for (auto i = 0; i != kLangKeysCount; ++i) {
+		if (flags[i]) {
+			set[i] = 1;
+			values[i] = QString(
+				data + offsets[i],
+				offsets[i + 1] - offsets[i]);
+		}
+	}
+	return true;
+}
+
 template <typename Save>
 void ParseKeyValue(
 		const QByteArray &key,
@@ -385,6 +490,10 @@ QByteArray Instance::serialize() const {
 		size += Serialize::bytearraySize(nonDefault.first)
 			+ Serialize::bytearraySize(nonDefault.second);
 	}
+	const auto compiled = _derived
+		? QByteArray()
+		: CompileValues(_values, _nonDefaultSet);
+	size += Serialize::bytearraySize(compiled);
 	const auto base = _base ? _base->serialize() : QByteArray();
 	size += Serialize::bytearraySize(base);
 
@@ -408,7 +517,7 @@ QByteArray Instance::serialize() const {
 		for (const auto &nonDefault : _nonDefaultValues) {
 			stream << nonDefault.first << nonDefault.second;
 		}
-		stream << base;
+		stream << compiled << base;
 	}
 	return result;
 }
@@ -437,7 +546,7 @@ void Instance::fillFromSerialized(
 			>> nonDefaultValuesCount;
 	} else {
 		stream >> serializeVersion;
-		if (serializeVersion == kSerializeVersion) {
+		if (serializeVersion == 1 || serializeVersion == kSerializeVersion) {
 			stream
 				>> id
 				>> pluralId
@@ -493,6 +602,15 @@ void Instance::fillFromSerialized(
 		nonDefaultStrings.push_back(key);
 		nonDefaultStrings.push_back(value);
 	}
+	QByteArray compiled;
+	if (!legacyFormat && serializeVersion >= 2) {
+		stream >> compiled;
+		if (stream.status() != QDataStream::Ok) {
+			LOG(("Lang Error: "
+				"Could not read data from serialized langpack."));
+			return;
+		}
+	}
 
 	_base = nullptr;
 	QByteArray base;
@@ -532,10 +650,22 @@ void Instance::fillFromSerialized(
 	_customFilePathRelative = customFilePathRelative;
 	_customFileContent = customFileContent;
 	LOG(("Lang Info: Loaded cached, keys: %1").arg(nonDefaultValuesCount));
+	const auto useCompiled = !_derived
+		&& !compiled.isEmpty()
+		&& FillFromCompiled(compiled, _values, _nonDefaultSet);
 	for (auto i = 0, count = nonDefaultValuesCount * 2; i != count; i += 2) {
-		applyValue(nonDefaultStrings[i], nonDefaultStrings[i + 1]);
+		if (useCompiled) {
+			_nonDefaultValues[nonDefaultStrings[i]] = nonDefaultStrings[i + 1];
+		} else {
+			applyValue(nonDefaultStrings[i], nonDefaultStrings[i + 1]);
+		}
 	}
 	updatePluralRules();
+
+	if (!_derived && !useCompiled && nonDefaultValuesCount > 0) {
+		// Write the parsed values for the next launch.
+		Local::writeLangPack();
+	}
 }
 
 void Instance::loadFromContent(const QByteArray &content) {
@@ -9,9 +9,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "platform/platform_specific.h"
 #include "mtproto/connection.h"
+#include "mtproto/mtp_trace.h"
 #include "core/crash_reports.h"
 #include "core/launcher.h"
 
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
 enum LogDataType {
 	LogDataMain,
 	LogDataDebug,
@@ -44,14 +49,247 @@ QString _logsFilePath(LogDataType type, const QString &postfix = QString()) {
 }
 
 int32 LogsStartIndexChosen = -1;
-QString _logsEntryStart() {
-	static int32 index = 0;
-	QDateTime tm(QDateTime::currentDateTime());
 
+int32 _logsThreadId() {
 	auto thread = qobject_cast<MTP::internal::Thread*>(QThread::currentThread());
-	auto threadId = thread ? thread->getThreadIndex() : 0;
+	return thread ? thread->getThreadIndex() : 0;
+}
+
+// Debug, tcp and mtp entries are formatted lazily on the writer thread.
+struct LogsEntry {
+	LogDataType type = LogDataDebug;
+	qint64 time = 0;
+	uint32 index = 0;
+	int32 threadId = 0;
+	int32 dc = 0;
+	const char *file = nullptr;
+	int32 line = 0;
+	QString text;
+};
+
+LogsEntry _logsEntry(LogDataType type, const QString &text) {
+	static std::atomic<uint32> index = 0;
+
+	auto result = LogsEntry();
+	result.type = type;
+	result.time = QDateTime::currentMSecsSinceEpoch();
+	result.index = ++index;
+	result.threadId = _logsThreadId();
+	result.text = text;
+	return result;
+}
+
+QString _logsEntryStart(const LogsEntry &entry) {
+	const auto tm = QDateTime::fromMSecsSinceEpoch(entry.time);
+	return QString("[%1 %2-%3]"
+	).arg(tm.toString("hh:mm:ss.zzz")
+	).arg(entry.threadId, 2, 10, QChar('0')
+	).arg(entry.index, 7, 10, QChar('0'));
+}
+
+QString _logsFormat(const LogsEntry &entry) {
+	switch (entry.type) {
+	case LogDataDebug: return entry.file
+		? QString("%1 %2 (%3 : %4)\n"
+		).arg(_logsEntryStart(entry)
+		).arg(entry.text
+		).arg(entry.file
+		).arg(entry.line)
+		: QString("%1 %2\n").arg(_logsEntryStart(entry)).arg(entry.text);
+	case LogDataTcp: return QString("%1 %2\n"
+		).arg(_logsEntryStart(entry)
+		).arg(entry.text);
+	case LogDataMtp: return QString("%1 (dc:%2) %3\n"
+		).arg(_logsEntryStart(entry)
+		).arg(entry.dc
+		).arg(entry.text);
+	}
+	Unexpected("Type in _logsFormat.");
+}
+
+// Single producer single consumer ring buffer of a single thread entries.
+class LogsQueue {
+public:
+	LogsQueue();
+
+	// Called only from the owning thread.
+	bool push(LogsEntry &&entry);
+	void finish();
+
+	// Called only from the writer thread.
+	template <typename Callback>
+	void popAll(Callback &&callback);
+	bool finished() const;
+
+private:
+	static constexpr auto kSize = uint32(4096);
+
+	std::unique_ptr<LogsEntry[]> _entries;
+	std::atomic<uint32> _head = 0;
+	std::atomic<uint32> _tail = 0;
+	std::atomic<bool> _finished = false;
+
+};
+
+LogsQueue::LogsQueue()
+: _entries(std::make_unique<LogsEntry[]>(kSize)) {
+	static_assert((kSize & (kSize - 1)) == 0, "kSize must be a power of 2.");
+}
+
+bool LogsQueue::push(LogsEntry &&entry) {
+	const auto tail = _tail.load(std::memory_order_relaxed);
+	const auto head = _head.load(std::memory_order_acquire);
+	if (tail - head >= kSize) {
+		return false;
+	}
+	_entries[tail & (kSize - 1)] = std::move(entry);
+	_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+void LogsQueue::finish() {
+	_finished.store(true, std::memory_order_release);
+}
+
+template <typename Callback>
+void LogsQueue::popAll(Callback &&callback) {
+	auto head = _head.load(std::memory_order_relaxed);
+	const auto tail = _tail.load(std::memory_order_acquire);
+	for (; head != tail; ++head) {
+		callback(std::move(_entries[head & (kSize - 1)]));
+	}
+	_head.store(head, std::memory_order_release);
+}
+
+bool LogsQueue::finished() const {
+	return _finished.load(std::memory_order_acquire);
+}
+
+// Collects entries from all the thread queues and writes them in batches.
+class LogsWriter {
+public:
+	explicit LogsWriter(Fn<void(LogDataType, const QString&)> write);
+	~LogsWriter();
+
+	void push(LogsEntry &&entry);
+
+private:
+	struct ThreadQueue {
+		~ThreadQueue();
+
+		std::shared_ptr<LogsQueue> queue;
+	};
+
+	not_null<LogsQueue*> currentQueue();
+	void run();
+	void drain();
+
+	Fn<void(LogDataType, const QString&)> _write;
+
+	// Producers lock it only once per thread, when registering a queue.
+	std::mutex _queuesMutex;
+	std::vector<std::shared_ptr<LogsQueue>> _queues;
+	QThreadStorage<ThreadQueue*> _threadQueue;
+
+	std::atomic<uint64> _dropped = 0;
+	uint64 _droppedReported = 0;
+
+	std::mutex _waitMutex;
+	std::condition_variable _wait;
+	bool _stopping = false;
+	std::thread _thread;
+
+};
+
+LogsWriter::ThreadQueue::~ThreadQueue() {
+	queue->finish();
+}
+
+LogsWriter::LogsWriter(Fn<void(LogDataType, const QString&)> write)
+: _write(std::move(write))
+, _thread([=] { run(); }) {
+}
+
+LogsWriter::~LogsWriter() {
+	{
+		std::unique_lock<std::mutex> lock(_waitMutex);
+		_stopping = true;
+	}
+	_wait.notify_one();
+	_thread.join();
+}
+
+not_null<LogsQueue*> LogsWriter::currentQueue() {
+	if (!_threadQueue.hasLocalData()) {
+		auto queue = std::make_shared<LogsQueue>();
+		{
+			std::unique_lock<std::mutex> lock(_queuesMutex);
+			_queues.push_back(queue);
+		}
+		_threadQueue.setLocalData(new ThreadQueue{ std::move(queue) });
+	}
+	return _threadQueue.localData()->queue.get();
+}
 
-	return QString("[%1 %2-%3]").arg(tm.toString("hh:mm:ss.zzz")).arg(QString("%1").arg(threadId, 2, 10, QChar('0'))).arg(++index, 7, 10, QChar('0'));
+void LogsWriter::push(LogsEntry &&entry) {
+	if (!currentQueue()->push(std::move(entry))) {
+		// Never block the producer, just count the lost entry.
+		_dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void LogsWriter::run() {
+	constexpr auto kWriteDelay = std::chrono::milliseconds(50);
+
+	auto lock = std::unique_lock<std::mutex>(_waitMutex);
+	while (!_stopping) {
+		_wait.wait_for(lock, kWriteDelay);
+		lock.unlock();
+		drain();
+		lock.lock();
+	}
+	lock.unlock();
+	drain();
+}
+
+void LogsWriter::drain() {
+	auto entries = std::vector<LogsEntry>();
+	{
+		std::unique_lock<std::mutex> lock(_queuesMutex);
+		for (auto i = begin(_queues); i != end(_queues);) {
+			const auto finished = (*i)->finished();
+			(*i)->popAll([&](LogsEntry &&entry) {
+				entries.push_back(std::move(entry));
+			});
+			if (finished) {
+				i = _queues.erase(i);
+			} else {
+				++i;
+			}
+		}
+	}
+	const auto dropped = _dropped.load(std::memory_order_relaxed);
+	if (entries.empty() && dropped == _droppedReported) {
+		return;
+	}
+
+	// Restore the global order of entries from different threads.
+	ranges::sort(entries, std::less<>(), &LogsEntry::index);
+
+	QString batches[LogDataCount];
+	for (const auto &entry : entries) {
+		batches[entry.type] += _logsFormat(entry);
+	}
+	if (dropped != _droppedReported) {
+		batches[LogDataDebug] += QString("[logs] %1 entries dropped.\n"
+		).arg(dropped - _droppedReported);
+		_droppedReported = dropped;
+	}
+	for (auto type = 0; type != LogDataCount; ++type) {
+		if (!batches[type].isEmpty()) {
+			_write(LogDataType(type), batches[type]);
+		}
+	}
 }
 
 class LogsDataFields {
@@ -63,6 +301,11 @@ public:
 		}
 	}
 
+	~LogsDataFields() {
+		// Flush pending entries before closing the files.
+		writer = nullptr;
+	}
+
 	bool openMain() {
 		return reopen(LogDataMain, 0, qsl("start"));
 	}
@@ -105,11 +348,27 @@ public:
 		file->flush();
 	}
 
+	void push(LogsEntry &&entry) {
+		// Entries are pushed from any thread, the writer is created once.
+		std::call_once(writerCreated, [&] {
+			writer = std::make_unique<LogsWriter>([=](
+					LogDataType type,
+					const QString &msg) {
+				write(type, msg);
+			});
+		});
+		writer->push(std::move(entry));
+	}
+
 private:
 	std::unique_ptr<QFile> files[LogDataCount];
 
 	int32 part = -1;
 
+	// Created lazily, when the first debug entry is written.
+	std::once_flag writerCreated;
+	std::unique_ptr<LogsWriter> writer;
+
 	bool reopen(LogDataType type, int32 dayIndex, const QString &postfix) {
 		if (files[type] && files[type]->isOpen()) {
 			if (type == LogDataMain) {
@@ -254,6 +513,16 @@ void _logsWrite(LogDataType type, const QString &msg) {
 	}
 }
 
+void _logsPush(LogsEntry &&entry) {
+	if (LogsData && LogsStartIndexChosen < 0) {
+		if (Logs::DebugEnabled()) {
+			LogsData->push(std::move(entry));
+		}
+	} else {
+		_logsWrite(entry.type, _logsFormat(entry));
+	}
+}
+
 namespace Logs {
 namespace {
 
@@ -446,6 +715,8 @@ void start(not_null<Core::Launcher*> launcher) {
 }
 
 void finish() {
+	MTP::Trace::Finish();
+
 	delete LogsData;
 	LogsData = 0;
 
@@ -491,6 +762,10 @@ bool instanceChecked() {
 	LogsInMemory = DeletedLogsInMemory;
 
 	DEBUG_LOG(("Debug logs started."));
+	if (MTP::Trace::Enabled()) {
+		QDir().mkpath(cWorkingDir() + qstr("DebugLogs"));
+		MTP::Trace::Start(cWorkingDir() + qstr("DebugLogs/trace.bin"));
+	}
 	LogsBeforeSingleInstanceChecked.clear();
 	return true;
 }
@@ -523,27 +798,14 @@ void writeMain(const QString &v) {
 	QString msg(QString("[%1.%2.%3 %4:%5:%6] %7\n").arg(tm.tm_year + 1900).arg(tm.tm_mon + 1, 2, 10, QChar('0')).arg(tm.tm_mday, 2, 10, QChar('0')).arg(tm.tm_hour, 2, 10, QChar('0')).arg(tm.tm_min, 2, 10, QChar('0')).arg(tm.tm_sec, 2, 10, QChar('0')).arg(v));
 	_logsWrite(LogDataMain, msg);
 
-	QString debugmsg(QString("%1 %2\n").arg(_logsEntryStart()).arg(v));
-	_logsWrite(LogDataDebug, debugmsg);
+	_logsPush(_logsEntry(LogDataDebug, v));
 }
 
 void writeDebug(const char *file, int32 line, const QString &v) {
-	const char *last = strstr(file, "/"), *found = 0;
-	while (last) {
-		found = last;
-		last = strstr(last + 1, "/");
-	}
-	last = strstr(file, "\\");
-	while (last) {
-		found = last;
-		last = strstr(last + 1, "\\");
-	}
-	if (found) {
-		file = found + 1;
-	}
-
-	QString msg(QString("%1 %2 (%3 : %4)\n").arg(_logsEntryStart()).arg(v).arg(file).arg(line));
-	_logsWrite(LogDataDebug, msg);
+	auto entry = _logsEntry(LogDataDebug, v);
+	entry.file = file;
+	entry.line = line;
+	_logsPush(std::move(entry));
 
 #ifdef Q_OS_WIN
 	//OutputDebugString(reinterpret_cast<const wchar_t *>(msg.utf16()));
@@ -555,13 +817,13 @@ void writeDebug(const char *file, int32 line, const QString &v) {
 }
 
 void writeTcp(const QString &v) {
-	QString msg(QString("%1 %2\n").arg(_logsEntryStart()).arg(v));
-	_logsWrite(LogDataTcp, msg);
+	_logsPush(_logsEntry(LogDataTcp, v));
 }
 
 void writeMtp(int32 dc, const QString &v) {
-	QString msg(QString("%1 (dc:%2) %3\n").arg(_logsEntryStart()).arg(dc).arg(v));
-	_logsWrite(LogDataMtp, msg);
+	auto entry = _logsEntry(LogDataMtp, v);
+	entry.dc = dc;
+	_logsPush(std::move(entry));
 }
 
 QString full() {
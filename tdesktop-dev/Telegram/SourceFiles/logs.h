@@ -29,6 +29,21 @@ void closeMain();
 
 void writeMain(const QString &v);
 
+namespace details {
+
+constexpr int BasenameOffset(const char *path) {
+	auto result = 0;
+	for (auto i = 0; path[i] != 0; ++i) {
+		if (path[i] == '/' || path[i] == '\\') {
+			result = i + 1;
+		}
+	}
+	return result;
+}
+
+} // namespace details
+
+// The file should be already a basename, see LOG_SOURCE_BASENAME.
 void writeDebug(const char *file, int32 line, const QString &v);
 void writeTcp(const QString &v);
 void writeMtp(int32 dc, const QString &v);
@@ -70,7 +85,10 @@ inline MemoryBuffer mb(const void *ptr, uint32 size) {
 #define LOG(msg) (Logs::writeMain(QString msg))
 //usage LOG(("log: %1 %2").arg(1).arg(2))
 
-#define DEBUG_LOG(msg) { if (Logs::DebugEnabled() || !Logs::started()) Logs::writeDebug(__FILE__, __LINE__, QString msg); }
+// The source file basename is computed at compile time.
+#define LOG_SOURCE_BASENAME (__FILE__ + std::integral_constant<int, Logs::details::BasenameOffset(__FILE__)>::value)
+
+#define DEBUG_LOG(msg) { if (Logs::DebugEnabled() || !Logs::started()) Logs::writeDebug(LOG_SOURCE_BASENAME, __LINE__, QString msg); }
 //usage DEBUG_LOG(("log: %1 %2").arg(1).arg(2))
 
 #define TCP_LOG(msg) { if (Logs::DebugEnabled() || !Logs::started()) Logs::writeTcp(QString msg); }
@@ -817,6 +817,7 @@ void MainWidget::deleteHistoryPart(DeleteHistoryRequest request, const MTPmessag
 
 	auto offset = d.voffset.v;
 	if (offset <= 0) {
+		Local::readReportSpamStatuses();
 		cRefReportSpamStatuses().remove(peer->id);
 		Local::writeReportSpamStatuses();
 		return;
@@ -3317,7 +3318,6 @@ void MainWidget::start() {
 	Auth().api().requestNotifySettings(MTP_inputNotifyChats());
 	Auth().api().requestNotifySettings(MTP_inputNotifyBroadcasts());
 
-	Local::readSavedPeers();
 	cSetOtherOnline(0);
 	Auth().user()->loadUserpic();
 
@@ -3515,6 +3515,7 @@ void MainWidget::incrementSticker(DocumentData *sticker) {
 	auto removedFromEmoji = std::vector<not_null<EmojiPtr>>();
 	auto index = it->stickers.indexOf(sticker);
 	if (index > 0) {
+		Auth().data().stickersEmojiIndex().invalidate(it.value());
 		if (it->dates.empty()) {
 			Auth().api().requestRecentStickersForce();
 		} else {
@@ -3552,6 +3553,7 @@ void MainWidget::incrementSticker(DocumentData *sticker) {
 		}
 
 		writeRecentStickers = true;
+		Auth().data().stickersEmojiIndex().invalidate(it.value());
 	}
 
 	// Remove that sticker from old recent, now it is in cloud recent stickers.
@@ -10,7 +10,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_document.h"
 #include "media/media_audio_ffmpeg_loader.h"
 #include "media/media_child_ffmpeg_loader.h"
+#include "media/media_audio_kernels.h"
 #include "media/media_audio_loaders.h"
+#include "media/media_audio_queue.h"
 #include "media/media_audio_track.h"
 #include "platform/platform_audio.h"
 #include "messenger.h"
@@ -298,7 +300,6 @@ namespace Player {
 namespace {
 
 constexpr auto kVolumeRound = 10000;
-constexpr auto kPreloadSamples = 2LL * kDefaultFrequency; // preload next part if less than 2 seconds remains
 constexpr auto kFadeDuration = TimeMs(500);
 constexpr auto kCheckPlaybackPositionTimeout = TimeMs(100); // 100ms per check audio position
 constexpr auto kCheckPlaybackPositionDelta = 2400LL; // update position called each 2400 samples
@@ -400,6 +401,8 @@ void Mixer::Track::clear() {
 		samplesCount[i] = 0;
 		bufferSamples[i] = QByteArray();
 	}
+	decoded = nullptr;
+	decodedTill = 0;
 
 	videoData = nullptr;
 	lastUpdateWhen = 0;
@@ -420,6 +423,10 @@ void Mixer::Track::started() {
 		samplesCount[i] = 0;
 		bufferSamples[i] = QByteArray();
 	}
+
+	// Samples pushed before the restart are left in the old queue.
+	decoded = std::make_shared<Audio::SamplesQueue>();
+	decodedTill = 0;
 }
 
 bool Mixer::Track::isStreamCreated() const {
@@ -479,6 +486,53 @@ int Mixer::Track::getNotQueuedBufferIndex() {
 	return -1;
 }
 
+int Mixer::Track::countNotQueuedBuffers() {
+	if (getNotQueuedBufferIndex() < 0) {
+		return 0;
+	}
+	return int(std::count(
+		std::begin(samplesCount),
+		std::end(samplesCount),
+		0));
+}
+
+// The fade in after a faded stop of the previous track is applied to the
+// samples before they are queued, so it doesn't depend on the Fader timer.
+void Mixer::Track::applyStartFade(QByteArray &samples, int64 samplesCount) {
+	const auto fadeLength = (kFadeDuration * frequency) / 1000LL;
+	const auto from = std::max(decodedTill, fadeStartPosition);
+	const auto till = std::min(
+		decodedTill + samplesCount,
+		fadeStartPosition + fadeLength);
+	if (from >= till) {
+		return;
+	}
+	const auto gain = [&](int64 position) {
+		const auto faded = position - fadeStartPosition;
+		return int((Audio::Kernels::kUnityGain * faded) / fadeLength);
+	};
+	const auto stereo = (format == AL_FORMAT_STEREO8)
+		|| (format == AL_FORMAT_STEREO16);
+	const auto channels = stereo ? 2 : 1;
+	const auto skip = (from - decodedTill) * channels;
+	const auto frames = int(till - from);
+	if (format == AL_FORMAT_MONO8 || format == AL_FORMAT_STEREO8) {
+		Audio::Kernels::ApplyGain(
+			reinterpret_cast<uchar*>(samples.data()) + skip,
+			frames,
+			channels,
+			gain(from),
+			gain(till));
+	} else {
+		Audio::Kernels::ApplyGain(
+			reinterpret_cast<int16*>(samples.data()) + skip,
+			frames,
+			channels,
+			gain(from),
+			gain(till));
+	}
+}
+
 void Mixer::Track::resetStream() {
 	if (isStreamCreated()) {
 		alSourceStop(stream.source);
@@ -1202,7 +1256,54 @@ Fader::Fader(QThread *thread) : QObject()
 void Fader::onInit() {
 }
 
+struct Fader::Feed {
+	Mixer::Track *track = nullptr;
+	std::shared_ptr<Audio::SamplesQueue> queue;
+	int buffers = 0;
+	std::vector<Audio::DecodedSamples> samples;
+};
+
+std::vector<Fader::Feed> Fader::prepareFeeds() {
+	auto result = std::vector<Feed>();
+
+	QMutexLocker lock(&AudioMutex);
+	if (!mixer()) return result;
+
+	const auto prepare = [&](AudioMsgId::Type type, int index) {
+		const auto track = mixer()->trackForType(type, index);
+		if (IsStopped(track->state.state)
+			|| !track->isStreamCreated()
+			|| !track->decoded) {
+			return;
+		}
+		const auto buffers = track->countNotQueuedBuffers();
+		if (buffers > 0) {
+			result.push_back({ track, track->decoded, buffers });
+		}
+	};
+	for (auto i = 0; i != kTogetherLimit; ++i) {
+		prepare(AudioMsgId::Type::Voice, i);
+		prepare(AudioMsgId::Type::Song, i);
+	}
+	prepare(AudioMsgId::Type::Video, 0);
+	return result;
+}
+
 void Fader::onTimer() {
+	// Only Fader fills the OpenAL buffers, so the buffers counted free
+	// stay free and the samples for them are popped without AudioMutex.
+	auto feeds = prepareFeeds();
+	for (auto &feed : feeds) {
+		while (int(feed.samples.size()) < feed.buffers) {
+			const auto samples = feed.queue->front();
+			if (!samples) {
+				break;
+			}
+			feed.samples.push_back(base::take(*samples));
+			feed.queue->pop();
+		}
+	}
+
 	QMutexLocker lock(&AudioMutex);
 	if (!mixer()) return;
 
@@ -1245,11 +1346,15 @@ void Fader::onTimer() {
 	auto hasFading = (_suppressAll || _suppressSongAnim);
 	auto hasPlaying = false;
 
-	auto updatePlayback = [this, &hasPlaying, &hasFading](AudioMsgId::Type type, int index, float64 volumeMultiplier, bool suppressGainChanged) {
+	auto updatePlayback = [this, &hasPlaying, &hasFading, &feeds](AudioMsgId::Type type, int index, float64 volumeMultiplier, bool suppressGainChanged) {
 		auto track = mixer()->trackForType(type, index);
-		if (IsStopped(track->state.state) || track->state.state == State::Paused || !track->isStreamCreated()) return;
+		if (IsStopped(track->state.state) || !track->isStreamCreated()) return;
 
-		auto emitSignals = updateOnePlayback(track, hasPlaying, hasFading, volumeMultiplier, suppressGainChanged);
+		// Paused tracks are fed as well, so that they resume with data.
+		auto emitSignals = feedOnePlayback(track, type, feeds);
+		if (!(emitSignals & EmitError) && track->state.state != State::Paused) {
+			emitSignals |= updateOnePlayback(track, hasPlaying, hasFading, volumeMultiplier, suppressGainChanged);
+		}
 		if (emitSignals & EmitError) emit error(track->state.id);
 		if (emitSignals & EmitStopped) emit audioStopped(track->state.id);
 		if (emitSignals & EmitPositionUpdated) emit playPositionUpdated(track->state.id);
@@ -1278,6 +1383,76 @@ void Fader::onTimer() {
 	}
 }
 
+int32 Fader::feedOnePlayback(
+		Mixer::Track *track,
+		AudioMsgId::Type type,
+		std::vector<Feed> &feeds) {
+	const auto feed = std::find_if(begin(feeds), end(feeds), [&](
+			const Feed &entry) {
+		return (entry.track == track);
+	});
+	// The samples taken from a replaced queue belong to the previous play.
+	if (feed == end(feeds) || feed->queue != track->decoded) {
+		return 0;
+	}
+
+	auto errorHappened = [this, track] {
+		if (Audio::PlaybackErrorHappened()) {
+			setStoppedState(track, State::StoppedAtError);
+			return true;
+		}
+		return false;
+	};
+
+	auto fed = false;
+	for (auto &samples : feed->samples) {
+		const auto bufferIndex = track->getNotQueuedBufferIndex();
+		if (errorHappened()) return EmitError;
+		if (bufferIndex < 0) { // Counted in prepareFeeds(), can't happen.
+			break;
+		}
+
+		auto &buffer = track->bufferSamples[bufferIndex];
+		buffer = base::take(samples.data);
+		track->samplesCount[bufferIndex] = samples.count;
+		track->bufferedLength += samples.count;
+
+		alBufferData(track->stream.buffers[bufferIndex], track->format, buffer.constData(), buffer.size(), track->frequency);
+		alSourceQueueBuffers(track->stream.source, 1, track->stream.buffers + bufferIndex);
+		if (errorHappened()) return EmitError;
+
+		fed = true;
+	}
+	if (!fed) {
+		return 0;
+	}
+
+	switch (track->state.state) {
+	case State::Starting:
+	case State::Resuming:
+	case State::Playing: break;
+	default: return 0;
+	}
+
+	// Start the source if it didn't have any data or ran out of it.
+	ALint state = AL_INITIAL;
+	alGetSourcei(track->stream.source, AL_SOURCE_STATE, &state);
+	if (errorHappened()) return EmitError;
+
+	if (state == AL_PLAYING
+		|| (state == AL_STOPPED && !internal::CheckAudioDeviceConnected())) {
+		return 0;
+	}
+
+	alSourcef(track->stream.source, AL_GAIN, ComputeVolume(type));
+	if (errorHappened()) return EmitError;
+
+	alSourcePlay(track->stream.source);
+	if (errorHappened()) return EmitError;
+
+	return 0;
+}
+
 int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasFading, float64 volumeMultiplier, bool volumeChanged) {
 	auto playing = false;
 	auto fading = false;
@@ -1315,7 +1490,8 @@ int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasF
 	}
 
 	auto fullPosition = track->bufferedPosition + positionInBuffered;
-	if (state != AL_PLAYING && !track->loading) {
+	auto allQueued = !track->decoded || !track->decoded->size();
+	if (state != AL_PLAYING && !track->loading && allQueued) {
 		if (fading || playing) {
 			fading = false;
 			playing = false;
@@ -1353,13 +1529,17 @@ int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasF
 				playing = true;
 			} break;
 			}
-		} else {
+		} else if (track->state.state != State::Starting) {
 			auto newGain = TimeMs(1000) * fadingForSamplesCount / float64(kFadeDuration * track->state.frequency);
 			if (track->state.state == State::Pausing || track->state.state == State::Stopping) {
 				newGain = 1. - newGain;
 			}
 			alSourcef(track->stream.source, AL_GAIN, newGain * volumeMultiplier);
 			if (errorHappened()) return EmitError;
+		} else if (volumeChanged) {
+			// The fade in is already applied to the samples.
+			alSourcef(track->stream.source, AL_GAIN, 1. * volumeMultiplier);
+			if (errorHappened()) return EmitError;
 		}
 	} else if (playing && state == AL_PLAYING) {
 		if (volumeChanged) {
@@ -1372,8 +1552,9 @@ int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasF
 		emitSignals |= EmitPositionUpdated;
 	}
 	if (playing || track->state.state == State::Starting || track->state.state == State::Resuming) {
-		if (!track->loaded && !track->loading) {
-			auto needPreload = (track->state.position + kPreloadSamples > track->bufferedPosition + track->bufferedLength);
+		if (!track->loaded && !track->loading && track->decoded) {
+			// Keep the queue full, so that Fader has the samples at hand.
+			auto needPreload = (track->decoded->size() < Audio::SamplesQueue::kCapacity);
 			if (needPreload) {
 				track->loading = true;
 				emitSignals |= EmitNeedToPreload;
@@ -1381,7 +1562,14 @@ int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasF
 		}
 	}
 	if (playing) hasPlaying = true;
-	if (fading) hasFading = true;
+	if (fading) {
+		// Only the gain driven fades need the frequent timer.
+		if (track->state.state == State::Starting) {
+			hasPlaying = true;
+		} else {
+			hasFading = true;
+		}
+	}
 
 	return emitSignals;
 }
@@ -1608,7 +1796,12 @@ FileMediaInformation::Song PrepareForSending(const QString &fname, const QByteAr
 
 class FFMpegWaveformCounter : public FFMpegLoader {
 public:
-	FFMpegWaveformCounter(const FileLocation &file, const QByteArray &data) : FFMpegLoader(file, data, bytes::vector()) {
+	FFMpegWaveformCounter(
+		const FileLocation &file,
+		const QByteArray &data,
+		Media::Audio::Kernels::Instructions instructions)
+	: FFMpegLoader(file, data, bytes::vector())
+	, _instructions(instructions) {
 	}
 
 	bool open(TimeMs positionMs) override {
@@ -1630,13 +1823,23 @@ public:
 
 		auto fmt = format();
 		auto peak = uint16(0);
-		auto callback = [&](uint16 sample) {
-			accumulate_max(peak, sample);
-			sumbytes += Media::Player::kWaveformSamplesCount;
-			if (sumbytes >= countbytes) {
-				sumbytes -= countbytes;
-				peaks.push_back(peak);
-				peak = 0;
+
+		// Each sample adds kWaveformSamplesCount to sumbytes and a peak is
+		// taken each countbytes, so the samples between two peaks are
+		// found at once and passed to the peak kernel in one span.
+		auto iterate = [&](const auto *samples, int count) {
+			while (count > 0) {
+				const auto left = (countbytes - sumbytes + Media::Player::kWaveformSamplesCount - 1) / Media::Player::kWaveformSamplesCount;
+				const auto part = int(std::min(left, int64(count)));
+				accumulate_max(peak, countPeak(samples, part));
+				sumbytes += part * Media::Player::kWaveformSamplesCount;
+				if (sumbytes >= countbytes) {
+					sumbytes -= countbytes;
+					peaks.push_back(peak);
+					peak = 0;
+				}
+				samples += part;
+				count -= part;
 			}
 		};
 		while (processed < countbytes) {
@@ -1651,11 +1854,14 @@ public:
 				continue;
 			}
 
-			auto sampleBytes = bytes::make_span(buffer);
 			if (fmt == AL_FORMAT_MONO8 || fmt == AL_FORMAT_STEREO8) {
-				Media::Audio::IterateSamples<uchar>(sampleBytes, callback);
+				iterate(
+					reinterpret_cast<const uchar*>(buffer.constData()),
+					buffer.size());
 			} else if (fmt == AL_FORMAT_MONO16 || fmt == AL_FORMAT_STEREO16) {
-				Media::Audio::IterateSamples<int16>(sampleBytes, callback);
+				iterate(
+					reinterpret_cast<const int16*>(buffer.constData()),
+					buffer.size() / int(sizeof(int16)));
 			}
 			processed += sampleSize() * samples;
 		}
@@ -1686,12 +1892,30 @@ public:
 	}
 
 private:
+	uint16 countPeak(const uchar *samples, int count) const {
+		return Media::Audio::Kernels::Peak(samples, count);
+	}
+	uint16 countPeak(const int16 *samples, int count) const {
+		return Media::Audio::Kernels::Peak(samples, count, _instructions);
+	}
+
+	Media::Audio::Kernels::Instructions _instructions;
 	VoiceWaveform result;
 
 };
 
 VoiceWaveform audioCountWaveform(const FileLocation &file, const QByteArray &data) {
-	FFMpegWaveformCounter counter(file, data);
+	return audioCountWaveform(
+		file,
+		data,
+		Media::Audio::Kernels::SupportedInstructions());
+}
+
+VoiceWaveform audioCountWaveform(
+		const FileLocation &file,
+		const QByteArray &data,
+		Media::Audio::Kernels::Instructions instructions) {
+	FFMpegWaveformCounter counter(file, data, instructions);
 	const auto positionMs = TimeMs(0);
 	if (counter.open(positionMs)) {
 		return counter.waveform();
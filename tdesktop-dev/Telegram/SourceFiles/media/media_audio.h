@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "storage/localimageloader.h"
+#include "media/media_audio_kernels.h"
 #include "base/bytes.h"
 
 struct VideoSoundData;
@@ -16,6 +17,8 @@ struct VideoSoundPart;
 namespace Media {
 namespace Audio {
 
+class SamplesQueue;
+
 // Thread: Main.
 void Start();
 void Finish();
@@ -184,6 +187,10 @@ private:
 		void ensureStreamCreated(AudioMsgId::Type type);
 
 		int getNotQueuedBufferIndex();
+		int countNotQueuedBuffers();
+
+		// Thread: Loaders. Must be locked: AudioMutex.
+		void applyStartFade(QByteArray &samples, int64 samplesCount);
 
 		~Track();
 
@@ -202,6 +209,12 @@ private:
 		int samplesCount[kBuffersCount] = { 0 };
 		QByteArray bufferSamples[kBuffersCount];
 
+		// Pushed by Loaders, moved to the OpenAL buffers by Fader.
+		// The queue is pushed and popped without AudioMutex, only
+		// the pointer is replaced under it.
+		std::shared_ptr<Audio::SamplesQueue> decoded;
+		int64 decodedTill = 0;
+
 		struct Stream {
 			uint32 source = 0;
 			uint32 buffers[kBuffersCount] = { 0 };
@@ -281,6 +294,12 @@ private:
 		EmitPositionUpdated = 0x04,
 		EmitNeedToPreload = 0x08,
 	};
+	struct Feed;
+
+	// Locks: AudioMutex.
+	std::vector<Feed> prepareFeeds();
+
+	int32 feedOnePlayback(Mixer::Track *track, AudioMsgId::Type type, std::vector<Feed> &feeds);
 	int32 updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasFading, float64 volumeMultiplier, bool volumeChanged);
 	void setStoppedState(Mixer::Track *track, State state = State::Stopped);
 
@@ -323,6 +342,10 @@ bool audioCheckError();
 } // namespace Media
 
 VoiceWaveform audioCountWaveform(const FileLocation &file, const QByteArray &data);
+VoiceWaveform audioCountWaveform(
+	const FileLocation &file,
+	const QByteArray &data,
+	Media::Audio::Kernels::Instructions instructions);
 
 namespace Media {
 namespace Audio {
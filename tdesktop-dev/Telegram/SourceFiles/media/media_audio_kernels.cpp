@@ -0,0 +1,290 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "media/media_audio_kernels.h"
+
+#include "base/assertion.h"
+
+#include <algorithm>
+
+#ifdef ARCH_CPU_X86_FAMILY
+#define TDESKTOP_AUDIO_KERNELS_X86
+
+#include <emmintrin.h>
+
+#ifdef COMPILER_MSVC
+#include <intrin.h>
+#define KERNELS_TARGET(name)
+#else // COMPILER_MSVC
+#include <cpuid.h>
+#define KERNELS_TARGET(name) __attribute__((target(name)))
+#endif // COMPILER_MSVC
+#endif // ARCH_CPU_X86_FAMILY
+
+// The gain of each frame is kept in 16.16 fixed point and is advanced
+// by the same step in both versions, the products are rounded the same
+// way as well, so the SIMD version gives exactly the scalar output.
+
+namespace Media {
+namespace Audio {
+namespace Kernels {
+namespace {
+
+constexpr auto kGainShift = 14;
+constexpr auto kGainRounding = (1 << (kGainShift - 1));
+constexpr auto kStepShift = 16;
+static_assert(
+	kUnityGain == (1 << kGainShift),
+	"Unity gain should keep the samples unchanged.");
+
+void ApplyGainScalar(
+		int16 *samples,
+		int frames,
+		int channels,
+		int32 gain,
+		int32 step) {
+	for (auto frame = 0; frame != frames; ++frame) {
+		const auto multiplier = (gain >> kStepShift);
+		for (auto channel = 0; channel != channels; ++channel) {
+			const auto value = int32(*samples) * multiplier;
+			*samples++ = int16((value + kGainRounding) >> kGainShift);
+		}
+		gain += step;
+	}
+}
+
+uint16 PeakScalar(const int16 *samples, int count) {
+	auto result = uint16(0);
+	for (auto i = 0; i != count; ++i) {
+		const auto value = int32(samples[i]);
+		result = std::max(result, uint16(value < 0 ? -value : value));
+	}
+	return result;
+}
+
+#ifdef TDESKTOP_AUDIO_KERNELS_X86
+
+// Eight samples are processed at once, so with stereo samples each
+// gain lane is repeated for both channels of a frame.
+KERNELS_TARGET("sse2") void ApplyGainSSE2(
+		int16 *samples,
+		int frames,
+		int channels,
+		int32 gain,
+		int32 step) {
+	const auto count = frames * channels;
+	const auto vectorized = (count & ~7);
+	if (vectorized > 0) {
+		int32 lanes[8];
+		for (auto i = 0; i != 8; ++i) {
+			lanes[i] = gain + (i / channels) * step;
+		}
+		auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes));
+		auto high = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(lanes + 4));
+		const auto increment = _mm_set1_epi32((8 / channels) * step);
+		const auto rounding = _mm_set1_epi32(kGainRounding);
+		for (auto i = 0; i != vectorized; i += 8) {
+			const auto pointer = reinterpret_cast<__m128i*>(samples + i);
+			const auto values = _mm_loadu_si128(pointer);
+			const auto multipliers = _mm_packs_epi32(
+				_mm_srai_epi32(low, kStepShift),
+				_mm_srai_epi32(high, kStepShift));
+			const auto productsLow = _mm_mullo_epi16(values, multipliers);
+			const auto productsHigh = _mm_mulhi_epi16(values, multipliers);
+			const auto first = _mm_srai_epi32(
+				_mm_add_epi32(
+					_mm_unpacklo_epi16(productsLow, productsHigh),
+					rounding),
+				kGainShift);
+			const auto second = _mm_srai_epi32(
+				_mm_add_epi32(
+					_mm_unpackhi_epi16(productsLow, productsHigh),
+					rounding),
+				kGainShift);
+			_mm_storeu_si128(pointer, _mm_packs_epi32(first, second));
+			low = _mm_add_epi32(low, increment);
+			high = _mm_add_epi32(high, increment);
+		}
+	}
+	const auto done = vectorized / channels;
+	ApplyGainScalar(
+		samples + vectorized,
+		frames - done,
+		channels,
+		gain + done * step,
+		step);
+}
+
+// There is no unsigned 16 bit maximum in SSE2, so the absolute values
+// are compared as signed ones with the highest bit flipped.
+KERNELS_TARGET("sse2") uint16 PeakSSE2(const int16 *samples, int count) {
+	const auto vectorized = (count & ~7);
+	const auto flip = _mm_set1_epi16(short(0x8000));
+	auto maximum = flip;
+	for (auto i = 0; i != vectorized; i += 8) {
+		const auto values = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(samples + i));
+		const auto sign = _mm_srai_epi16(values, 15);
+		const auto absolute = _mm_sub_epi16(
+			_mm_xor_si128(values, sign),
+			sign);
+		maximum = _mm_max_epi16(maximum, _mm_xor_si128(absolute, flip));
+	}
+	uint16 lanes[8];
+	_mm_storeu_si128(
+		reinterpret_cast<__m128i*>(lanes),
+		_mm_xor_si128(maximum, flip));
+	auto result = PeakScalar(samples + vectorized, count - vectorized);
+	for (const auto lane : lanes) {
+		result = std::max(result, lane);
+	}
+	return result;
+}
+
+void Cpuid(int result[4], int leaf) {
+#ifdef COMPILER_MSVC
+	__cpuidex(result, leaf, 0);
+#else // COMPILER_MSVC
+	auto a = 0U, b = 0U, c = 0U, d = 0U;
+	__cpuid_count(leaf, 0, a, b, c, d);
+	result[0] = int(a);
+	result[1] = int(b);
+	result[2] = int(c);
+	result[3] = int(d);
+#endif // COMPILER_MSVC
+}
+
+#endif // TDESKTOP_AUDIO_KERNELS_X86
+
+Instructions ComputeSupportedInstructions() {
+#ifdef TDESKTOP_AUDIO_KERNELS_X86
+	int info[4] = { 0 };
+	Cpuid(info, 0);
+	if (info[0] < 1) {
+		return Instructions::Scalar;
+	}
+	Cpuid(info, 1);
+	const auto sse2 = (info[3] & (1 << 26)) != 0;
+	return sse2 ? Instructions::SSE2 : Instructions::Scalar;
+#else // TDESKTOP_AUDIO_KERNELS_X86
+	return Instructions::Scalar;
+#endif // TDESKTOP_AUDIO_KERNELS_X86
+}
+
+int32 ComputeStep(int frames, int fromGain, int toGain) {
+	return int32(int64(toGain - fromGain) * (1 << kStepShift) / frames);
+}
+
+} // namespace
+
+Instructions SupportedInstructions() {
+	static const auto result = ComputeSupportedInstructions();
+	return result;
+}
+
+void ApplyGain(
+		int16 *samples,
+		int frames,
+		int channels,
+		int fromGain,
+		int toGain) {
+	ApplyGain(
+		samples,
+		frames,
+		channels,
+		fromGain,
+		toGain,
+		SupportedInstructions());
+}
+
+void ApplyGain(
+		int16 *samples,
+		int frames,
+		int channels,
+		int fromGain,
+		int toGain,
+		Instructions instructions) {
+	Expects(channels == 1 || channels == 2);
+	Expects(fromGain >= 0 && fromGain <= kUnityGain);
+	Expects(toGain >= 0 && toGain <= kUnityGain);
+
+	if (frames <= 0) {
+		return;
+	}
+	const auto gain = (int32(fromGain) << kStepShift);
+	const auto step = ComputeStep(frames, fromGain, toGain);
+
+#ifdef TDESKTOP_AUDIO_KERNELS_X86
+	switch (instructions) {
+	case Instructions::SSE2:
+		ApplyGainSSE2(samples, frames, channels, gain, step);
+		return;
+	case Instructions::Scalar:
+		break;
+	}
+#endif // TDESKTOP_AUDIO_KERNELS_X86
+	ApplyGainScalar(samples, frames, channels, gain, step);
+}
+
+void ApplyGain(
+		uchar *samples,
+		int frames,
+		int channels,
+		int fromGain,
+		int toGain) {
+	Expects(channels == 1 || channels == 2);
+	Expects(fromGain >= 0 && fromGain <= kUnityGain);
+	Expects(toGain >= 0 && toGain <= kUnityGain);
+
+	if (frames <= 0) {
+		return;
+	}
+	auto gain = (int32(fromGain) << kStepShift);
+	const auto step = ComputeStep(frames, fromGain, toGain);
+	for (auto frame = 0; frame != frames; ++frame) {
+		const auto multiplier = (gain >> kStepShift);
+		for (auto channel = 0; channel != channels; ++channel) {
+			const auto value = (int32(*samples) - 0x80) * multiplier;
+			*samples++ = uchar(((value + kGainRounding) >> kGainShift) + 0x80);
+		}
+		gain += step;
+	}
+}
+
+uint16 Peak(const int16 *samples, int count) {
+	return Peak(samples, count, SupportedInstructions());
+}
+
+uint16 Peak(const int16 *samples, int count, Instructions instructions) {
+	Expects(count >= 0);
+
+#ifdef TDESKTOP_AUDIO_KERNELS_X86
+	switch (instructions) {
+	case Instructions::SSE2:
+		return PeakSSE2(samples, count);
+	case Instructions::Scalar:
+		break;
+	}
+#endif // TDESKTOP_AUDIO_KERNELS_X86
+	return PeakScalar(samples, count);
+}
+
+uint16 Peak(const uchar *samples, int count) {
+	Expects(count >= 0);
+
+	auto result = uint16(0);
+	for (auto i = 0; i != count; ++i) {
+		const auto value = (int32(samples[i]) - 0x80) * 0x100;
+		result = std::max(result, uint16(value < 0 ? -value : value));
+	}
+	return result;
+}
+
+} // namespace Kernels
+} // namespace Audio
+} // namespace Media
@@ -0,0 +1,62 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+namespace Media {
+namespace Audio {
+namespace Kernels {
+
+// All the implementations give exactly the same output,
+// so the choice between them is made only by the speed.
+enum class Instructions {
+	Scalar,
+	SSE2,
+};
+
+// The best instruction set available on this processor.
+Instructions SupportedInstructions();
+
+// Gains are fixed point numbers, kUnityGain keeps the samples unchanged.
+constexpr auto kUnityGain = (1 << 14);
+
+// Multiplies interleaved mono or stereo samples by a gain that goes
+// linearly from fromGain at the first frame towards toGain after the last.
+void ApplyGain(
+	int16 *samples,
+	int frames,
+	int channels,
+	int fromGain,
+	int toGain);
+void ApplyGain(
+	int16 *samples,
+	int frames,
+	int channels,
+	int fromGain,
+	int toGain,
+	Instructions instructions);
+
+// The same for unsigned 8 bit samples, they are rare enough to stay scalar.
+void ApplyGain(
+	uchar *samples,
+	int frames,
+	int channels,
+	int fromGain,
+	int toGain);
+
+// The largest absolute value of the samples, -32768 gives 32768.
+uint16 Peak(const int16 *samples, int count);
+uint16 Peak(const int16 *samples, int count, Instructions instructions);
+
+// The same for unsigned 8 bit samples scaled to 16 bit ones.
+uint16 Peak(const uchar *samples, int count);
+
+} // namespace Kernels
+} // namespace Audio
+} // namespace Media
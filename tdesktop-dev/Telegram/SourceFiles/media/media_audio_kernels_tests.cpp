@@ -0,0 +1,258 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "media/media_audio_kernels.h"
+#include "media/media_audio_queue.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Media::Audio::Kernels::Instructions;
+using Media::Audio::Kernels::kUnityGain;
+
+constexpr auto kFrequency = 48000;
+constexpr auto kChannels = 2;
+constexpr auto kWavHeaderSize = 44;
+constexpr auto kPi = 3.14159265358979323846;
+
+std::vector<Instructions> AvailableInstructions() {
+	const auto supported = Media::Audio::Kernels::SupportedInstructions();
+	auto result = std::vector<Instructions>();
+	for (const auto instructions : { Instructions::SSE2 }) {
+		if (int(instructions) <= int(supported)) {
+			result.push_back(instructions);
+		}
+	}
+	return result;
+}
+
+std::vector<int16> RandomSamples(std::mt19937 &generator, int size) {
+	auto distribution = std::uniform_int_distribution<int>(-32768, 32767);
+	auto result = std::vector<int16>(size);
+	for (auto &sample : result) {
+		sample = int16(distribution(generator));
+	}
+	return result;
+}
+
+// Stereo sine wave, the right channel is the inverted left one.
+int16 SineSample(int64 frame, int channel) {
+	const auto value = std::sin(frame * 2. * kPi * 440. / kFrequency);
+	return int16(std::lround(value * 16000.) * (channel ? -1 : 1));
+}
+
+void AppendInt(QByteArray &data, uint32 value, int size) {
+	for (auto i = 0; i != size; ++i) {
+		const auto byte = char((value >> (8 * i)) & 0xFF);
+		data.append(&byte, 1);
+	}
+}
+
+// Writes the same header as any 16 bit PCM wave file has.
+QByteArray WavHeader(int frames) {
+	const auto dataSize = uint32(frames * kChannels * sizeof(int16));
+	auto result = QByteArray();
+	result.append("RIFF", 4);
+	AppendInt(result, kWavHeaderSize - 8 + dataSize, 4);
+	result.append("WAVEfmt ", 8);
+	AppendInt(result, 16, 4);
+	AppendInt(result, 1, 2);
+	AppendInt(result, kChannels, 2);
+	AppendInt(result, kFrequency, 4);
+	AppendInt(result, kFrequency * kChannels * sizeof(int16), 4);
+	AppendInt(result, kChannels * sizeof(int16), 2);
+	AppendInt(result, 16, 2);
+	result.append("data", 4);
+	AppendInt(result, dataSize, 4);
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("gain kernels give identical output", "[audio_kernels]") {
+	auto generator = std::mt19937(42);
+	auto gains = std::uniform_int_distribution<int>(0, kUnityGain);
+	for (const auto instructions : AvailableInstructions()) {
+		for (auto channels = 1; channels != 3; ++channels) {
+			for (auto frames = 0; frames != 70; ++frames) {
+				const auto original = RandomSamples(
+					generator,
+					frames * channels);
+				const auto from = gains(generator);
+				const auto to = gains(generator);
+
+				auto scalar = original;
+				Media::Audio::Kernels::ApplyGain(
+					scalar.data(),
+					frames,
+					channels,
+					from,
+					to,
+					Instructions::Scalar);
+				auto vector = original;
+				Media::Audio::Kernels::ApplyGain(
+					vector.data(),
+					frames,
+					channels,
+					from,
+					to,
+					instructions);
+				REQUIRE(vector == scalar);
+			}
+		}
+	}
+}
+
+TEST_CASE("gain kernels keep or mute the samples", "[audio_kernels]") {
+	auto generator = std::mt19937(42);
+	const auto original = RandomSamples(generator, 1000);
+	auto all = AvailableInstructions();
+	all.push_back(Instructions::Scalar);
+	for (const auto instructions : all) {
+		auto kept = original;
+		Media::Audio::Kernels::ApplyGain(
+			kept.data(),
+			500,
+			2,
+			kUnityGain,
+			kUnityGain,
+			instructions);
+		REQUIRE(kept == original);
+
+		auto muted = original;
+		Media::Audio::Kernels::ApplyGain(
+			muted.data(),
+			1000,
+			1,
+			0,
+			0,
+			instructions);
+		REQUIRE(muted == std::vector<int16>(1000, 0));
+	}
+
+	auto bytes = std::vector<uchar>{ 0x00, 0x40, 0x80, 0xFF };
+	Media::Audio::Kernels::ApplyGain(bytes.data(), 4, 1, 0, 0);
+	REQUIRE(bytes == std::vector<uchar>(4, 0x80));
+}
+
+TEST_CASE("peak kernels give identical output", "[audio_kernels]") {
+	auto generator = std::mt19937(42);
+	for (const auto instructions : AvailableInstructions()) {
+		for (auto count = 0; count != 70; ++count) {
+			auto samples = RandomSamples(generator, count);
+			if (count % 3 == 1) {
+				samples[count / 2] = -32768;
+			}
+			REQUIRE(Media::Audio::Kernels::Peak(
+				samples.data(),
+				count,
+				instructions) == Media::Audio::Kernels::Peak(
+					samples.data(),
+					count,
+					Instructions::Scalar));
+		}
+	}
+	const auto loudest = std::vector<int16>{ 5, -32768, 32767, 0 };
+	REQUIRE(Media::Audio::Kernels::Peak(loudest.data(), 4) == 32768);
+	const auto bytes = std::vector<uchar>{ 0x80, 0x00, 0xFF };
+	REQUIRE(Media::Audio::Kernels::Peak(bytes.data(), 3) == 0x8000);
+}
+
+TEST_CASE("fade in is mixed offline to a wave file", "[audio_kernels]") {
+	constexpr auto kChunkFrames = 1000;
+	constexpr auto kChunksCount = 40;
+	constexpr auto kFadeFrames = kFrequency / 2;
+	constexpr auto kTotalFrames = kChunkFrames * kChunksCount;
+
+	// The producer thread decodes, the consumer applies the fade in
+	// the same way Mixer::Track::applyStartFade does and writes.
+	auto queue = Media::Audio::SamplesQueue();
+	auto producer = std::thread([&] {
+		for (auto chunk = 0; chunk != kChunksCount; ++chunk) {
+			auto data = QByteArray(
+				kChunkFrames * kChannels * sizeof(int16),
+				Qt::Uninitialized);
+			auto samples = reinterpret_cast<int16*>(data.data());
+			for (auto i = 0; i != kChunkFrames; ++i) {
+				const auto frame = int64(chunk) * kChunkFrames + i;
+				for (auto channel = 0; channel != kChannels; ++channel) {
+					*samples++ = SineSample(frame, channel);
+				}
+			}
+			while (queue.full()) {
+				std::this_thread::yield();
+			}
+			queue.push({ std::move(data), kChunkFrames });
+		}
+	});
+
+	const auto path = QDir::currentPath() + "/audio_kernels_test.wav";
+	{
+		auto file = QFile(path);
+		REQUIRE(file.open(QIODevice::WriteOnly));
+		REQUIRE(file.write(WavHeader(kTotalFrames)) == kWavHeaderSize);
+
+		auto position = int64(0);
+		while (position < kTotalFrames) {
+			const auto samples = queue.front();
+			if (!samples) {
+				std::this_thread::yield();
+				continue;
+			}
+			const auto till = std::min(
+				position + samples->count,
+				int64(kFadeFrames));
+			if (position < till) {
+				const auto gain = [](int64 frame) {
+					return int((kUnityGain * frame) / kFadeFrames);
+				};
+				Media::Audio::Kernels::ApplyGain(
+					reinterpret_cast<int16*>(samples->data.data()),
+					int(till - position),
+					kChannels,
+					gain(position),
+					gain(till));
+			}
+			REQUIRE(file.write(samples->data) == samples->data.size());
+			position += samples->count;
+			queue.pop();
+		}
+	}
+	producer.join();
+	REQUIRE(queue.front() == nullptr);
+
+	auto file = QFile(path);
+	REQUIRE(file.open(QIODevice::ReadOnly));
+	const auto dataSize = kTotalFrames * kChannels * int(sizeof(int16));
+	REQUIRE(file.size() == kWavHeaderSize + dataSize);
+	const auto header = file.read(kWavHeaderSize);
+	REQUIRE(header == WavHeader(kTotalFrames));
+
+	const auto data = file.read(dataSize);
+	REQUIRE(data.size() == dataSize);
+	auto samples = std::vector<int16>(kTotalFrames * kChannels);
+	memcpy(samples.data(), data.constData(), dataSize);
+	for (auto frame = 0; frame != kTotalFrames; ++frame) {
+		const auto fade = std::min(frame / double(kFadeFrames), 1.);
+		for (auto channel = 0; channel != kChannels; ++channel) {
+			const auto expected = SineSample(frame, channel) * fade;
+			const auto sample = samples[frame * kChannels + channel];
+			REQUIRE(std::abs(sample - expected) <= 2.);
+		}
+	}
+	REQUIRE(file.remove());
+}
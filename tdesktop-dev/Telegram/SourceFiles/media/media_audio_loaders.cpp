@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "media/media_audio.h"
 #include "media/media_audio_ffmpeg_loader.h"
+#include "media/media_audio_queue.h"
 #include "media/media_child_ffmpeg_loader.h"
 
 namespace Media {
@@ -180,103 +181,81 @@ void Loaders::loadData(AudioMsgId audio, TimeMs positionMs) {
 		}
 	}
 
-	QMutexLocker lock(internal::audioPlayerMutex());
-	auto track = checkLoader(type);
-	if (!track) {
-		clear(type);
-		return;
-	}
-
-	if (started) {
-		Audio::AttachToDevice();
-
-		track->started();
-		if (!internal::audioCheckError()) {
-			setStoppedState(track, State::StoppedAtStart);
-			emitError(type);
+	auto queue = std::shared_ptr<Audio::SamplesQueue>();
+	{
+		QMutexLocker lock(internal::audioPlayerMutex());
+		auto track = checkLoader(type);
+		if (!track) {
+			clear(type);
 			return;
 		}
 
-		track->format = l->format();
-		track->frequency = l->samplesFrequency();
+		if (started) {
+			Audio::AttachToDevice();
 
-		const auto position = (positionMs * track->frequency) / 1000LL;
-		track->bufferedPosition = position;
-		track->state.position = position;
-		track->fadeStartPosition = position;
-	}
-	if (samplesCount) {
-		track->ensureStreamCreated(type);
+			track->started();
+			if (!internal::audioCheckError()) {
+				setStoppedState(track, State::StoppedAtStart);
+				emitError(type);
+				return;
+			}
 
-		auto bufferIndex = track->getNotQueuedBufferIndex();
+			track->format = l->format();
+			track->frequency = l->samplesFrequency();
 
-		if (!internal::audioCheckError()) {
-			setStoppedState(track, State::StoppedAtError);
-			emitError(type);
-			return;
+			const auto position = (positionMs * track->frequency) / 1000LL;
+			track->bufferedPosition = position;
+			track->state.position = position;
+			track->fadeStartPosition = position;
+			track->decodedTill = position;
 		}
+		if (samplesCount) {
+			track->ensureStreamCreated(type);
+			if (!internal::audioCheckError()) {
+				setStoppedState(track, State::StoppedAtError);
+				emitError(type);
+				return;
+			}
 
-		if (bufferIndex < 0) { // No free buffers, wait.
-			l->saveDecodedSamples(&samples, &samplesCount);
-			return;
-		}
+			if (track->decoded->full()) { // Fader didn't take the samples yet.
+				l->saveDecodedSamples(&samples, &samplesCount);
+				track->loading = false;
+				return;
+			}
 
-		track->bufferSamples[bufferIndex] = samples;
-		track->samplesCount[bufferIndex] = samplesCount;
-		track->bufferedLength += samplesCount;
-		alBufferData(track->stream.buffers[bufferIndex], track->format, samples.constData(), samples.size(), track->frequency);
+			if (track->state.state == State::Starting) {
+				track->applyStartFade(samples, samplesCount);
+			}
+			track->decodedTill += samplesCount;
+		} else {
+			if (waiting) {
+				return;
+			}
+			finished = true;
+		}
+		queue = track->decoded;
+	}
 
-		alSourceQueueBuffers(track->stream.source, 1, track->stream.buffers + bufferIndex);
+	// Loaders is the only producer, so the queue is still not full.
+	if (samplesCount) {
+		queue->push({ std::move(samples), samplesCount });
+	}
 
-		if (!internal::audioCheckError()) {
-			setStoppedState(track, State::StoppedAtError);
-			emitError(type);
-			return;
-		}
-	} else {
-		if (waiting) {
-			return;
-		}
-		finished = true;
+	QMutexLocker lock(internal::audioPlayerMutex());
+	auto track = checkLoader(type);
+	if (!track || track->decoded != queue) {
+		clear(type);
+		return;
 	}
 
 	if (finished) {
 		track->loaded = true;
-		track->state.length = track->bufferedPosition + track->bufferedLength;
+		track->state.length = track->decodedTill;
 		clear(type);
 	}
 
 	track->loading = false;
-	if (track->state.state == State::Resuming || track->state.state == State::Playing || track->state.state == State::Starting) {
-		ALint state = AL_INITIAL;
-		alGetSourcei(track->stream.source, AL_SOURCE_STATE, &state);
-		if (internal::audioCheckError()) {
-			if (state != AL_PLAYING) {
-				if (state == AL_STOPPED && !internal::CheckAudioDeviceConnected()) {
-					return;
-				}
-
-				alSourcef(track->stream.source, AL_GAIN, ComputeVolume(type));
-				if (!internal::audioCheckError()) {
-					setStoppedState(track, State::StoppedAtError);
-					emitError(type);
-					return;
-				}
-
-				alSourcePlay(track->stream.source);
-				if (!internal::audioCheckError()) {
-					setStoppedState(track, State::StoppedAtError);
-					emitError(type);
-					return;
-				}
-
-				emit needToCheck();
-			}
-		} else {
-			setStoppedState(track, State::StoppedAtError);
-			emitError(type);
-		}
-	}
+	emit needToCheck();
 }
 
 AudioPlayerLoader *Loaders::setupLoader(
@@ -0,0 +1,85 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+#include <QtCore/QByteArray>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+namespace Media {
+namespace Audio {
+
+struct DecodedSamples {
+	QByteArray data;
+	int64 count = 0;
+};
+
+// Fixed size queue without locks for exactly one producer thread
+// and exactly one consumer thread.
+class SamplesQueue {
+public:
+	static constexpr auto kCapacity = 3;
+
+	// Thread: Producer.
+	bool full() const;
+	void push(DecodedSamples &&samples);
+
+	// Thread: Consumer.
+	DecodedSamples *front();
+	void pop();
+
+	// Thread: Any. May be outdated by the time it returns.
+	int size() const;
+
+private:
+	std::array<DecodedSamples, kCapacity> _slots;
+	std::atomic<uint32> _pushed = { 0U };
+	std::atomic<uint32> _popped = { 0U };
+
+};
+
+inline bool SamplesQueue::full() const {
+	const auto pushed = _pushed.load(std::memory_order_relaxed);
+	const auto popped = _popped.load(std::memory_order_acquire);
+	return (pushed - popped) == kCapacity;
+}
+
+inline void SamplesQueue::push(DecodedSamples &&samples) {
+	Expects(!full());
+
+	const auto pushed = _pushed.load(std::memory_order_relaxed);
+	_slots[pushed % kCapacity] = std::move(samples);
+	_pushed.store(pushed + 1, std::memory_order_release);
+}
+
+inline DecodedSamples *SamplesQueue::front() {
+	const auto popped = _popped.load(std::memory_order_relaxed);
+	const auto pushed = _pushed.load(std::memory_order_acquire);
+	return (pushed != popped) ? &_slots[popped % kCapacity] : nullptr;
+}
+
+inline void SamplesQueue::pop() {
+	Expects(front() != nullptr);
+
+	const auto popped = _popped.load(std::memory_order_relaxed);
+	_slots[popped % kCapacity] = DecodedSamples();
+	_popped.store(popped + 1, std::memory_order_release);
+}
+
+inline int SamplesQueue::size() const {
+	const auto popped = _popped.load(std::memory_order_acquire);
+	const auto pushed = _pushed.load(std::memory_order_acquire);
+	return std::min(int(pushed - popped), int(kCapacity));
+}
+
+} // namespace Audio
+} // namespace Media
@@ -14,6 +14,7 @@ extern "C" {
 } // extern "C"
 
 #include "media/media_clip_implementation.h"
+#include "media/media_clip_frame_pool.h"
 #include "media/media_child_ffmpeg_loader.h"
 
 namespace Media {
@@ -109,6 +110,7 @@ private:
 	int _height = 0;
 	SwsContext *_swsContext = nullptr;
 	QSize _swsSize;
+	FramePool _framePool;
 
 	TimeMs _frameMs = 0;
 	int _nextFrameDelay = 0;
@@ -0,0 +1,95 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "media/media_clip_frame_pool.h"
+
+namespace Media {
+namespace Clip {
+namespace internal {
+namespace {
+
+constexpr auto kAlignImageBy = 16;
+
+// Enough for the frame being decoded, the frame shown by the Reader
+// and the frame waiting to be shown.
+constexpr auto kMaxFreeBuffers = 3;
+
+std::atomic<int64> AllocationsCount = { 0 };
+
+} // namespace
+
+struct FramePool::Buffer {
+	std::weak_ptr<Data> pool;
+	std::unique_ptr<uchar[]> memory;
+	int size = 0;
+};
+
+struct FramePool::Data {
+	QMutex mutex;
+	std::vector<std::unique_ptr<Buffer>> free;
+};
+
+FramePool::FramePool() : _data(std::make_shared<Data>()) {
+}
+
+QImage FramePool::take(QSize size, QImage::Format format) {
+	const auto width = size.width();
+	const auto height = size.height();
+	const auto widthAlign = kAlignImageBy / 4;
+	const auto neededWidth = width + ((width % widthAlign) ? (widthAlign - (width % widthAlign)) : 0);
+	const auto bytesPerLine = neededWidth * 4;
+	const auto bufferSize = bytesPerLine * height + kAlignImageBy;
+
+	auto buffer = std::unique_ptr<Buffer>();
+	{
+		QMutexLocker lock(&_data->mutex);
+		auto &free = _data->free;
+		const auto i = std::find_if(begin(free), end(free), [&](const std::unique_ptr<Buffer> &candidate) {
+			return (candidate->size == bufferSize);
+		});
+		if (i != end(free)) {
+			buffer = std::move(*i);
+			free.erase(i);
+		}
+	}
+	if (!buffer) {
+		buffer = std::make_unique<Buffer>();
+		buffer->pool = _data;
+		buffer->memory = std::make_unique<uchar[]>(bufferSize);
+		buffer->size = bufferSize;
+		++AllocationsCount;
+	}
+	const auto memory = buffer->memory.get();
+	const auto memoryValue = reinterpret_cast<uintptr_t>(memory);
+	const auto aligned = memory + ((memoryValue % kAlignImageBy) ? (kAlignImageBy - (memoryValue % kAlignImageBy)) : 0);
+	return QImage(aligned, width, height, bytesPerLine, format, &FramePool::Release, buffer.release());
+}
+
+void FramePool::Release(void *buffer) {
+	auto owned = std::unique_ptr<Buffer>(static_cast<Buffer*>(buffer));
+	if (const auto data = owned->pool.lock()) {
+		QMutexLocker lock(&data->mutex);
+		if (int(data->free.size()) >= kMaxFreeBuffers) {
+			data->free.erase(data->free.begin());
+		}
+		data->free.push_back(std::move(owned));
+	}
+}
+
+int64 FramePool::TakeAllocationsCount() {
+	return AllocationsCount.exchange(0);
+}
+
+FramePool::~FramePool() = default;
+
+bool IsAlignedImage(const QImage &image) {
+	return !(reinterpret_cast<uintptr_t>(image.constBits()) % kAlignImageBy) && !(image.bytesPerLine() % kAlignImageBy);
+}
+
+} // namespace internal
+} // namespace Clip
+} // namespace Media
@@ -0,0 +1,46 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Media {
+namespace Clip {
+namespace internal {
+
+// Frame images of a single reader. A frame buffer returns to the pool
+// when the last QImage sharing it is destroyed (the image may be still
+// shown by the Reader while the next frame is decoded) and is reused
+// for the next frame of the same size.
+class FramePool {
+public:
+	FramePool();
+	FramePool(const FramePool &other) = delete;
+	FramePool &operator=(const FramePool &other) = delete;
+
+	// Data and lines of the result are aligned to 16 bytes.
+	QImage take(QSize size, QImage::Format format);
+
+	// Frame buffers allocated by all the pools since the previous call.
+	static int64 TakeAllocationsCount();
+
+	~FramePool();
+
+private:
+	struct Buffer;
+	struct Data;
+
+	static void Release(void *buffer);
+
+	std::shared_ptr<Data> _data;
+
+};
+
+bool IsAlignedImage(const QImage &image);
+
+} // namespace internal
+} // namespace Clip
+} // namespace Media
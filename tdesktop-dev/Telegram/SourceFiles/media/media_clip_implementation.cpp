@@ -7,11 +7,68 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "media/media_clip_implementation.h"
 
+#include "media/streaming/media_streaming_reader.h"
+
 namespace Media {
 namespace Clip {
 namespace internal {
+namespace {
+
+class StreamedDevice final : public QIODevice {
+public:
+	explicit StreamedDevice(const StreamedFile &file) : _file(file) {
+	}
+
+	bool open(OpenMode mode) override {
+		// Unbuffered, so that pos() in readData() is the real offset.
+		return QIODevice::open(mode | QIODevice::Unbuffered);
+	}
+	bool isSequential() const override {
+		return false;
+	}
+	qint64 size() const override {
+		return _file.reader->size();
+	}
+
+	~StreamedDevice() {
+		// The loader sends its requests from the main thread,
+		// so it should be destroyed there as well.
+		crl::on_main([file = base::take(_file)] {});
+	}
+
+protected:
+	qint64 readData(char *data, qint64 maxSize) override {
+		const auto offset = pos();
+		const auto count = std::min(maxSize, size() - offset);
+		if (count <= 0) {
+			return 0;
+		}
+		return _file.reader->fill(int(offset), int(count), data, *_file.cancelled)
+			? count
+			: -1;
+	}
+	qint64 writeData(const char *data, qint64 maxSize) override {
+		return -1;
+	}
+
+private:
+	StreamedFile _file;
+
+};
+
+} // namespace
 
 void ReaderImplementation::initDevice() {
+	if (_streamed.reader) {
+		if (_streamedDevice && _streamedDevice->isOpen()) {
+			_streamedDevice->close();
+		} else if (!_streamedDevice) {
+			_streamedDevice = std::make_unique<StreamedDevice>(_streamed);
+		}
+		_dataSize = _streamed.reader->size();
+		_device = _streamedDevice.get();
+		return;
+	}
 	if (_data->isEmpty()) {
 		if (_file.isOpen()) _file.close();
 		_file.setFileName(_location->name());
@@ -10,9 +10,21 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 class FileLocation;
 
 namespace Media {
+namespace Streaming {
+class Reader;
+} // namespace Streaming
+
 namespace Clip {
 namespace internal {
 
+// The file is read from the streaming reader while it is being loaded.
+// The cancelled flag releases the decoder waiting for the data when
+// the clip is stopped.
+struct StreamedFile {
+	std::shared_ptr<Streaming::Reader> reader;
+	std::shared_ptr<std::atomic<bool>> cancelled;
+};
+
 class ReaderImplementation {
 public:
 	ReaderImplementation(FileLocation *location, QByteArray *data)
@@ -50,6 +62,9 @@ public:
 	int64 dataSize() const {
 		return _dataSize;
 	}
+	void setStreamedFile(const StreamedFile &file) {
+		_streamed = file;
+	}
 
 protected:
 	FileLocation *_location;
@@ -58,6 +73,8 @@ protected:
 	QBuffer _buffer;
 	QIODevice *_device = nullptr;
 	int64 _dataSize = 0;
+	StreamedFile _streamed;
+	std::unique_ptr<QIODevice> _streamedDevice;
 
 	void initDevice();
 
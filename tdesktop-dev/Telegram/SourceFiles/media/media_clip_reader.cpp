@@ -12,9 +12,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/media_clip_ffmpeg.h"
 #include "media/media_clip_qtgif.h"
 #include "media/media_clip_check_streaming.h"
+#include "media/media_clip_frame_pool.h"
+#include "media/streaming/media_streaming_reader.h"
+#include "ui/image/image_prepare_kernels.h"
 #include "mainwidget.h"
 #include "mainwindow.h"
 
+#include <atomic>
+
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
@@ -26,9 +31,72 @@ namespace Media {
 namespace Clip {
 namespace {
 
+// Frames are decoded in their own thread pools, so the manager
+// thread only schedules them and one thread is enough for it.
+constexpr auto kManagersCount = 1;
+
+// Streamed readers wait for the network parts inside the decode,
+// so they have their own pool and don't hold the other decodes.
+constexpr auto kMaxStreamedDecodes = 4;
+
+// A frame shown later than that is counted as a missed deadline.
+constexpr auto kFrameDeadlineTolerance = TimeMs(16);
+
 QVector<QThread*> threads;
 QVector<Manager*> managers;
 
+QMutex FrameStatsMutex;
+FrameStats CurrentFrameStats;
+
+// The decodes are long and some of them block, so they run on their own
+// threads instead of the shared crl::async pool with its short tasks.
+class DecodeTask : public QRunnable {
+public:
+	explicit DecodeTask(FnMut<void()> method) : _method(std::move(method)) {
+	}
+
+	void run() override {
+		_method();
+	}
+
+private:
+	FnMut<void()> _method;
+
+};
+
+int MaxDecodesInFlight() {
+	// Leave one core for the main thread and the crl::async tasks.
+	static const auto result = std::max(QThread::idealThreadCount() - 1, 1);
+	return result;
+}
+
+QThreadPool &DecodePool() {
+	static auto result = [] {
+		auto pool = std::make_unique<QThreadPool>();
+		pool->setMaxThreadCount(MaxDecodesInFlight());
+		return pool;
+	}();
+	return *result;
+}
+
+QThreadPool &StreamedDecodePool() {
+	static auto result = [] {
+		auto pool = std::make_unique<QThreadPool>();
+		pool->setMaxThreadCount(kMaxStreamedDecodes);
+		return pool;
+	}();
+	return *result;
+}
+
+void CountShownFrame(TimeMs lateness) {
+	QMutexLocker lock(&FrameStatsMutex);
+	++CurrentFrameStats.frames;
+	if (lateness > kFrameDeadlineTolerance) {
+		++CurrentFrameStats.late;
+	}
+	accumulate_max(CurrentFrameStats.maxLateness, lateness);
+}
+
 QImage PrepareFrameImage(const FrameRequest &request, const QImage &original, bool hasAlpha, QImage &cache) {
 	auto needResize = (original.width() != request.framew) || (original.height() != request.frameh);
 	auto needOuterFill = (request.outerw != request.framew) || (request.outerh != request.frameh);
@@ -79,6 +147,61 @@ QPixmap PrepareFrame(const FrameRequest &request, const QImage &original, bool h
 	return QPixmap::fromImage(PrepareFrameImage(request, original, hasAlpha, cache), Qt::ColorOnly);
 }
 
+// Opaque frames decoded right in the requested size are copied to the
+// rounded buffer and rounded there, without painting them with a QPainter.
+// The original is left untouched, other sizes are prepared from it later.
+bool RoundFrameToBuffer(const FrameRequest &request, const QImage &original, bool hasAlpha, QImage &rounded, QImage &circleMask) {
+	if (hasAlpha
+		|| request.radius == ImageRoundRadius::None
+		|| original.format() != QImage::Format_ARGB32_Premultiplied
+		|| original.width() != request.framew
+		|| original.height() != request.frameh
+		|| request.outerw != request.framew
+		|| request.outerh != request.frameh) {
+		return false;
+	}
+	const auto width = original.width();
+	const auto height = original.height();
+	if (rounded.width() != width || rounded.height() != height) {
+		rounded = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
+	}
+	rounded.setDevicePixelRatio(original.devicePixelRatio());
+
+	// The pooled frames may have a wider stride than the rounded buffer.
+	const auto lineSize = width * 4;
+	const auto from = original.constBits();
+	const auto fromPerLine = original.bytesPerLine();
+	const auto to = rounded.bits();
+	const auto toPerLine = rounded.bytesPerLine();
+	for (auto y = 0; y != height; ++y) {
+		memcpy(to + y * toPerLine, from + y * fromPerLine, lineSize);
+	}
+
+	if (request.radius != ImageRoundRadius::Ellipse) {
+		Images::prepareRound(rounded, request.radius, request.corners);
+		return true;
+	}
+	if (circleMask.width() != width || circleMask.height() != height) {
+		circleMask = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
+		circleMask.fill(Qt::transparent);
+
+		Painter p(&circleMask);
+		PainterHighQualityEnabler hq(p);
+		p.setBrush(Qt::white);
+		p.setPen(Qt::NoPen);
+		p.drawEllipse(0, 0, width, height);
+	}
+	Images::Kernels::Mask(
+		reinterpret_cast<uint32*>(rounded.bits()),
+		rounded.bytesPerLine() >> 2,
+		circleMask.constBits(),
+		width,
+		height,
+		circleMask.depth() / 8,
+		circleMask.bytesPerLine());
+	return true;
+}
+
 } // namespace
 
 Reader::Reader(const QString &filepath, Callback &&callback, Mode mode, TimeMs seekMs)
@@ -96,8 +219,18 @@ Reader::Reader(not_null<DocumentData*> document, FullMsgId msgId, Callback &&cal
 	init(document->location(), document->data());
 }
 
+Reader::Reader(std::shared_ptr<Streaming::Reader> streaming, not_null<DocumentData*> document, FullMsgId msgId, Callback &&callback, Mode mode, TimeMs seekMs)
+: _callback(std::move(callback))
+, _mode(mode)
+, _audioMsgId(document, msgId, (mode == Mode::Video) ? rand_value<uint32>() : 0)
+, _seekPositionMs(seekMs)
+, _streaming(std::move(streaming))
+, _streamingCancelled(std::make_shared<std::atomic<bool>>(false)) {
+	init(FileLocation(), QByteArray());
+}
+
 void Reader::init(const FileLocation &location, const QByteArray &data) {
-	if (threads.size() < ClipThreadsCount) {
+	if (threads.size() < kManagersCount) {
 		_threadIndex = threads.size();
 		threads.push_back(new QThread());
 		managers.push_back(new Manager(threads.back()));
@@ -328,6 +461,10 @@ State Reader::state() const {
 }
 
 void Reader::stop() {
+	if (_streaming) {
+		*_streamingCancelled = true;
+		_streaming->wakeWaiting();
+	}
 	if (managers.size() <= _threadIndex) error();
 	if (_state != State::Error) {
 		managers.at(_threadIndex)->stop(this);
@@ -355,8 +492,9 @@ public:
 	, _mode(reader->mode())
 	, _audioMsgId(reader->audioMsgId())
 	, _seekPositionMs(reader->seekPositionMs())
-	, _data(data) {
-		if (_data.isEmpty()) {
+	, _data(data)
+	, _streamed{ reader->_streaming, reader->_streamingCancelled } {
+		if (_data.isEmpty() && !_streamed.reader) {
 			_location = std::make_unique<FileLocation>(location);
 			if (!_location->accessEnable()) {
 				error();
@@ -377,7 +515,7 @@ public:
 				// get the frame size and return a black frame with that size.
 
 				auto firstFramePositionMs = TimeMs(0);
-				auto reader = std::make_unique<internal::FFMpegReaderImplementation>(_location.get(), &_data, AudioMsgId());
+				auto reader = createImplementation(AudioMsgId());
 				if (reader->start(internal::ReaderImplementation::Mode::Normal, firstFramePositionMs)) {
 					auto firstFrameReadResult = reader->readFramesTill(-1, ms);
 					if (firstFrameReadResult == internal::ReaderImplementation::ReadResult::Success) {
@@ -467,14 +605,18 @@ public:
 		}
 		frame()->original.setDevicePixelRatio(_request.factor);
 		frame()->pix = QPixmap();
-		frame()->pix = PrepareFrame(_request, frame()->original, frame()->alpha, frame()->cache);
+		if (RoundFrameToBuffer(_request, frame()->original, frame()->alpha, _rounded, _circleMask)) {
+			frame()->pix = QPixmap::fromImage(_rounded, Qt::ColorOnly);
+		} else {
+			frame()->pix = PrepareFrame(_request, frame()->original, frame()->alpha, frame()->cache);
+		}
 		frame()->when = _nextFrameWhen;
 		frame()->positionMs = _nextFramePositionMs;
 		return true;
 	}
 
 	bool init() {
-		if (_data.isEmpty() && QFileInfo(_location->name()).size() <= Storage::kMaxAnimationInMemory) {
+		if (_data.isEmpty() && _location && QFileInfo(_location->name()).size() <= Storage::kMaxAnimationInMemory) {
 			QFile f(_location->name());
 			if (f.open(QIODevice::ReadOnly)) {
 				_data = f.readAll();
@@ -484,7 +626,7 @@ public:
 			}
 		}
 
-		_implementation = std::make_unique<internal::FFMpegReaderImplementation>(_location.get(), &_data, _audioMsgId);
+		_implementation = createImplementation(_audioMsgId);
 //		_implementation = new QtGifReaderImplementation(_location, &_data);
 
 		auto implementationMode = [this]() {
@@ -497,6 +639,14 @@ public:
 		return _implementation->start(implementationMode(), _seekPositionMs);
 	}
 
+	std::unique_ptr<internal::FFMpegReaderImplementation> createImplementation(const AudioMsgId &audio) {
+		auto result = std::make_unique<internal::FFMpegReaderImplementation>(_location.get(), &_data, audio);
+		if (_streamed.reader) {
+			result->setStreamedFile(_streamed);
+		}
+		return result;
+	}
+
 	void startedAt(TimeMs ms) {
 		_animationStarted = _nextFrameWhen = ms;
 	}
@@ -547,6 +697,12 @@ public:
 	~ReaderPrivate() {
 		stop(Player::State::Stopped);
 		_data.clear();
+
+		// The streaming reader owns the loader with its MTP::Sender, so
+		// the last reference to it is dropped on the main thread.
+		if (auto reader = std::move(_streamed.reader)) {
+			crl::on_main([reader = std::move(reader)] {});
+		}
 	}
 
 private:
@@ -557,6 +713,7 @@ private:
 	TimeMs _seekPositionMs = 0;
 
 	QByteArray _data;
+	internal::StreamedFile _streamed;
 	std::unique_ptr<FileLocation> _location;
 	bool _accessed = false;
 
@@ -575,6 +732,8 @@ private:
 	};
 	Frame _frames[3];
 	int _frame = 0;
+	QImage _rounded;
+	QImage _circleMask;
 	Frame *frame() {
 		return _frames + _frame;
 	}
@@ -592,6 +751,11 @@ private:
 	bool _started = false;
 	TimeMs _videoPausedAtMs = 0;
 
+	// While decoding, only the decode task touches the reader.
+	bool _decoding = false;
+	bool _decodeKept = false;
+	std::atomic<bool> _decoded = false;
+
 	friend class Manager;
 
 };
@@ -719,25 +883,57 @@ bool Manager::handleProcessResult(ReaderPrivate *reader, ProcessResult result, T
 	return true;
 }
 
-Manager::ResultHandleState Manager::handleResult(ReaderPrivate *reader, ProcessResult result, TimeMs ms) {
-	if (!handleProcessResult(reader, result, ms)) {
-		_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : AverageGifSize));
-		delete reader;
-		return ResultHandleRemove;
+int Manager::decodePriority(ReaderPrivate *reader) const {
+	if (reader->_mode == Reader::Mode::Video) {
+		return 2;
 	}
+	QMutexLocker lock(&_readerPointersMutex);
+	auto it = constUnsafeFindReaderPointer(reader);
+	if (it == _readerPointers.cend()) {
+		return 0;
+	}
+	auto frame = it.key()->frameToShow();
+	return (frame && frame->displayed.loadAcquire() > 0) ? 1 : 0;
+}
 
-	_processingInThread->eventDispatcher()->processEvents(QEventLoop::AllEvents);
-	if (_processingInThread->isInterruptionRequested()) {
-		return ResultHandleStop;
+void Manager::startDecode(ReaderPrivate *reader) {
+	const auto streamed = (reader->_streamed.reader != nullptr);
+	reader->_decoding = true;
+	reader->_decoded.store(false, std::memory_order_relaxed);
+	{
+		QMutexLocker lock(&_decodesMutex);
+		++(streamed ? _streamedDecodesInFlight : _decodesInFlight);
 	}
+	auto &pool = streamed ? StreamedDecodePool() : DecodePool();
+	pool.start(new DecodeTask([=] {
+		reader->_decodeKept = decode(reader);
+		reader->_decoded.store(true, std::memory_order_release);
+		finishDecode(streamed);
+	}));
+}
 
-	if (result == ProcessResult::Repaint) {
+bool Manager::decode(ReaderPrivate *reader) {
+	const auto ms = getms();
+	const auto deadline = (reader->_started
+		&& !reader->_autoPausedGif
+		&& !reader->_videoPausedAtMs)
+		? reader->_nextFrameWhen
+		: TimeMs(0);
+	auto result = reader->process(ms);
+	if (result == ProcessResult::Repaint && deadline > 0) {
+		CountShownFrame(ms - deadline);
+	}
+	while (true) {
+		if (!handleProcessResult(reader, result, ms)) {
+			return false;
+		} else if (result != ProcessResult::Repaint) {
+			return true;
+		}
 		{
 			QMutexLocker lock(&_readerPointersMutex);
 			auto it = constUnsafeFindReaderPointer(reader);
 			if (it != _readerPointers.cend()) {
 				int32 index = 0;
-				Reader *r = it.key();
 				Reader::Frame *frame = it.key()->frameToWrite(&index);
 				if (frame) {
 					frame->clear();
@@ -747,10 +943,15 @@ Manager::ResultHandleState Manager::handleResult(ReaderPrivate *reader, ProcessR
 				reader->_frame = index;
 			}
 		}
-		return handleResult(reader, reader->finishProcess(ms), ms);
+		result = reader->finishProcess(ms);
 	}
+}
 
-	return ResultHandleContinue;
+void Manager::finishDecode(bool streamed) {
+	QMutexLocker lock(&_decodesMutex);
+	--(streamed ? _streamedDecodesInFlight : _decodesInFlight);
+	_decodesFinished.wakeAll();
+	emit processDelayed();
 }
 
 void Manager::process() {
@@ -764,6 +965,29 @@ void Manager::process() {
 
 	bool checkAllReaders = false;
 	auto ms = getms(), minms = ms + 86400 * 1000LL;
+	for (auto i = _readers.begin(), e = _readers.end(); i != e;) {
+		ReaderPrivate *reader = i.key();
+		if (!reader->_decoding
+			|| !reader->_decoded.load(std::memory_order_acquire)) {
+			++i;
+			continue;
+		}
+		reader->_decoding = false;
+		if (!reader->_decodeKept) {
+			_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : AverageGifSize));
+			delete reader;
+			i = _readers.erase(i);
+			continue;
+		}
+		if (reader->_videoPausedAtMs) {
+			i.value() = ms + 86400 * 1000ULL;
+		} else if (reader->_nextFrameWhen && reader->_started) {
+			i.value() = reader->_nextFrameWhen;
+		} else {
+			i.value() = (ms + 86400 * 1000ULL);
+		}
+		++i;
+	}
 	{
 		QMutexLocker lock(&_readerPointersMutex);
 		for (auto it = _readerPointers.begin(), e = _readerPointers.end(); it != e; ++it) {
@@ -771,6 +995,9 @@ void Manager::process() {
 				auto i = _readers.find(it.key()->_private);
 				if (i == _readers.cend()) {
 					_readers.insert(it.key()->_private, 0);
+				} else if (i.key()->_decoding) {
+					// Apply the request when the decode is finished.
+					continue;
 				} else {
 					i.value() = ms;
 					if (i.key()->_autoPausedGif && !it.key()->_autoPausedGif.loadAcquire()) {
@@ -790,25 +1017,16 @@ void Manager::process() {
 		checkAllReaders = (_readers.size() > _readerPointers.size());
 	}
 
+	auto due = std::vector<std::pair<int, ReaderPrivate*>>();
 	for (auto i = _readers.begin(), e = _readers.end(); i != e;) {
 		ReaderPrivate *reader = i.key();
-		if (i.value() <= ms) {
-			ResultHandleState state = handleResult(reader, reader->process(ms), ms);
-			if (state == ResultHandleRemove) {
-				i = _readers.erase(i);
-				continue;
-			} else if (state == ResultHandleStop) {
-				_processingInThread = 0;
-				return;
-			}
-			ms = getms();
-			if (reader->_videoPausedAtMs) {
-				i.value() = ms + 86400 * 1000ULL;
-			} else if (reader->_nextFrameWhen && reader->_started) {
-				i.value() = reader->_nextFrameWhen;
-			} else {
-				i.value() = (ms + 86400 * 1000ULL);
-			}
+		if (reader->_decoding) {
+			++i;
+			continue;
+		} else if (i.value() <= ms) {
+			due.emplace_back(decodePriority(reader), reader);
+			++i;
+			continue;
 		} else if (checkAllReaders) {
 			QMutexLocker lock(&_readerPointersMutex);
 			auto it = constUnsafeFindReaderPointer(reader);
@@ -825,6 +1043,29 @@ void Manager::process() {
 		++i;
 	}
 
+	// Visible readers are decoded first. If there are more due readers
+	// than free workers the rest wait for the next finished decode.
+	std::stable_sort(begin(due), end(due), [](const auto &a, const auto &b) {
+		return a.first > b.first;
+	});
+	auto available = 0;
+	auto streamedAvailable = 0;
+	{
+		QMutexLocker lock(&_decodesMutex);
+		available = MaxDecodesInFlight() - _decodesInFlight;
+		streamedAvailable = kMaxStreamedDecodes - _streamedDecodesInFlight;
+	}
+	for (const auto &entry : due) {
+		const auto reader = entry.second;
+		auto &left = reader->_streamed.reader
+			? streamedAvailable
+			: available;
+		if (left > 0) {
+			startDecode(reader);
+			--left;
+		}
+	}
+
 	ms = getms();
 	if (_needReProcess || minms <= ms) {
 		_needReProcess = false;
@@ -849,6 +1090,12 @@ void Manager::clear() {
 		}
 		_readerPointers.clear();
 	}
+	{
+		QMutexLocker lock(&_decodesMutex);
+		while (_decodesInFlight > 0 || _streamedDecodesInFlight > 0) {
+			_decodesFinished.wait(&_decodesMutex);
+		}
+	}
 
 	for (Readers::iterator i = _readers.begin(), e = _readers.end(); i != e; ++i) {
 		delete i.key();
@@ -902,6 +1149,13 @@ FileMediaInformation::Video PrepareForSending(const QString &fname, const QByteA
 	return result;
 }
 
+FrameStats TakeFrameStats() {
+	QMutexLocker lock(&FrameStatsMutex);
+	auto result = base::take(CurrentFrameStats);
+	result.allocations = internal::FramePool::TakeAllocationsCount();
+	return result;
+}
+
 void Finish() {
 	if (!threads.isEmpty()) {
 		for (int32 i = 0, l = threads.size(); i < l; ++i) {
@@ -13,6 +13,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 class FileLocation;
 
 namespace Media {
+namespace Streaming {
+class Reader;
+} // namespace Streaming
+
 namespace Clip {
 
 enum class State {
@@ -52,6 +56,9 @@ public:
 	Reader(const QString &filepath, Callback &&callback, Mode mode = Mode::Gif, TimeMs seekMs = 0);
 	Reader(not_null<DocumentData*> document, FullMsgId msgId, Callback &&callback, Mode mode = Mode::Gif, TimeMs seekMs = 0);
 
+	// Plays the document while it is being loaded by the streaming reader.
+	Reader(std::shared_ptr<Streaming::Reader> streaming, not_null<DocumentData*> document, FullMsgId msgId, Callback &&callback, Mode mode = Mode::Gif, TimeMs seekMs = 0);
+
 	static void callback(Reader *reader, int threadIndex, Notification notification); // reader can be deleted
 
 	void setAutoplay() {
@@ -161,7 +168,11 @@ private:
 
 	bool _autoplay = false;
 
+	std::shared_ptr<Streaming::Reader> _streaming;
+	std::shared_ptr<std::atomic<bool>> _streamingCancelled;
+
 	friend class Manager;
+	friend class ReaderPrivate;
 
 	ReaderPrivate *_private = nullptr;
 
@@ -221,12 +232,10 @@ private:
 
 	bool handleProcessResult(ReaderPrivate *reader, ProcessResult result, TimeMs ms);
 
-	enum ResultHandleState {
-		ResultHandleRemove,
-		ResultHandleStop,
-		ResultHandleContinue,
-	};
-	ResultHandleState handleResult(ReaderPrivate *reader, ProcessResult result, TimeMs ms);
+	int decodePriority(ReaderPrivate *reader) const;
+	void startDecode(ReaderPrivate *reader);
+	bool decode(ReaderPrivate *reader);
+	void finishDecode(bool streamed);
 
 	typedef QMap<ReaderPrivate*, TimeMs> Readers;
 	Readers _readers;
@@ -235,8 +244,23 @@ private:
 	QThread *_processingInThread;
 	bool _needReProcess;
 
+	int _decodesInFlight = 0;
+	int _streamedDecodesInFlight = 0;
+	QMutex _decodesMutex;
+	QWaitCondition _decodesFinished;
+
+};
+
+struct FrameStats {
+	int64 frames = 0;
+	int64 late = 0;
+	TimeMs maxLateness = 0;
+	int64 allocations = 0; // Frame buffers allocated by the decoders.
 };
 
+// Frames shown by all the readers since the previous call.
+FrameStats TakeFrameStats();
+
 FileMediaInformation::Video PrepareForSending(const QString &fname, const QByteArray &data);
 
 void Finish();
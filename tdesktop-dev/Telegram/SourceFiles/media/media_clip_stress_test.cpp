@@ -0,0 +1,151 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "media/media_clip_stress_test.h"
+
+#include "media/media_clip_reader.h"
+#include "base/timer.h"
+
+namespace Media {
+namespace Clip {
+namespace {
+
+constexpr auto kMaxFrameSize = 240;
+constexpr auto kPaintDelay = TimeMs(16);
+
+struct StressTest {
+	std::vector<ReaderPointer> readers;
+	std::vector<QSize> sizes;
+	base::Timer paintTimer;
+	base::Timer finishTimer;
+	Fn<void(QString)> done;
+	TimeMs duration = 0;
+	int64 paints = 0;
+	int errors = 0;
+	bool finished = false;
+};
+
+// The finished test is kept until the next one is started,
+// because it is finished from its own timer callback.
+std::unique_ptr<StressTest> Running;
+
+QSize FrameSize(not_null<Reader*> reader) {
+	auto result = QSize(
+		std::max(reader->width(), 1),
+		std::max(reader->height(), 1));
+	if (result.width() > kMaxFrameSize || result.height() > kMaxFrameSize) {
+		result.scale(kMaxFrameSize, kMaxFrameSize, Qt::KeepAspectRatio);
+	}
+	return QSize(std::max(result.width(), 1), std::max(result.height(), 1));
+}
+
+void ClipCallback(int index, Notification notification) {
+	if (!Running
+		|| Running->finished
+		|| notification != NotificationReinit) {
+		return;
+	}
+	const auto reader = Running->readers[index].get();
+	if (!reader) {
+		return;
+	} else if (reader->state() == State::Error) {
+		++Running->errors;
+		Running->readers[index].setBad();
+	} else if (reader->ready() && !reader->started()) {
+		const auto size = FrameSize(reader);
+		Running->sizes[index] = size;
+		reader->start(
+			size.width(),
+			size.height(),
+			size.width(),
+			size.height(),
+			ImageRoundRadius::None,
+			RectPart::AllCorners);
+	}
+}
+
+void Paint() {
+	const auto ms = getms();
+	for (auto i = 0, count = int(Running->readers.size()); i != count; ++i) {
+		const auto reader = Running->readers[i].get();
+		if (!reader || !reader->started()) {
+			continue;
+		}
+		const auto size = Running->sizes[i];
+		reader->current(
+			size.width(),
+			size.height(),
+			size.width(),
+			size.height(),
+			ImageRoundRadius::None,
+			RectPart::AllCorners,
+			ms);
+		++Running->paints;
+	}
+}
+
+void Finish() {
+	const auto test = Running.get();
+	test->finished = true;
+	test->paintTimer.cancel();
+	test->readers.clear();
+
+	const auto stats = TakeFrameStats();
+	const auto report = qsl("Clips: %1, errors: %2\n"
+		"Duration: %3 ms\n"
+		"Frames shown: %4\n"
+		"Missed deadlines: %5 (%6%)\n"
+		"Max lateness: %7 ms\n"
+		"Frame allocations: %8 (%9 per second)\n"
+		"Paints: %10"
+		).arg(test->sizes.size()
+		).arg(test->errors
+		).arg(test->duration
+		).arg(stats.frames
+		).arg(stats.late
+		).arg(stats.frames ? (stats.late * 100. / stats.frames) : 0.
+		).arg(stats.maxLateness
+		).arg(stats.allocations
+		).arg(test->duration ? (stats.allocations * 1000. / test->duration) : 0.
+		).arg(test->paints);
+	test->done(report);
+}
+
+} // namespace
+
+void RunStressTest(
+		const QString &path,
+		int count,
+		TimeMs duration,
+		Fn<void(QString)> done) {
+	if (Running && !Running->finished) {
+		return;
+	}
+	Running = std::make_unique<StressTest>();
+	Running->done = std::move(done);
+	Running->duration = duration;
+	Running->readers.reserve(count);
+	Running->sizes.resize(count);
+
+	// Skip the frames counted before the test was started.
+	TakeFrameStats();
+
+	for (auto i = 0; i != count; ++i) {
+		Running->readers.push_back(MakeReader(path, [=](
+				Notification notification) {
+			ClipCallback(i, notification);
+		}));
+		Running->readers.back()->setAutoplay();
+	}
+	Running->paintTimer.setCallback([] { Paint(); });
+	Running->paintTimer.callEach(kPaintDelay);
+	Running->finishTimer.setCallback([] { Finish(); });
+	Running->finishTimer.callOnce(duration);
+}
+
+} // namespace Clip
+} // namespace Media
@@ -0,0 +1,23 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Media {
+namespace Clip {
+
+// Plays count autoplaying copies of the clip at path at once, painting
+// all of them each frame for duration ms, the way a chat full of GIFs
+// does it. Calls done with a human readable report of missed deadlines.
+void RunStressTest(
+	const QString &path,
+	int count,
+	TimeMs duration,
+	Fn<void(QString)> done);
+
+} // namespace Clip
+} // namespace Media
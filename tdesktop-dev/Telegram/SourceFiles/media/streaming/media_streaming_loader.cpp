@@ -0,0 +1,21 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "media/streaming/media_streaming_loader.h"
+
+namespace Media {
+namespace Streaming {
+
+bool LoadedPart::valid(int size) const {
+	return (offset != kFailedOffset)
+		&& (offset >= 0)
+		&& (offset % kPartSize == 0)
+		&& (bytes.size() == std::min(kPartSize, size - offset));
+}
+
+} // namespace Streaming
+} // namespace Media
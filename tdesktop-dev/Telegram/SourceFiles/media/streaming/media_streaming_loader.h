@@ -0,0 +1,51 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+#include <QtCore/QByteArray>
+
+namespace Media {
+namespace Streaming {
+
+constexpr auto kPartSize = 128 * 1024;
+
+struct LoadedPart {
+	static constexpr auto kFailedOffset = -1;
+
+	int offset = 0;
+	QByteArray bytes;
+
+	bool valid(int size) const;
+};
+
+// Loads the file by parts of kPartSize bytes in any order.
+//
+// load() and cancel() may be called from any thread and the loaded parts
+// may be passed to the handler from any thread, so that the decoder can
+// request the data right from its own thread.
+class Loader {
+public:
+	using PartHandler = Fn<void(LoadedPart &&part)>;
+
+	virtual int size() const = 0;
+
+	// Should be called once before any load() call.
+	virtual void setPartHandler(PartHandler handler) = 0;
+
+	virtual void load(int offset) = 0;
+	virtual void cancel(int offset) = 0;
+	virtual void stop() = 0;
+
+	virtual ~Loader() = default;
+
+};
+
+} // namespace Streaming
+} // namespace Media
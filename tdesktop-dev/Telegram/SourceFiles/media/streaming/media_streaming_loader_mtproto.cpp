@@ -0,0 +1,169 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "media/streaming/media_streaming_loader_mtproto.h"
+
+#include "storage/file_download.h"
+
+namespace Media {
+namespace Streaming {
+namespace {
+
+constexpr auto kMaxConcurrentRequests = 4;
+
+} // namespace
+
+LoaderMtproto::LoaderMtproto(
+	not_null<Storage::Downloader*> owner,
+	MTP::DcId dcId,
+	const MTPInputFileLocation &location,
+	int size)
+: _owner(owner)
+, _dcId(dcId)
+, _location(location)
+, _size(size) {
+}
+
+int LoaderMtproto::size() const {
+	return _size;
+}
+
+void LoaderMtproto::setPartHandler(PartHandler handler) {
+	_handler = std::move(handler);
+}
+
+void LoaderMtproto::load(int offset) {
+	{
+		QMutexLocker lock(&_mutex);
+		if (_stopped) {
+			return;
+		}
+		_cancelled.erase(
+			ranges::remove(_cancelled, offset),
+			end(_cancelled));
+		if (ranges::find(_requested, offset) == end(_requested)) {
+			_requested.push_back(offset);
+		}
+	}
+	crl::on_main(this, [=] { sendRequests(); });
+}
+
+void LoaderMtproto::cancel(int offset) {
+	{
+		QMutexLocker lock(&_mutex);
+		_requested.erase(
+			ranges::remove(_requested, offset),
+			end(_requested));
+		_cancelled.push_back(offset);
+	}
+	crl::on_main(this, [=] { sendRequests(); });
+}
+
+void LoaderMtproto::stop() {
+	{
+		QMutexLocker lock(&_mutex);
+		_stopped = true;
+		_requested.clear();
+	}
+	crl::on_main(this, [=] {
+		for (const auto &[offset, request] : base::take(_sent)) {
+			this->request(request.id).cancel();
+			_owner->requestedAmountIncrement(
+				_dcId,
+				request.dcIndex,
+				-kPartSize);
+		}
+	});
+}
+
+void LoaderMtproto::sendRequests() {
+	auto cancelled = std::vector<int>();
+	auto offsets = std::vector<int>();
+	{
+		QMutexLocker lock(&_mutex);
+		cancelled = base::take(_cancelled);
+		const auto available = kMaxConcurrentRequests - int(_sent.size());
+		const auto count = std::min(available, int(_requested.size()));
+		if (count > 0) {
+			offsets.assign(begin(_requested), begin(_requested) + count);
+			_requested.erase(begin(_requested), begin(_requested) + count);
+		}
+	}
+	for (const auto offset : cancelled) {
+		const auto i = _sent.find(offset);
+		if (i != end(_sent)) {
+			request(i->second.id).cancel();
+			finishRequest(offset);
+		}
+	}
+	for (const auto offset : offsets) {
+		sendRequest(offset);
+	}
+}
+
+void LoaderMtproto::sendRequest(int offset) {
+	if (_sent.contains(offset)) {
+		return;
+	}
+	const auto dcIndex = _owner->chooseDcIndexForRequest(_dcId);
+	_owner->requestedAmountIncrement(_dcId, dcIndex, kPartSize);
+	const auto id = request(MTPupload_GetFile(
+		_location,
+		MTP_int(offset),
+		MTP_int(kPartSize)
+	)).done([=](const MTPupload_File &result) {
+		partLoaded(offset, result);
+	}).fail([=](const RPCError &error) {
+		partFailed(offset, error);
+	}).toDC(MTP::downloadDcId(_dcId, dcIndex)).send();
+	_sent.emplace(offset, Request{ id, dcIndex });
+}
+
+void LoaderMtproto::finishRequest(int offset) {
+	const auto i = _sent.find(offset);
+	Assert(i != end(_sent));
+	_owner->requestedAmountIncrement(_dcId, i->second.dcIndex, -kPartSize);
+	_sent.erase(i);
+}
+
+void LoaderMtproto::partLoaded(int offset, const MTPupload_File &result) {
+	finishRequest(offset);
+	auto part = LoadedPart();
+	result.match([&](const MTPDupload_file &data) {
+		part.offset = offset;
+		part.bytes = data.vbytes.v;
+	}, [&](const MTPDupload_fileCdnRedirect &data) {
+		// CDN files are loaded with hash checks by mtpFileLoader only.
+		LOG(("Streaming Error: CDN redirect for offset %1.").arg(offset));
+		part.offset = LoadedPart::kFailedOffset;
+	});
+	_handler(std::move(part));
+	sendRequests();
+}
+
+void LoaderMtproto::partFailed(int offset, const RPCError &error) {
+	finishRequest(offset);
+	LOG(("Streaming Error: Could not load part %1, error %2."
+		).arg(offset
+		).arg(error.type()));
+
+	auto part = LoadedPart();
+	part.offset = LoadedPart::kFailedOffset;
+	_handler(std::move(part));
+}
+
+LoaderMtproto::~LoaderMtproto() {
+	for (const auto &[offset, request] : base::take(_sent)) {
+		_owner->requestedAmountIncrement(
+			_dcId,
+			request.dcIndex,
+			-kPartSize);
+	}
+}
+
+} // namespace Streaming
+} // namespace Media
@@ -0,0 +1,71 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "media/streaming/media_streaming_loader.h"
+#include "mtproto/sender.h"
+#include "base/weak_ptr.h"
+#include "base/flat_map.h"
+
+namespace Storage {
+class Downloader;
+} // namespace Storage
+
+namespace Media {
+namespace Streaming {
+
+class LoaderMtproto final
+	: public Loader
+	, public base::has_weak_ptr
+	, private MTP::Sender {
+public:
+	LoaderMtproto(
+		not_null<Storage::Downloader*> owner,
+		MTP::DcId dcId,
+		const MTPInputFileLocation &location,
+		int size);
+
+	int size() const override;
+	void setPartHandler(PartHandler handler) override;
+
+	void load(int offset) override;
+	void cancel(int offset) override;
+	void stop() override;
+
+	~LoaderMtproto();
+
+private:
+	struct Request {
+		mtpRequestId id = 0;
+		int dcIndex = 0;
+	};
+
+	void sendRequests();
+	void sendRequest(int offset);
+	void finishRequest(int offset);
+	void partLoaded(int offset, const MTPupload_File &result);
+	void partFailed(int offset, const RPCError &error);
+
+	const not_null<Storage::Downloader*> _owner;
+	const MTP::DcId _dcId = 0;
+	const MTPInputFileLocation _location;
+	const int _size = 0;
+	PartHandler _handler;
+
+	// Offsets from load() and cancel(), those may come from any thread.
+	QMutex _mutex;
+	std::vector<int> _requested;
+	std::vector<int> _cancelled;
+	bool _stopped = false;
+
+	base::flat_map<int, Request> _sent;
+
+};
+
+} // namespace Streaming
+} // namespace Media
@@ -0,0 +1,175 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "media/streaming/media_streaming_reader.h"
+
+#include <cstring>
+
+namespace Media {
+namespace Streaming {
+namespace {
+
+// 2 MB are requested ahead of the read position.
+constexpr auto kPrefetchParts = 16;
+
+// 16 MB of the loaded parts are held in memory.
+constexpr auto kMaxCachedParts = 128;
+
+} // namespace
+
+Reader::Reader(std::unique_ptr<Loader> loader)
+: _size(loader->size())
+, _loader(std::move(loader)) {
+	_loader->setPartHandler([=](LoadedPart &&part) {
+		partLoaded(std::move(part));
+	});
+}
+
+int Reader::size() const {
+	return _size;
+}
+
+bool Reader::fill(
+		int offset,
+		int count,
+		char *to,
+		const std::atomic<bool> &cancelled) {
+	Expects(offset >= 0 && count > 0 && offset + count <= _size);
+
+	const auto fromIndex = offset / kPartSize;
+	const auto tillIndex = (offset + count - 1) / kPartSize;
+	auto loads = std::vector<int>();
+	auto cancels = std::vector<int>();
+	{
+		QMutexLocker lock(&_mutex);
+		if (_failed || _stopped) {
+			return false;
+		}
+		cancels = computeCancels(fromIndex, tillIndex);
+		loads = computeLoads(fromIndex, tillIndex);
+	}
+
+	// The loader may call partLoaded() right from these calls.
+	for (const auto partOffset : cancels) {
+		_loader->cancel(partOffset);
+	}
+	for (const auto partOffset : loads) {
+		_loader->load(partOffset);
+	}
+
+	QMutexLocker lock(&_mutex);
+	while (!ready(fromIndex, tillIndex)) {
+		if (_failed || _stopped || cancelled) {
+			return false;
+		}
+		_partsChanged.wait(&_mutex);
+	}
+	copy(offset, count, to);
+	pruneParts(fromIndex, tillIndex);
+	return true;
+}
+
+void Reader::wakeWaiting() {
+	QMutexLocker lock(&_mutex);
+	_partsChanged.wakeAll();
+}
+
+void Reader::stop() {
+	{
+		QMutexLocker lock(&_mutex);
+		if (_stopped) {
+			return;
+		}
+		_stopped = true;
+		_partsChanged.wakeAll();
+	}
+	_loader->stop();
+}
+
+void Reader::partLoaded(LoadedPart &&part) {
+	QMutexLocker lock(&_mutex);
+	if (!part.valid(_size)) {
+		_failed = true;
+	} else {
+		const auto index = part.offset / kPartSize;
+		_requested.remove(index);
+		_parts[index] = std::move(part.bytes);
+	}
+	_partsChanged.wakeAll();
+}
+
+std::vector<int> Reader::computeLoads(int fromIndex, int tillIndex) {
+	const auto partsCount = (_size + kPartSize - 1) / kPartSize;
+	const auto prefetchTill = std::min(tillIndex + kPrefetchParts, partsCount - 1);
+	auto result = std::vector<int>();
+	for (auto index = fromIndex; index <= prefetchTill; ++index) {
+		if (!_parts.contains(index) && !_requested.contains(index)) {
+			_requested.insert(index);
+			result.push_back(index * kPartSize);
+		}
+	}
+	return result;
+}
+
+std::vector<int> Reader::computeCancels(int fromIndex, int tillIndex) {
+	const auto keepFrom = fromIndex - 1;
+	const auto keepTill = tillIndex + kPrefetchParts;
+	auto result = std::vector<int>();
+	for (auto i = _requested.begin(); i != _requested.end();) {
+		const auto index = *i;
+		if (index < keepFrom || index > keepTill) {
+			result.push_back(index * kPartSize);
+			i = _requested.erase(i);
+		} else {
+			++i;
+		}
+	}
+	return result;
+}
+
+void Reader::pruneParts(int fromIndex, int tillIndex) {
+	while (int(_parts.size()) > kMaxCachedParts) {
+		const auto before = fromIndex - _parts.front().first;
+		const auto after = _parts.back().first - tillIndex;
+		if (before <= 0 && after <= 0) {
+			break;
+		} else if (before >= after) {
+			_parts.erase(_parts.begin());
+		} else {
+			_parts.erase(_parts.end() - 1);
+		}
+	}
+}
+
+bool Reader::ready(int fromIndex, int tillIndex) const {
+	for (auto index = fromIndex; index <= tillIndex; ++index) {
+		if (!_parts.contains(index)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void Reader::copy(int offset, int count, char *to) const {
+	while (count > 0) {
+		const auto index = offset / kPartSize;
+		const auto &bytes = _parts.find(index)->second;
+		const auto skip = offset - index * kPartSize;
+		const auto amount = std::min(count, bytes.size() - skip);
+		memcpy(to, bytes.constData() + skip, amount);
+		to += amount;
+		offset += amount;
+		count -= amount;
+	}
+}
+
+Reader::~Reader() {
+	stop();
+}
+
+} // namespace Streaming
+} // namespace Media
@@ -0,0 +1,74 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "media/streaming/media_streaming_loader.h"
+#include "base/flat_map.h"
+#include "base/flat_set.h"
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include <atomic>
+
+namespace Media {
+namespace Streaming {
+
+// Sparse cache of the file parts, filled by the Loader on demand.
+//
+// Reading from some offset requests the parts covering it and the parts
+// following it, so that the playback doesn't wait for each next part.
+// Parts far from the read position are cancelled or dropped.
+class Reader final {
+public:
+	explicit Reader(std::unique_ptr<Loader> loader);
+	Reader(const Reader &other) = delete;
+	Reader &operator=(const Reader &other) = delete;
+
+	int size() const;
+
+	// Copies the bytes from the offset, waiting for the parts to be
+	// loaded. Returns false if the loading has failed, the reader was
+	// stopped or the cancelled flag was set before wakeWaiting() call.
+	bool fill(
+		int offset,
+		int count,
+		char *to,
+		const std::atomic<bool> &cancelled);
+	void wakeWaiting();
+
+	void stop();
+
+	~Reader();
+
+private:
+	void partLoaded(LoadedPart &&part);
+
+	// Both return the offsets for the loader and are called under _mutex.
+	std::vector<int> computeLoads(int fromIndex, int tillIndex);
+	std::vector<int> computeCancels(int fromIndex, int tillIndex);
+	void pruneParts(int fromIndex, int tillIndex);
+
+	bool ready(int fromIndex, int tillIndex) const;
+	void copy(int offset, int count, char *to) const;
+
+	const int _size = 0;
+
+	mutable QMutex _mutex;
+	QWaitCondition _partsChanged;
+	base::flat_map<int, QByteArray> _parts;
+	base::flat_set<int> _requested;
+	bool _failed = false;
+	bool _stopped = false;
+
+	const std::unique_ptr<Loader> _loader;
+
+};
+
+} // namespace Streaming
+} // namespace Media
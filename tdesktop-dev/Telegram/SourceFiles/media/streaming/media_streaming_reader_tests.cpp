@@ -0,0 +1,226 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "media/streaming/media_streaming_reader.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+
+namespace {
+
+using namespace Media::Streaming;
+
+constexpr auto kFileSize = 20 * kPartSize + 1234;
+constexpr auto kReadBlock = 32 * 1024;
+
+// Serves the parts of a local file from its own thread with a delay,
+// the same way network requests are answered some time later.
+class SlowLoader final : public Loader {
+public:
+	SlowLoader(const QString &path, std::chrono::milliseconds delay)
+	: _file(path)
+	, _delay(delay)
+	, _thread([=] { run(); }) {
+		_file.open(QIODevice::ReadOnly);
+	}
+
+	int size() const override {
+		return int(_file.size());
+	}
+	void setPartHandler(PartHandler handler) override {
+		_handler = std::move(handler);
+	}
+	void load(int offset) override {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_queue.push_back(offset);
+		_loads.insert(offset);
+		_changed.notify_all();
+	}
+	void cancel(int offset) override {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_queue.erase(std::remove(begin(_queue), end(_queue), offset), end(_queue));
+	}
+	void stop() override {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_stopped = true;
+		_changed.notify_all();
+	}
+
+	std::set<int> loads() const {
+		std::unique_lock<std::mutex> lock(_mutex);
+		return _loads;
+	}
+	void failAt(int offset) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_failAt = offset;
+	}
+	void pause() {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_paused = true;
+	}
+
+	~SlowLoader() {
+		stop();
+		_thread.join();
+	}
+
+private:
+	void run() {
+		while (true) {
+			auto offset = 0;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_changed.wait(lock, [&] {
+					return _stopped || (!_paused && !_queue.empty());
+				});
+				if (_stopped) {
+					return;
+				}
+				offset = _queue.front();
+				_queue.pop_front();
+			}
+			std::this_thread::sleep_for(_delay);
+
+			auto part = LoadedPart();
+			if (offset == _failAt) {
+				part.offset = LoadedPart::kFailedOffset;
+			} else {
+				part.offset = offset;
+				_file.seek(offset);
+				part.bytes = _file.read(kPartSize);
+			}
+			_handler(std::move(part));
+		}
+	}
+
+	QFile _file;
+	std::chrono::milliseconds _delay;
+	PartHandler _handler;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _changed;
+	std::deque<int> _queue;
+	std::set<int> _loads;
+	int _failAt = -2;
+	bool _paused = false;
+	bool _stopped = false;
+
+	std::thread _thread;
+
+};
+
+QByteArray RandomBytes(int size) {
+	auto generator = std::mt19937(42);
+	auto distribution = std::uniform_int_distribution<int>(0, 255);
+	auto result = QByteArray(size, Qt::Uninitialized);
+	for (auto i = 0; i != size; ++i) {
+		result[i] = char(distribution(generator));
+	}
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("streaming reader gives the local file content", "[streaming]") {
+	const auto path = QDir::currentPath() + "/streaming_reader_test";
+	const auto content = RandomBytes(kFileSize);
+	{
+		QFile file(path);
+		REQUIRE(file.open(QIODevice::WriteOnly));
+		REQUIRE(file.write(content) == content.size());
+	}
+	const auto notCancelled = std::atomic<bool>(false);
+
+	SECTION("sequential reading") {
+		auto owned = std::make_unique<SlowLoader>(
+			path,
+			std::chrono::milliseconds(1));
+		const auto loader = owned.get();
+		auto reader = Reader(std::move(owned));
+		REQUIRE(reader.size() == kFileSize);
+
+		auto result = QByteArray(kFileSize, Qt::Uninitialized);
+		for (auto offset = 0; offset < kFileSize; offset += kReadBlock) {
+			const auto count = std::min(kReadBlock, kFileSize - offset);
+			REQUIRE(reader.fill(
+				offset,
+				count,
+				result.data() + offset,
+				notCancelled));
+		}
+		REQUIRE(result == content);
+		REQUIRE(loader->loads().size() == (kFileSize / kPartSize) + 1);
+	}
+
+	SECTION("seeking loads only the parts around the read position") {
+		auto owned = std::make_unique<SlowLoader>(
+			path,
+			std::chrono::milliseconds(5));
+		const auto loader = owned.get();
+		auto reader = Reader(std::move(owned));
+
+		// Like the demuxer reading the index from the end of the file.
+		auto tail = QByteArray(100, Qt::Uninitialized);
+		REQUIRE(reader.fill(kFileSize - 100, 100, tail.data(), notCancelled));
+		REQUIRE(tail == content.mid(kFileSize - 100));
+		REQUIRE(loader->loads() == std::set<int>{ 20 * kPartSize });
+
+		const auto offset = 2 * kPartSize - 10;
+		auto middle = QByteArray(20, Qt::Uninitialized);
+		REQUIRE(reader.fill(offset, 20, middle.data(), notCancelled));
+		REQUIRE(middle == content.mid(offset, 20));
+		REQUIRE(loader->loads().count(0) == 0);
+		REQUIRE(loader->loads().count(kPartSize) == 1);
+		REQUIRE(loader->loads().count(2 * kPartSize) == 1);
+	}
+
+	SECTION("failed part fails the reading") {
+		auto owned = std::make_unique<SlowLoader>(
+			path,
+			std::chrono::milliseconds(1));
+		owned->failAt(kPartSize);
+		auto reader = Reader(std::move(owned));
+
+		auto result = QByteArray(kReadBlock, Qt::Uninitialized);
+		REQUIRE(!reader.fill(
+			kPartSize + 1,
+			kReadBlock,
+			result.data(),
+			notCancelled));
+		REQUIRE(!reader.fill(0, kReadBlock, result.data(), notCancelled));
+	}
+
+	SECTION("waiting can be cancelled") {
+		auto owned = std::make_unique<SlowLoader>(
+			path,
+			std::chrono::milliseconds(1));
+		owned->pause();
+		auto reader = Reader(std::move(owned));
+
+		auto cancelled = std::atomic<bool>(false);
+		auto waker = std::thread([&] {
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			cancelled = true;
+			reader.wakeWaiting();
+		});
+		auto result = QByteArray(kReadBlock, Qt::Uninitialized);
+		REQUIRE(!reader.fill(0, kReadBlock, result.data(), cancelled));
+		waker.join();
+	}
+
+	QFile(path).remove();
+}
@@ -18,6 +18,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/image/image.h"
 #include "ui/text_options.h"
 #include "media/media_clip_reader.h"
+#include "media/streaming/media_streaming_reader.h"
 #include "media/view/media_clip_controller.h"
 #include "media/view/media_view_group_thumbs.h"
 #include "media/media_audio.h"
@@ -243,6 +244,7 @@ bool MediaView::gifShown() const {
 
 void MediaView::stopGif() {
 	_gif = nullptr;
+	_streamed = nullptr;
 	_videoPaused = _videoStopped = _videoIsSilent = false;
 	_fullScreenVideo = false;
 	_clipController.destroy();
@@ -1790,6 +1792,9 @@ void MediaView::initAnimation() {
 	} else if (location.accessEnable()) {
 		createClipReader();
 		location.accessDisable();
+	} else if (_doc->isVideoFile() && prepareStreamed()) {
+		_autoplayVideoDocument = _doc;
+		createClipReader();
 	} else if (_doc->dimensions.width() && _doc->dimensions.height()) {
 		auto w = _doc->dimensions.width();
 		auto h = _doc->dimensions.height();
@@ -1800,6 +1805,42 @@ void MediaView::initAnimation() {
 	}
 }
 
+bool MediaView::prepareStreamed() {
+	if (!_streamed) {
+		if (auto loader = _doc->createStreamingLoader()) {
+			_streamed = std::make_shared<Media::Streaming::Reader>(
+				std::move(loader));
+		}
+	}
+	return (_streamed != nullptr);
+}
+
+Media::Clip::ReaderPointer MediaView::makeClipReader(TimeMs positionMs) {
+	const auto mode = (_doc->isVideoFile() || _doc->isVideoMessage())
+		? Media::Clip::Reader::Mode::Video
+		: Media::Clip::Reader::Mode::Gif;
+	auto callback = [=](Media::Clip::Notification notification) {
+		clipCallback(notification);
+	};
+	if (_streamed && _doc->loaded()) {
+		_streamed = nullptr;
+	}
+	return _streamed
+		? Media::Clip::MakeReader(
+			_streamed,
+			_doc,
+			_msgid,
+			std::move(callback),
+			mode,
+			positionMs)
+		: Media::Clip::MakeReader(
+			_doc,
+			_msgid,
+			std::move(callback),
+			mode,
+			positionMs);
+}
+
 void MediaView::createClipReader() {
 	if (_gif) return;
 
@@ -1814,12 +1855,7 @@ void MediaView::createClipReader() {
 	} else {
 		_current = _doc->thumb->pixNoCache(fileOrigin(), _doc->thumb->width(), _doc->thumb->height(), VideoThumbOptions(_doc), st::mediaviewFileIconSize, st::mediaviewFileIconSize);
 	}
-	auto mode = (_doc->isVideoFile() || _doc->isVideoMessage())
-		? Media::Clip::Reader::Mode::Video
-		: Media::Clip::Reader::Mode::Gif;
-	_gif = Media::Clip::MakeReader(_doc, _msgid, [this](Media::Clip::Notification notification) {
-		clipCallback(notification);
-	}, mode);
+	_gif = makeClipReader();
 
 	// Correct values will be set when gif gets inited.
 	_videoPaused = _videoIsSilent = _videoStopped = false;
@@ -1959,9 +1995,7 @@ void MediaView::restartVideoAtSeekPosition(TimeMs positionMs) {
 		auto rounding = (_doc && _doc->isVideoMessage()) ? ImageRoundRadius::Ellipse : ImageRoundRadius::None;
 		_current = _gif->current(_gif->width() / cIntRetinaFactor(), _gif->height() / cIntRetinaFactor(), _gif->width() / cIntRetinaFactor(), _gif->height() / cIntRetinaFactor(), rounding, RectPart::AllCorners, getms());
 	}
-	_gif = Media::Clip::MakeReader(_doc, _msgid, [this](Media::Clip::Notification notification) {
-		clipCallback(notification);
-	}, Media::Clip::Reader::Mode::Video, positionMs);
+	_gif = makeClipReader(positionMs);
 
 	// Correct values will be set when gif gets inited.
 	_videoPaused = _videoIsSilent = _videoStopped = false;
@@ -23,6 +23,9 @@ class Controller;
 namespace View {
 class GroupThumbs;
 } // namespace View
+namespace Streaming {
+class Reader;
+} // namespace Streaming
 } // namespace Media
 
 namespace Ui {
@@ -214,7 +217,9 @@ private:
 	void refreshCaptionGeometry();
 
 	void initAnimation();
+	bool prepareStreamed();
 	void createClipReader();
+	Media::Clip::ReaderPointer makeClipReader(TimeMs positionMs = 0);
 
 	void initThemePreview();
 	void destroyThemePreview();
@@ -299,6 +304,7 @@ private:
 	int32 _dragging = 0;
 	QPixmap _current;
 	Media::Clip::ReaderPointer _gif;
+	std::shared_ptr<Media::Streaming::Reader> _streamed;
 	int32 _full = -1; // -1 - thumb, 0 - medium, 1 - full
 
 	// Video without audio stream playback information.
@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/rpc_sender.h"
 #include "mtproto/dc_options.h"
 #include "mtproto/connection_abstract.h"
+#include "mtproto/mtp_trace.h"
 #include "zlib.h"
 #include "messenger.h"
 #include "core/launcher.h"
@@ -1545,6 +1546,12 @@ void ConnectionPrivate::handleReceived() {
 		auto end = from + (messageLength / kIntSize);
 		auto sfrom = decryptedInts + 4U; // msg_id + seq_no + length + message
 		MTP_LOG(_shiftedDcId, ("Recv: ") + mtpTextSerialize(sfrom, end));
+		MTP_TRACE(
+			MTP::Trace::Event::Receive,
+			_shiftedDcId,
+			msgId,
+			(from < end) ? mtpTypeId(*from) : mtpTypeId(0),
+			messageLength);
 
 		bool needToHandle = false;
 		{
@@ -3042,6 +3049,7 @@ void ConnectionPrivate::handleError(int errorCode) {
 		}
 	}
 	MTP_LOG(_shiftedDcId, ("Restarting after error in connection, error code: %1...").arg(errorCode));
+	MTP_TRACE(MTP::Trace::Event::Restart, _shiftedDcId);
 	return restart();
 }
 
@@ -3130,6 +3138,12 @@ bool ConnectionPrivate::sendSecureRequest(
 
 	auto from = request->constData() + 4;
 	MTP_LOG(_shiftedDcId, ("Send: ") + mtpTextSerialize(from, from + messageSize));
+	MTP_TRACE(
+		MTP::Trace::Event::Send,
+		_shiftedDcId,
+		*reinterpret_cast<const uint64*>(from),
+		mtpTypeId(from[4]),
+		messageSize * sizeof(mtpPrime));
 
 #ifdef TDESKTOP_MTPROTO_OLD
 	uint32 padding = fullSize - 4 - messageSize;
@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "mtproto/connection_http.h"
 
+#include "mtproto/mtp_trace.h"
 #include "base/qthelp_url.h"
 
 namespace MTP {
@@ -43,6 +44,7 @@ void HttpConnection::sendData(mtpBuffer &&buffer) {
 	request.setHeader(QNetworkRequest::ContentTypeHeader, QVariant(qsl("application/x-www-form-urlencoded")));
 
 	TCP_LOG(("HTTP Info: sending %1 len request").arg(requestSize));
+	MTP_TRACE(MTP::Trace::Event::HttpWrite, 0, 0, 0, requestSize);
 	_requests.insert(_manager.post(request, QByteArray((const char*)(&buffer[2]), requestSize)));
 }
 
@@ -88,6 +90,7 @@ void HttpConnection::connectToServer(
 mtpBuffer HttpConnection::handleResponse(QNetworkReply *reply) {
 	QByteArray response = reply->readAll();
 	TCP_LOG(("HTTP Info: read %1 bytes").arg(response.size()));
+	MTP_TRACE(MTP::Trace::Event::HttpRead, 0, 0, 0, response.size());
 
 	if (response.isEmpty()) return mtpBuffer();
 
@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "mtproto/connection_tcp.h"
 
+#include "mtproto/mtp_trace.h"
 #include "base/bytes.h"
 #include "base/openssl_help.h"
 #include "base/qthelp_url.h"
@@ -395,6 +396,12 @@ mtpBuffer TcpConnection::parsePacket(bytes::const_span bytes) {
 	const auto packet = _protocol->readPacket(bytes);
 	TCP_LOG(("TCP Info: packet received, size = %1"
 		).arg(packet.size()));
+	MTP_TRACE(
+		MTP::Trace::Event::TcpRead,
+		_protocolDcId,
+		0,
+		0,
+		packet.size());
 	const auto ints = gsl::make_span(
 		reinterpret_cast<const mtpPrime*>(packet.data()),
 		packet.size() / sizeof(mtpPrime));
@@ -557,6 +564,12 @@ void TcpConnection::sendBuffer(mtpBuffer &&buffer) {
 	// buffer: 2 available int-s + data + available int.
 	const auto bytes = _protocol->finalizePacket(buffer);
 	TCP_LOG(("TCP Info: write packet %1 bytes").arg(bytes.size()));
+	MTP_TRACE(
+		MTP::Trace::Event::TcpWrite,
+		_protocolDcId,
+		0,
+		0,
+		bytes.size());
 	aesCtrEncrypt(bytes, _sendKey, &_sendState);
 	_socket.write(
 		reinterpret_cast<const char*>(bytes.data()),
@@ -0,0 +1,139 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/mtp_trace.h"
+
+namespace MTP {
+namespace Trace {
+namespace {
+
+constexpr auto kCapacity = uint32(64 * 1024); // 2 MB file.
+
+class TraceFile {
+public:
+	explicit TraceFile(const QString &path);
+
+	bool valid() const;
+	void write(
+		Event event,
+		int32 dcId,
+		uint64 msgId,
+		mtpTypeId typeId,
+		uint32 size);
+
+	~TraceFile();
+
+private:
+	QFile _file;
+	Header *_header = nullptr;
+	Record *_records = nullptr;
+	std::atomic<uint64> _sequence = 0;
+
+};
+
+bool TraceEnabled = false;
+std::atomic<TraceFile*> TraceData = nullptr;
+
+TraceFile::TraceFile(const QString &path) : _file(path) {
+	const auto size = sizeof(Header) + sizeof(Record) * kCapacity;
+	if (!_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+		return;
+	} else if (!_file.resize(size)) {
+		return;
+	}
+	const auto data = _file.map(0, size);
+	if (!data) {
+		return;
+	}
+	memset(data, 0, size);
+	_header = reinterpret_cast<Header*>(data);
+	*_header = Header();
+	_header->recordSize = sizeof(Record);
+	_header->capacity = kCapacity;
+	_header->startTime = QDateTime::currentMSecsSinceEpoch();
+	_records = reinterpret_cast<Record*>(data + sizeof(Header));
+}
+
+bool TraceFile::valid() const {
+	return (_records != nullptr);
+}
+
+void TraceFile::write(
+		Event event,
+		int32 dcId,
+		uint64 msgId,
+		mtpTypeId typeId,
+		uint32 size) {
+	Expects(valid());
+
+	const auto sequence = ++_sequence;
+	auto &record = _records[(sequence - 1) % kCapacity];
+	record.sequence = 0;
+	std::atomic_thread_fence(std::memory_order_release);
+	record.msgId = msgId;
+	record.time = uint32(QDateTime::currentMSecsSinceEpoch()
+		- _header->startTime);
+	record.typeId = typeId;
+	record.size = size;
+	record.dcId = int16(dcId);
+	record.event = event;
+	std::atomic_thread_fence(std::memory_order_release);
+	record.sequence = sequence;
+}
+
+TraceFile::~TraceFile() {
+	if (_header) {
+		_file.unmap(reinterpret_cast<uchar*>(_header));
+	}
+}
+
+} // namespace
+
+void SetEnabled(bool enabled) {
+	TraceEnabled = enabled;
+}
+
+bool Enabled() {
+	return TraceEnabled;
+}
+
+void Start(const QString &path) {
+	if (!TraceEnabled || TraceData.load()) {
+		return;
+	}
+	auto data = std::make_unique<TraceFile>(path);
+	if (!data->valid()) {
+		LOG(("MTP Error: Could not start binary trace in '%1'.").arg(path));
+		return;
+	}
+	LOG(("MTP Info: Binary trace started in '%1'.").arg(path));
+	TraceData = data.release();
+}
+
+void Finish() {
+	// Records being written from other threads could still use the
+	// mapped memory, so we finish only when all the MTP threads are done.
+	delete TraceData.exchange(nullptr);
+}
+
+bool Active() {
+	return (TraceData.load(std::memory_order_relaxed) != nullptr);
+}
+
+void WriteRecord(
+		Event event,
+		int32 dcId,
+		uint64 msgId,
+		mtpTypeId typeId,
+		uint32 size) {
+	if (const auto data = TraceData.load(std::memory_order_acquire)) {
+		data->write(event, dcId, msgId, typeId, size);
+	}
+}
+
+} // namespace Trace
+} // namespace MTP
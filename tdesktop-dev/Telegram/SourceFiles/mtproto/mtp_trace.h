@@ -0,0 +1,39 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/core_types.h"
+#include "mtproto/mtp_trace_format.h"
+
+namespace MTP {
+namespace Trace {
+
+// Binary trace of sent / received packets, written to a memory mapped
+// ring file in DebugLogs, see mtp_trace_format.h for the layout.
+// Recording a packet is a few stores, so it can be kept on in production.
+void SetEnabled(bool enabled);
+bool Enabled();
+
+// Does nothing if the trace is not enabled.
+void Start(const QString &path);
+void Finish();
+
+// True if the trace file is started and mapped.
+bool Active();
+
+void WriteRecord(
+	Event event,
+	int32 dcId,
+	uint64 msgId = 0,
+	mtpTypeId typeId = 0,
+	uint32 size = 0);
+
+} // namespace Trace
+} // namespace MTP
+
+#define MTP_TRACE(...) { if (MTP::Trace::Active()) MTP::Trace::WriteRecord(__VA_ARGS__); }
@@ -0,0 +1,59 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <cstdint>
+
+// This header is shared with the offline trace decoder,
+// so it should not depend on anything but the standard library.
+
+namespace MTP {
+namespace Trace {
+
+constexpr auto kMagic = uint32_t(0x52544454); // "TDTR"
+constexpr auto kVersion = uint32_t(1);
+
+enum class Event : uint8_t {
+	Empty = 0,
+	Send = 1,
+	Receive = 2,
+	TcpWrite = 3,
+	TcpRead = 4,
+	HttpWrite = 5,
+	HttpRead = 6,
+	Restart = 7,
+};
+
+struct Header {
+	uint32_t magic = kMagic;
+	uint32_t version = kVersion;
+	uint32_t recordSize = 0;
+	uint32_t capacity = 0;
+
+	// All record times are relative to this one, in ms since epoch.
+	uint64_t startTime = 0;
+	uint64_t reserved = 0;
+};
+static_assert(sizeof(Header) == 32, "Bad trace header size.");
+
+// Records are written to a ring, slot index is (sequence - 1) % capacity.
+// The sequence is written last, zero sequence marks an empty slot.
+struct Record {
+	uint64_t sequence = 0;
+	uint64_t msgId = 0;
+	uint32_t time = 0;
+	uint32_t typeId = 0;
+	uint32_t size = 0;
+	int16_t dcId = 0;
+	Event event = Event::Empty;
+	uint8_t reserved = 0;
+};
+static_assert(sizeof(Record) == 32, "Bad trace record size.");
+
+} // namespace Trace
+} // namespace MTP
@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/toast/toast.h"
 #include "mainwidget.h"
 #include "data/data_session.h"
+#include "data/data_waveforms.h"
 #include "storage/localstorage.h"
 #include "boxes/confirm_box.h"
 #include "lang/lang_cloud_manager.h"
@@ -23,8 +24,96 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "window/themes/window_theme.h"
 #include "window/themes/window_theme_editor.h"
 #include "media/media_audio_track.h"
+#include "media/media_clip_stress_test.h"
+#include "ui/text/text_benchmark.h"
+#include "ui/emoji_benchmark.h"
+#include "ui/image/image_prepare_benchmark.h"
+#include "ui/image/image_pixmap_cache.h"
 
 namespace Settings {
+namespace {
+
+constexpr auto kClipStressCount = 50;
+constexpr auto kClipStressDuration = TimeMs(10000);
+
+QString FrameStatsReport() {
+	const auto stats = anim::TakeFrameStats();
+	return qsl("Frame interval: %1 ms\n"
+		"Frames: %2, late: %3\n"
+		"Step time: %4 ms average, %5 ms max\n"
+		"Clip notifications: %6, skipped: %7"
+		).arg(stats.interval
+		).arg(stats.frames
+		).arg(stats.late
+		).arg(stats.frames ? (stats.stepsDuration / stats.frames) : 0
+		).arg(stats.maxStepDuration
+		).arg(stats.clipNotifications
+		).arg(stats.clipNotificationsSkipped);
+}
+
+QString PixmapCacheReport() {
+	const auto stats = Images::Pixmaps().stats();
+	const auto megabytes = [](int64 bytes) {
+		return bytes / (1024 * 1024);
+	};
+	const auto requests = stats.hits + stats.misses;
+	return qsl("Image cache variants: %1, %2 / %3 MB\n"
+		"Hits: %4 of %5 (%6%)\n"
+		"Evicted: %7, %8 MB"
+		).arg(stats.count
+		).arg(megabytes(stats.usage)
+		).arg(megabytes(stats.limit)
+		).arg(stats.hits
+		).arg(requests
+		).arg(requests ? (stats.hits * 100 / requests) : 0
+		).arg(stats.evicted
+		).arg(megabytes(stats.evictedBytes));
+}
+
+void ShowBenchmarksReport(const QStringList &reports) {
+	const auto report = reports.join(qsl("\n\n"));
+	LOG(("Benchmarks:\n%1").arg(report));
+	Ui::show(Box<InformBox>(report));
+}
+
+// Voice messages from the paths go to the waveform benchmark and the
+// first other file is used for the clip stress test.
+void RunBenchmarks(const QStringList &paths) {
+	// Take the collected stats before the benchmarks affect them.
+	auto reports = QStringList();
+	reports.push_back(FrameStatsReport());
+	reports.push_back(PixmapCacheReport());
+	reports.push_back(Ui::BenchmarkTextResize(10000));
+	reports.push_back(Ui::Emoji::BenchmarkFind(10000));
+	reports.push_back(Images::BenchmarkPrepare(1000));
+
+	auto voices = QStringList();
+	auto clip = QString();
+	for (const auto &path : paths) {
+		if (path.endsWith(qstr(".ogg"), Qt::CaseInsensitive)
+			|| path.endsWith(qstr(".opus"), Qt::CaseInsensitive)) {
+			voices.push_back(path);
+		} else if (clip.isEmpty()) {
+			clip = path;
+		}
+	}
+	if (!voices.isEmpty()) {
+		reports.push_back(Data::BenchmarkWaveforms(voices));
+	}
+	if (clip.isEmpty()) {
+		ShowBenchmarksReport(reports);
+		return;
+	}
+	Media::Clip::RunStressTest(
+		clip,
+		kClipStressCount,
+		kClipStressDuration,
+		[=](const QString &report) {
+			ShowBenchmarksReport(reports + QStringList(report));
+		});
+}
+
+} // namespace
 
 auto GenerateCodes() {
 	auto codes = std::map<QString, Fn<void()>>();
@@ -118,6 +207,18 @@ auto GenerateCodes() {
 		Platform::RegisterCustomScheme();
 		Ui::Toast::Show("Forced custom scheme register.");
 	});
+	codes.emplace(qsl("benchmark"), [] {
+		if (!Logs::DebugEnabled()) {
+			Ui::show(Box<InformBox>("Benchmarks are available only with DEBUG logs enabled."));
+			return;
+		}
+		const auto filter = qsl("Animations and voice messages (*.gif *.mp4 *.ogg *.opus);;") + FileDialog::AllFilesFilter();
+		FileDialog::GetOpenPaths(Messenger::Instance().getFileDialogParent(), "Open files for benchmarks", filter, [](const FileDialog::OpenResult &result) {
+			RunBenchmarks(result.paths);
+		}, [] {
+			RunBenchmarks(QStringList());
+		});
+	});
 	codes.emplace(qsl("export"), [] {
 		Auth().data().startExport();
 	});
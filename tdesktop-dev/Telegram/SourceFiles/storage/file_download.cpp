@@ -17,6 +17,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "auth_session.h"
 #include "apiwrap.h"
 #include "core/crash_reports.h"
+#include "ui/image/image_decoder.h"
 #include "base/bytes.h"
 #include "base/openssl_help.h"
 
@@ -68,6 +69,7 @@ constexpr auto kDownloadDocumentPartSize = 128 * 1024; // 128kb for document
 constexpr auto kMaxFileQueries = 16; // max 16 file parts downloaded at the same time
 constexpr auto kMaxWebFileQueries = 8; // max 8 http[s] files downloaded at the same time
 constexpr auto kDownloadCdnPartSize = 128 * 1024; // 128kb for cdn requests
+constexpr auto kDecodeImageAsyncMinSize = 32 * 1024; // smaller images are decoded right away
 
 } // namespace
 
@@ -155,7 +157,35 @@ QImage FileLoader::imageData(const QSize &shrinkBox) const {
 	return _imageData;
 }
 
+bool FileLoader::prepareImage(const QSize &shrinkBox) {
+	if (!_imageData.isNull()
+		|| _imageRead
+		|| _locationType != UnknownFileLocation
+		|| _data.size() < kDecodeImageAsyncMinSize) {
+		return true;
+	} else if (_imageDecode) {
+		_imageDecode->renew();
+		return false;
+	}
+	_imageDecode = std::make_unique<Images::DecodeRequest>(
+		_data,
+		shrinkBox,
+		[=](Images::DecodeResult &&result) {
+			_imageDecode = nullptr;
+			if (!result.cancelled) {
+				_imageRead = true;
+				_imageData = std::move(result.image);
+				_imageFormat = std::move(result.format);
+			}
+
+			// Cancelled requests will be sent again by the visible images.
+			_downloader->taskFinished().notify();
+		});
+	return false;
+}
+
 void FileLoader::readImage(const QSize &shrinkBox) const {
+	_imageRead = true;
 	auto format = QByteArray();
 	auto image = App::readImage(_data, &format, false);
 	if (!image.isNull()) {
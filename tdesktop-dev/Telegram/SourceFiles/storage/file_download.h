@@ -11,6 +11,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_file_origin.h"
 #include "base/binary_guard.h"
 
+namespace Images {
+class DecodeRequest;
+} // namespace Images
+
 namespace Storage {
 namespace Cache {
 struct Key;
@@ -91,6 +95,10 @@ public:
 	}
 	QByteArray imageFormat(const QSize &shrinkBox = QSize()) const;
 	QImage imageData(const QSize &shrinkBox = QSize()) const;
+
+	// Decodes the loaded image in a background thread. Returns false
+	// while decoding, then imageData() has the result without waiting.
+	bool prepareImage(const QSize &shrinkBox);
 	QString fileName() const {
 		return _filename;
 	}
@@ -187,6 +195,8 @@ protected:
 	LocationType _locationType;
 
 	base::binary_guard _localLoading;
+	std::unique_ptr<Images::DecodeRequest> _imageDecode;
+	mutable bool _imageRead = false;
 	mutable QByteArray _imageFormat;
 	mutable QImage _imageData;
 
@@ -9,7 +9,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "storage/serialize_document.h"
 #include "storage/serialize_common.h"
+#include "storage/serialize_stream.h"
 #include "storage/storage_encrypted_file.h"
+#include "storage/storage_journal.h"
 #include "storage/storage_clear_legacy.h"
 #include "chat_helpers/stickers.h"
 #include "data/data_drafts.h"
@@ -25,7 +27,6 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwindow.h"
 #include "lang/lang_keys.h"
 #include "lang/lang_cloud_manager.h"
-#include "media/media_audio.h"
 #include "mtproto/dc_options.h"
 #include "messenger.h"
 #include "application.h"
@@ -36,6 +37,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_session.h"
 #include "history/history.h"
 
+#include <future>
+
 extern "C" {
 #include <openssl/evp.h>
 } // extern "C"
@@ -44,7 +47,6 @@ namespace Local {
 namespace {
 
 constexpr auto kThemeFileSizeLimit = 5 * 1024 * 1024;
-constexpr auto kFileLoaderQueueStopTimeout = TimeMs(5000);
 constexpr auto kDefaultStickerInstallDate = TimeId(1);
 constexpr auto kProxyTypeShift = 1024;
 
@@ -75,7 +77,6 @@ QString _basePath, _userBasePath, _userDbPath;
 
 bool _started = false;
 internal::Manager *_manager = nullptr;
-TaskQueue *_localLoader = nullptr;
 
 bool _working() {
 	return _manager && !_basePath.isEmpty();
@@ -92,6 +93,30 @@ enum class FileOption {
 using FileOptions = base::flags<FileOption>;
 inline constexpr auto is_flag_type(FileOption) { return true; };
 
+// Encrypted files are read and decrypted in the thread pool right after
+// the map is read, so that only deserializing is left for the main thread.
+struct PrefetchedFile {
+	bool success = false;
+	int32 version = 0;
+	QByteArray data;
+	qint64 offset = 0;
+	TimeMs duration = 0;
+};
+
+struct Prefetch {
+	QString label;
+	FileOptions options;
+	MTP::AuthKeyPtr key;
+	std::future<PrefetchedFile> result;
+};
+
+std::map<QString, Prefetch> _prefetched;
+
+// The prefetched contents are outdated as soon as the file is written.
+void _forgetPrefetched(const QString &name) {
+	_prefetched.erase(name);
+}
+
 bool keyAlreadyUsed(QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
 	name += '0';
 	if (QFileInfo(name).exists()) return true;
@@ -129,6 +154,8 @@ void clearKey(const FileKey &key, FileOptions options = FileOption::User | FileO
 		if (!_working()) return;
 	}
 
+	_forgetPrefetched(toFilePart(key));
+
 	QString base = (options & FileOption::User) ? _userBasePath : _basePath, name;
 	name.reserve(base.size() + 0x11);
 	name.append(base).append(toFilePart(key)).append('0');
@@ -147,6 +174,14 @@ bool _checkStreamStatus(QDataStream &stream) {
 	return true;
 }
 
+bool _checkStreamStatus(const Serialize::ByteReader &stream) {
+	if (!stream.ok()) {
+		LOG(("Bad data stream status: read past end"));
+		return false;
+	}
+	return true;
+}
+
 QByteArray _settingsSalt, _passKeySalt, _passKeyEncrypted;
 
 constexpr auto kLocalKeySize = MTP::AuthKey::kSize;
@@ -178,6 +213,11 @@ struct FileReadDescriptor {
 	QByteArray data;
 	QBuffer buffer;
 	QDataStream stream;
+
+	// For reading the rest of the data with Serialize::ByteReader.
+	bytes::const_span unread() const {
+		return bytes::make_span(data).subspan(buffer.pos());
+	}
 	~FileReadDescriptor() {
 		if (version) {
 			stream.setDevice(0);
@@ -228,6 +268,7 @@ struct FileWriteDescriptor {
 		} else {
 			if (!_working()) return;
 		}
+		_forgetPrefetched(name);
 
 		// detect order of read attempts and file version
 		QString toTry[2];
@@ -422,72 +463,141 @@ bool readFile(FileReadDescriptor &result, const QString &name, FileOptions optio
 	return false;
 }
 
-bool decryptLocal(EncryptedDescriptor &result, const QByteArray &encrypted, const MTP::AuthKeyPtr &key = LocalKey) {
-	if (encrypted.size() <= 16 || (encrypted.size() & 0x0F)) {
-		LOG(("App Error: bad encrypted part size: %1").arg(encrypted.size()));
-		return false;
+// The encrypted part is 128 bits of the data sha1 and the data itself.
+// Returns the size of the decrypted data, which is left right after the
+// sha1 part, or zero if the data could not be decrypted.
+uint32 decryptLocalInPlace(QByteArray &data, int offset, int size, const MTP::AuthKeyPtr &key) {
+	if (size <= 16 || (size & 0x0F)) {
+		LOG(("App Error: bad encrypted part size: %1").arg(size));
+		return 0;
 	}
-	uint32 fullLen = encrypted.size() - 16;
+	uint32 fullLen = size - 16;
 
-	QByteArray decrypted;
-	decrypted.resize(fullLen);
-	const char *encryptedKey = encrypted.constData(), *encryptedData = encrypted.constData() + 16;
-	aesDecryptLocal(encryptedData, decrypted.data(), fullLen, key, encryptedKey);
+	const auto encryptedKey = data.data() + offset;
+	const auto decrypted = encryptedKey + 16;
+	aesDecryptLocal(decrypted, decrypted, fullLen, key, encryptedKey);
 	uchar sha1Buffer[20];
-	if (memcmp(hashSha1(decrypted.constData(), decrypted.size(), sha1Buffer), encryptedKey, 16)) {
+	if (memcmp(hashSha1(decrypted, fullLen, sha1Buffer), encryptedKey, 16)) {
 		LOG(("App Info: bad decrypt key, data not decrypted - incorrect password?"));
-		return false;
+		return 0;
 	}
 
-	uint32 dataLen = *(const uint32*)decrypted.constData();
-	if (dataLen > uint32(decrypted.size()) || dataLen <= fullLen - 16 || dataLen < sizeof(uint32)) {
-		LOG(("App Error: bad decrypted part size: %1, fullLen: %2, decrypted size: %3").arg(dataLen).arg(fullLen).arg(decrypted.size()));
-		return false;
+	uint32 dataLen = *(const uint32*)decrypted;
+	if (dataLen > fullLen || dataLen <= fullLen - 16 || dataLen < sizeof(uint32)) {
+		LOG(("App Error: bad decrypted part size: %1, fullLen: %2").arg(dataLen).arg(fullLen));
+		return 0;
 	}
+	return dataLen;
+}
 
-	decrypted.resize(dataLen);
-	result.data = decrypted;
-	decrypted = QByteArray();
+bool decryptLocal(EncryptedDescriptor &result, const QByteArray &encrypted, const MTP::AuthKeyPtr &key = LocalKey) {
+	result.data = encrypted;
+	const auto dataLen = decryptLocalInPlace(result.data, 0, encrypted.size(), key);
+	if (!dataLen) {
+		result.data = QByteArray();
+		return false;
+	}
+	result.data.resize(16 + dataLen);
 
 	result.buffer.setBuffer(&result.data);
 	result.buffer.open(QIODevice::ReadOnly);
-	result.buffer.seek(sizeof(uint32)); // skip len
+	result.buffer.seek(16 + sizeof(uint32)); // skip sha1 part and len
 	result.stream.setDevice(&result.buffer);
 	result.stream.setVersion(QDataStream::Qt_5_1);
 
 	return true;
 }
 
-bool readEncryptedFile(FileReadDescriptor &result, const QString &name, FileOptions options = FileOption::User | FileOption::Safe, const MTP::AuthKeyPtr &key = LocalKey) {
+// The encrypted part is decrypted right in the buffer the file was read
+// to, so the file contents are not copied anywhere while reading.
+bool readEncryptedFileDirectly(FileReadDescriptor &result, const QString &name, FileOptions options, const MTP::AuthKeyPtr &key) {
 	if (!readFile(result, name, options)) {
 		return false;
 	}
-	QByteArray encrypted;
-	result.stream >> encrypted;
+	result.stream.setDevice(0);
+	if (result.buffer.isOpen()) result.buffer.close();
+	result.buffer.setBuffer(0);
 
-	EncryptedDescriptor data;
-	if (!decryptLocal(data, encrypted, key)) {
-		result.stream.setDevice(0);
-		if (result.buffer.isOpen()) result.buffer.close();
-		result.buffer.setBuffer(0);
+	auto header = Serialize::ByteReader(bytes::make_span(result.data));
+	auto encryptedSize = quint32(0);
+	header >> encryptedSize;
+	const auto offset = int(sizeof(quint32));
+	const auto dataLen = (header.ok() && qint64(encryptedSize) <= header.remaining())
+		? decryptLocalInPlace(result.data, offset, encryptedSize, key)
+		: 0;
+	if (!dataLen) {
 		result.data = QByteArray();
 		result.version = 0;
 		return false;
 	}
+	result.data.resize(offset + 16 + dataLen);
 
-	result.stream.setDevice(0);
-	if (result.buffer.isOpen()) result.buffer.close();
-	result.buffer.setBuffer(0);
-	result.data = data.data;
 	result.buffer.setBuffer(&result.data);
 	result.buffer.open(QIODevice::ReadOnly);
-	result.buffer.seek(data.buffer.pos());
+	result.buffer.seek(offset + 16 + sizeof(uint32)); // skip sha1 part and len
 	result.stream.setDevice(&result.buffer);
 	result.stream.setVersion(QDataStream::Qt_5_1);
 
 	return true;
 }
 
+void prefetchEncryptedFile(const QString &label, const QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
+	auto promise = std::make_shared<std::promise<PrefetchedFile>>();
+	auto &prefetch = _prefetched[name];
+	prefetch.label = label;
+	prefetch.options = options;
+	prefetch.key = LocalKey;
+	prefetch.result = promise->get_future();
+	crl::async([=, key = LocalKey] {
+		const auto started = getms(true);
+		auto result = PrefetchedFile();
+		FileReadDescriptor file;
+		result.success = readEncryptedFileDirectly(file, name, options, key);
+		if (result.success) {
+			result.version = file.version;
+			result.data = file.data;
+			result.offset = file.buffer.pos();
+		}
+		result.duration = getms(true) - started;
+		promise->set_value(std::move(result));
+	});
+}
+
+void prefetchEncryptedFile(const QString &label, const FileKey &fkey) {
+	if (fkey) {
+		prefetchEncryptedFile(label, toFilePart(fkey));
+	}
+}
+
+bool readEncryptedFile(FileReadDescriptor &result, const QString &name, FileOptions options = FileOption::User | FileOption::Safe, const MTP::AuthKeyPtr &key = LocalKey) {
+	const auto i = _prefetched.find(name);
+	if (i == _prefetched.end()
+		|| i->second.options.value() != options.value()
+		|| i->second.key != key) {
+		return readEncryptedFileDirectly(result, name, options, key);
+	}
+	auto prefetch = std::move(i->second);
+	_prefetched.erase(i);
+
+	const auto waitStarted = getms(true);
+	auto file = prefetch.result.get();
+	LOG(("App Info: local file '%1' read in %2 ms, waited %3 ms."
+		).arg(prefetch.label
+		).arg(file.duration
+		).arg(getms(true) - waitStarted));
+	if (!file.success) {
+		return false;
+	}
+	result.data = std::move(file.data);
+	result.version = file.version;
+	result.buffer.setBuffer(&result.data);
+	result.buffer.open(QIODevice::ReadOnly);
+	result.buffer.seek(file.offset);
+	result.stream.setDevice(&result.buffer);
+	result.stream.setVersion(QDataStream::Qt_5_1);
+	return true;
+}
+
 bool readEncryptedFile(FileReadDescriptor &result, const FileKey &fkey, FileOptions options = FileOption::User | FileOption::Safe, const MTP::AuthKeyPtr &key = LocalKey) {
 	return readEncryptedFile(result, toFilePart(fkey), options, key);
 }
@@ -634,6 +744,21 @@ FileLocationPairs _fileLocationPairs;
 typedef QMap<MediaKey, MediaKey> FileLocationAliases;
 FileLocationAliases _fileLocationAliases;
 FileKey _locationsKey = 0, _reportSpamStatusesKey = 0, _trustedBotsKey = 0;
+bool _reportSpamStatusesWereRead = false;
+
+// A location is written after each download, so the changes are appended
+// to a journal and the whole locations file is rewritten only when the
+// journal grows larger than the file itself.
+constexpr auto kLocationsJournalMinCompactSize = 64 * 1024;
+
+enum class LocationsRecord : Storage::Journal::RecordType {
+	Add = 0x01,
+	Remove = 0x02,
+	Alias = 0x03,
+};
+
+Storage::Journal _locationsJournal;
+int64 _locationsSnapshotSize = 0;
 
 using TrustedBots = OrderedSet<uint64>;
 TrustedBots _trustedBots;
@@ -641,6 +766,17 @@ bool _trustedBotsRead = false;
 
 FileKey _recentStickersKeyOld = 0;
 FileKey _installedStickersKey = 0, _featuredStickersKey = 0, _recentStickersKey = 0, _favedStickersKey = 0, _archivedStickersKey = 0;
+
+// Sticker set files are rewritten as a whole, so the requests to write
+// them are collected here and written together by the stickers timer.
+enum StickersWriteFlag {
+	StickersWriteInstalled = 0x01,
+	StickersWriteFeatured = 0x02,
+	StickersWriteRecent = 0x04,
+	StickersWriteFaved = 0x08,
+	StickersWriteArchived = 0x10,
+};
+int _stickersWritePending = 0;
 FileKey _savedGifsKey = 0;
 
 FileKey _backgroundKeyDay = 0;
@@ -665,6 +801,7 @@ qint32 _cacheTotalTimeLimit = Database::Settings().totalTimeLimit;
 FileKey _exportSettingsKey = 0;
 
 FileKey _savedPeersKey = 0;
+bool _savedPeersWereRead = false;
 FileKey _langPackKey = 0;
 FileKey _languagesKey = 0;
 
@@ -687,6 +824,76 @@ AuthSessionSettings &GetStoredAuthSessionCache() {
 
 void _writeMap(WriteMapWhen when = WriteMapWhen::Soon);
 
+QString _locationsJournalPath() {
+	return _userBasePath + toFilePart(_locationsKey) + 'j';
+}
+
+void _removeLocationsJournal() {
+	_locationsJournal.close();
+	QFile::remove(_locationsJournalPath());
+}
+
+void _removeFileLocation(MediaKey location, const QString &fname) {
+	for (auto i = _fileLocations.find(location); (i != _fileLocations.end()) && (i.key() == location);) {
+		if (i.value().fname == fname) {
+			i = _fileLocations.erase(i);
+		} else {
+			++i;
+		}
+	}
+	const auto i = _fileLocationPairs.find(fname);
+	if (i != _fileLocationPairs.end() && i.value().first == location) {
+		_fileLocationPairs.erase(i);
+	}
+}
+
+// Records are applied the same way when they are replayed over
+// the snapshot they were already written to, so that a crash between
+// writing the snapshot and clearing the journal doesn't break anything.
+void _replayLocationsRecord(
+		Storage::Journal::RecordType type,
+		bytes::const_span data) {
+	auto stream = Serialize::ByteReader(data);
+
+	quint64 first = 0, second = 0;
+	stream >> first >> second;
+	const auto location = MediaKey(first, second);
+	switch (LocationsRecord(type)) {
+	case LocationsRecord::Add: {
+		FileLocation local;
+		QByteArray bookmark;
+		stream >> local.fname >> bookmark >> local.modified >> local.size;
+		if (!_checkStreamStatus(stream)) return;
+
+		local.setBookmark(bookmark);
+		const auto i = _fileLocationPairs.constFind(local.fname);
+		if (i != _fileLocationPairs.cend()) {
+			_removeFileLocation(i.value().first, local.fname);
+		}
+		_fileLocations.insert(location, local);
+		_fileLocationPairs.insert(local.fname, FileLocationPair(location, local));
+	} break;
+
+	case LocationsRecord::Remove: {
+		QString fname;
+		stream >> fname;
+		if (!_checkStreamStatus(stream)) return;
+
+		_removeFileLocation(location, fname);
+	} break;
+
+	case LocationsRecord::Alias: {
+		quint64 vfirst = 0, vsecond = 0;
+		stream >> vfirst >> vsecond;
+		if (!_checkStreamStatus(stream)) return;
+
+		_fileLocationAliases.insert(location, MediaKey(vfirst, vsecond));
+	} break;
+
+	default: LOG(("App Error: bad locations journal record %1.").arg(type));
+	}
+}
+
 void _writeLocations(WriteMapWhen when = WriteMapWhen::Soon) {
 	if (when != WriteMapWhen::Now) {
 		_manager->writeLocations(when == WriteMapWhen::Fast);
@@ -697,6 +904,7 @@ void _writeLocations(WriteMapWhen when = WriteMapWhen::Soon) {
 	_manager->writingLocations();
 	if (_fileLocations.isEmpty()) {
 		if (_locationsKey) {
+			_removeLocationsJournal();
 			clearKey(_locationsKey);
 			_locationsKey = 0;
 			_mapChanged = true;
@@ -756,29 +964,72 @@ void _writeLocations(WriteMapWhen when = WriteMapWhen::Soon) {
 
 		FileWriteDescriptor file(_locationsKey);
 		file.writeEncrypted(data);
+
+		_locationsSnapshotSize = size;
+		const auto result = _locationsJournal.create(
+			_locationsJournalPath(),
+			cacheKey());
+		if (result != Storage::File::Result::Success) {
+			LOG(("App Error: could not start the locations journal."));
+		}
 	}
 }
 
+// Writes the change to the journal or to the whole file if that fails.
+void _appendLocationsRecord(LocationsRecord type, const QByteArray &data) {
+	if (!_locationsJournal.isOpen()
+		|| !_locationsJournal.append(
+			Storage::Journal::RecordType(type),
+			bytes::make_span(data))) {
+		_locationsJournal.close();
+		_writeLocations(WriteMapWhen::Fast);
+	} else if (_locationsJournal.size() > std::max(
+			_locationsSnapshotSize,
+			int64(kLocationsJournalMinCompactSize))) {
+		_writeLocations();
+	}
+}
+
+void _journalFileLocationAdded(MediaKey location, const FileLocation &local) {
+	auto data = QByteArray();
+	Serialize::ByteWriter(data) << quint64(location.first) << quint64(location.second) << local.name() << local.bookmark() << local.modified << quint32(local.size);
+	_appendLocationsRecord(LocationsRecord::Add, data);
+}
+
+void _journalFileLocationRemoved(MediaKey location, const QString &fname) {
+	auto data = QByteArray();
+	Serialize::ByteWriter(data) << quint64(location.first) << quint64(location.second) << fname;
+	_appendLocationsRecord(LocationsRecord::Remove, data);
+}
+
+void _journalFileLocationAlias(MediaKey alias, MediaKey location) {
+	auto data = QByteArray();
+	Serialize::ByteWriter(data) << quint64(alias.first) << quint64(alias.second) << quint64(location.first) << quint64(location.second);
+	_appendLocationsRecord(LocationsRecord::Alias, data);
+}
+
 void _readLocations() {
 	FileReadDescriptor locations;
 	if (!readEncryptedFile(locations, _locationsKey)) {
+		_removeLocationsJournal();
 		clearKey(_locationsKey);
 		_locationsKey = 0;
 		_writeMap();
 		return;
 	}
 
+	auto stream = Serialize::ByteReader(locations.unread());
 	bool endMarkFound = false;
-	while (!locations.stream.atEnd()) {
+	while (!stream.atEnd()) {
 		quint64 first, second;
 		QByteArray bookmark;
 		FileLocation loc;
 		quint32 legacyTypeField = 0;
-		locations.stream >> first >> second >> legacyTypeField >> loc.fname;
+		stream >> first >> second >> legacyTypeField >> loc.fname;
 		if (locations.version > 9013) {
-			locations.stream >> bookmark;
+			stream >> bookmark;
 		}
-		locations.stream >> loc.modified >> loc.size;
+		stream >> loc.modified >> loc.size;
 		loc.setBookmark(bookmark);
 
 		if (!first && !second && !legacyTypeField && loc.fname.isEmpty() && !loc.size) { // end mark
@@ -794,25 +1045,38 @@ void _readLocations() {
 
 	if (endMarkFound) {
 		quint32 cnt;
-		locations.stream >> cnt;
-		for (quint32 i = 0; i < cnt; ++i) {
+		stream >> cnt;
+		for (quint32 i = 0; i < cnt && stream.ok(); ++i) {
 			quint64 kfirst, ksecond, vfirst, vsecond;
-			locations.stream >> kfirst >> ksecond >> vfirst >> vsecond;
+			stream >> kfirst >> ksecond >> vfirst >> vsecond;
 			_fileLocationAliases.insert(MediaKey(kfirst, ksecond), MediaKey(vfirst, vsecond));
 		}
 
-		if (!locations.stream.atEnd()) {
+		if (!stream.atEnd()) {
 			quint32 webLocationsCount;
-			locations.stream >> webLocationsCount;
-			for (quint32 i = 0; i < webLocationsCount; ++i) {
+			stream >> webLocationsCount;
+			for (quint32 i = 0; i < webLocationsCount && stream.ok(); ++i) {
 				QString url;
 				quint64 key;
 				qint32 size;
-				locations.stream >> url >> key >> size;
+				stream >> url >> key >> size;
 				clearKey(key, FileOption::User);
 			}
 		}
 	}
+
+	_locationsSnapshotSize = locations.data.size();
+	const auto result = _locationsJournal.open(
+		_locationsJournalPath(),
+		cacheKey(),
+		_replayLocationsRecord);
+	if (result == Storage::File::Result::WrongKey
+		|| result == Storage::File::Result::Failed) {
+		LOG(("App Error: could not read the locations journal."));
+		_writeLocations(WriteMapWhen::Fast);
+	} else if (_locationsJournal.size() > _locationsSnapshotSize) {
+		_writeLocations();
+	}
 }
 
 void _writeReportSpamStatuses() {
@@ -851,6 +1115,11 @@ void _writeReportSpamStatuses() {
 }
 
 void _readReportSpamStatuses() {
+	if (_reportSpamStatusesWereRead) return;
+	_reportSpamStatusesWereRead = true;
+
+	if (!_reportSpamStatusesKey) return;
+
 	FileReadDescriptor statuses;
 	if (!readEncryptedFile(statuses, _reportSpamStatusesKey)) {
 		clearKey(_reportSpamStatusesKey);
@@ -2325,12 +2594,26 @@ ReadMapState _readMap(const QByteArray &pass) {
 		_mapChanged = false;
 	}
 
+	// Report spam statuses and saved peers are read on the first use.
+	_reportSpamStatusesWereRead = false;
+	_savedPeersWereRead = false;
+
+	prefetchEncryptedFile(qsl("locations"), _locationsKey);
+	prefetchEncryptedFile(qsl("user settings"), _userSettingsKey);
+	prefetchEncryptedFile(
+		qsl("mtp data"),
+		toFilePart(_dataNameKey),
+		FileOption::Safe);
+	prefetchEncryptedFile(qsl("installed stickers"), _installedStickersKey);
+	prefetchEncryptedFile(qsl("featured stickers"), _featuredStickersKey);
+	prefetchEncryptedFile(qsl("recent stickers"), _recentStickersKey);
+	prefetchEncryptedFile(qsl("faved stickers"), _favedStickersKey);
+	prefetchEncryptedFile(qsl("saved gifs"), _savedGifsKey);
+	prefetchEncryptedFile(qsl("export settings"), _exportSettingsKey);
+
 	if (_locationsKey) {
 		_readLocations();
 	}
-	if (_reportSpamStatusesKey) {
-		_readReportSpamStatuses();
-	}
 
 	_readUserSettings();
 	_readMtpData();
@@ -2488,9 +2771,9 @@ void finish() {
 	if (_manager) {
 		_writeMap(WriteMapWhen::Now);
 		_manager->finish();
+		_locationsJournal.close();
 		_manager->deleteLater();
 		_manager = 0;
-		delete base::take(_localLoader);
 	}
 }
 
@@ -2501,7 +2784,6 @@ void start() {
 	Expects(!_manager);
 
 	_manager = new internal::Manager();
-	_localLoader = new TaskQueue(kFileLoaderQueueStopTimeout);
 
 	_basePath = cWorkingDir() + qsl("tdata/");
 	if (!QDir().exists(_basePath)) QDir().mkpath(_basePath);
@@ -2721,10 +3003,7 @@ QString readAutoupdatePrefix() {
 }
 
 void reset() {
-	if (_localLoader) {
-		_localLoader->stop();
-	}
-
+	_prefetched.clear();
 	_passKeySalt.clear(); // reset passcode, local key
 	_draftsMap.clear();
 	_draftCursorsMap.clear();
@@ -2732,13 +3011,17 @@ void reset() {
 	_fileLocationPairs.clear();
 	_fileLocationAliases.clear();
 	_draftsNotReadMap.clear();
+	_locationsJournal.close();
+	_locationsSnapshotSize = 0;
 	_locationsKey = _reportSpamStatusesKey = _trustedBotsKey = 0;
 	_recentStickersKeyOld = 0;
 	_installedStickersKey = _featuredStickersKey = _recentStickersKey = _favedStickersKey = _archivedStickersKey = 0;
+	_stickersWritePending = 0;
 	_savedGifsKey = 0;
 	_backgroundKeyDay = _backgroundKeyNight = 0;
 	Window::Theme::Background()->reset();
 	_userSettingsKey = _recentHashtagsAndBotsKey = _savedPeersKey = _exportSettingsKey = 0;
+	_reportSpamStatusesWereRead = _savedPeersWereRead = false;
 	_oldMapVersion = _oldSettingsVersion = 0;
 	_cacheTotalSizeLimit = Database::Settings().totalSizeLimit;
 	_cacheTotalTimeLimit = Database::Settings().totalTimeLimit;
@@ -2807,6 +3090,9 @@ base::flat_set<QString> CollectGoodNames() {
 	for (const auto &value : keys) {
 		push(value);
 	}
+	if (_locationsKey) {
+		result.emplace(toFilePart(_locationsKey) + 'j');
+	}
 	return result;
 }
 
@@ -3041,7 +3327,7 @@ void writeFileLocation(MediaKey location, const FileLocation &local) {
 		if (i.value().second == local) {
 			if (i.value().first != location) {
 				_fileLocationAliases.insert(location, i.value().first);
-				_writeLocations(WriteMapWhen::Fast);
+				_journalFileLocationAlias(location, i.value().first);
 			}
 			return;
 		}
@@ -3057,7 +3343,7 @@ void writeFileLocation(MediaKey location, const FileLocation &local) {
 	}
 	_fileLocations.insert(location, local);
 	_fileLocationPairs.insert(local.fname, FileLocationPair(location, local));
-	_writeLocations(WriteMapWhen::Fast);
+	_journalFileLocationAdded(location, local);
 }
 
 FileLocation readFileLocation(MediaKey location, bool check) {
@@ -3070,9 +3356,10 @@ FileLocation readFileLocation(MediaKey location, bool check) {
 	for (FileLocations::iterator i = _fileLocations.find(location); (i != _fileLocations.end()) && (i.key() == location);) {
 		if (check) {
 			if (!i.value().check()) {
-				_fileLocationPairs.remove(i.value().fname);
+				const auto fname = i.value().fname;
+				_fileLocationPairs.remove(fname);
 				i = _fileLocations.erase(i);
-				_writeLocations();
+				_journalFileLocationRemoved(location, fname);
 				continue;
 			}
 		}
@@ -3139,78 +3426,6 @@ void updateCacheSettings(Storage::Cache::Database::SettingsUpdate &update) {
 	_writeUserSettings();
 }
 
-class CountWaveformTask : public Task {
-public:
-	CountWaveformTask(DocumentData *doc)
-		: _doc(doc)
-		, _loc(doc->location(true))
-		, _data(doc->data())
-		, _wavemax(0) {
-		if (_data.isEmpty() && !_loc.accessEnable()) {
-			_doc = 0;
-		}
-	}
-	void process() {
-		if (!_doc) return;
-
-		_waveform = audioCountWaveform(_loc, _data);
-		uchar wavemax = 0;
-		for (int32 i = 0, l = _waveform.size(); i < l; ++i) {
-			uchar waveat = _waveform.at(i);
-			if (wavemax < waveat) wavemax = waveat;
-		}
-		_wavemax = wavemax;
-	}
-	void finish() {
-		if (const auto voice = _doc ? _doc->voice() : nullptr) {
-			if (!_waveform.isEmpty()) {
-				voice->waveform = _waveform;
-				voice->wavemax = _wavemax;
-			}
-			if (voice->waveform.isEmpty()) {
-				voice->waveform.resize(1);
-				voice->waveform[0] = -2;
-				voice->wavemax = 0;
-			} else if (voice->waveform[0] < 0) {
-				voice->waveform[0] = -2;
-				voice->wavemax = 0;
-			}
-			Auth().data().requestDocumentViewRepaint(_doc);
-		}
-	}
-	virtual ~CountWaveformTask() {
-		if (_data.isEmpty() && _doc) {
-			_loc.accessDisable();
-		}
-	}
-
-protected:
-	DocumentData *_doc;
-	FileLocation _loc;
-	QByteArray _data;
-	VoiceWaveform _waveform;
-	char _wavemax;
-
-};
-
-void countVoiceWaveform(DocumentData *document) {
-	if (const auto voice = document->voice()) {
-		if (_localLoader) {
-			voice->waveform.resize(1 + sizeof(TaskId));
-			voice->waveform[0] = -1; // counting
-			TaskId taskId = _localLoader->addTask(
-				std::make_unique<CountWaveformTask>(document));
-			memcpy(voice->waveform.data() + 1, &taskId, sizeof(taskId));
-		}
-	}
-}
-
-void cancelTask(TaskId id) {
-	if (_localLoader) {
-		_localLoader->cancelTask(id);
-	}
-}
-
 void _writeStickerSet(QDataStream &stream, const Stickers::Set &set) {
 	bool notLoaded = (set.flags & MTPDstickerSet_ClientFlag::f_not_loaded);
 	if (notLoaded) {
@@ -3360,6 +3575,7 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 		return;
 	}
 
+	auto stream = Serialize::ByteReader(stickers.unread());
 	bool readingInstalled = (readingFlags == MTPDstickerSet::Flag::f_installed_date);
 
 	auto &sets = Auth().data().stickerSetsRef();
@@ -3367,17 +3583,17 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 
 	quint32 cnt;
 	QByteArray hash;
-	stickers.stream >> cnt >> hash; // ignore hash, it is counted
+	stream >> cnt >> hash; // ignore hash, it is counted
 	if (readingInstalled && stickers.version < 8019) { // bad data in old caches
 		cnt += 2; // try to read at least something
 	}
-	for (uint32 i = 0; i < cnt; ++i) {
+	for (uint32 i = 0; i < cnt && stream.ok(); ++i) {
 		quint64 setId = 0, setAccess = 0;
 		QString setTitle, setShortName;
 		qint32 scnt = 0;
 		auto setInstallDate = qint32(0);
 
-		stickers.stream
+		stream
 			>> setId
 			>> setAccess
 			>> setTitle
@@ -3388,7 +3604,7 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 		MTPDstickerSet::Flags setFlags = 0;
 		if (stickers.version > 8033) {
 			qint32 setFlagsValue = 0;
-			stickers.stream >> setHash >> setFlagsValue;
+			stream >> setHash >> setFlagsValue;
 			setFlags = MTPDstickerSet::Flags::from_raw(setFlagsValue);
 			if (setFlags & MTPDstickerSet_ClientFlag::f_not_loaded__old) {
 				setFlags &= ~MTPDstickerSet_ClientFlag::f_not_loaded__old;
@@ -3396,7 +3612,7 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 			}
 		}
 		if (stickers.version > 1002008) {
-			stickers.stream >> setInstallDate;
+			stream >> setInstallDate;
 		}
 		if (readingInstalled && stickers.version < 9061) {
 			setFlags |= MTPDstickerSet::Flag::f_installed_date;
@@ -3458,7 +3674,7 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 		Serialize::Document::StickerSetInfo info(setId, setAccess, setShortName);
 		OrderedSet<DocumentId> read;
 		for (int32 j = 0; j < scnt; ++j) {
-			auto document = Serialize::Document::readStickerFromStream(stickers.version, stickers.stream, info);
+			auto document = Serialize::Document::readStickerFromStream(stickers.version, stream, info);
 			if (!document || !document->sticker()) continue;
 
 			if (read.contains(document->id)) continue;
@@ -3477,7 +3693,7 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 
 		if (stickers.version > 1002008) {
 			auto datesCount = qint32(0);
-			stickers.stream >> datesCount;
+			stream >> datesCount;
 			if (datesCount > 0) {
 				if (datesCount != scnt) {
 					// Bad file.
@@ -3486,7 +3702,7 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 				set.dates.reserve(datesCount);
 				for (auto i = 0; i != datesCount; ++i) {
 					auto date = qint32();
-					stickers.stream >> date;
+					stream >> date;
 					if (set.id == Stickers::CloudRecentSetId) {
 						set.dates.push_back(TimeId(date));
 					}
@@ -3496,16 +3712,16 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 
 		if (stickers.version > 9018) {
 			qint32 emojiCount;
-			stickers.stream >> emojiCount;
+			stream >> emojiCount;
 			for (int32 j = 0; j < emojiCount; ++j) {
 				QString emojiString;
 				qint32 stickersCount;
-				stickers.stream >> emojiString >> stickersCount;
+				stream >> emojiString >> stickersCount;
 				Stickers::Pack pack;
 				pack.reserve(stickersCount);
 				for (int32 k = 0; k < stickersCount; ++k) {
 					quint64 id;
-					stickers.stream >> id;
+					stream >> id;
 					const auto doc = Auth().data().document(id);
 					if (!doc->sticker()) continue;
 
@@ -3523,7 +3739,7 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 
 	// Read orders of installed and featured stickers.
 	if (outOrder && stickers.version >= 9061) {
-		stickers.stream >> *outOrder;
+		stream >> *outOrder;
 	}
 
 	// Set flags that we dropped above from the order.
@@ -3540,9 +3756,7 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 	}
 }
 
-void writeInstalledStickers() {
-	if (!Global::started()) return;
-
+void _writeInstalledStickers() {
 	_writeStickerSets(_installedStickersKey, [](const Stickers::Set &set) {
 		if (set.id == Stickers::CloudRecentSetId || set.id == Stickers::FavedSetId) { // separate files for them
 			return StickerSetCheckResult::Skip;
@@ -3561,9 +3775,7 @@ void writeInstalledStickers() {
 	}, Auth().data().stickerSetsOrder());
 }
 
-void writeFeaturedStickers() {
-	if (!Global::started()) return;
-
+void _writeFeaturedStickers() {
 	_writeStickerSets(_featuredStickersKey, [](const Stickers::Set &set) {
 		if (set.id == Stickers::CloudRecentSetId || set.id == Stickers::FavedSetId) { // separate files for them
 			return StickerSetCheckResult::Skip;
@@ -3580,9 +3792,7 @@ void writeFeaturedStickers() {
 	}, Auth().data().featuredStickerSetsOrder());
 }
 
-void writeRecentStickers() {
-	if (!Global::started()) return;
-
+void _writeRecentStickers() {
 	_writeStickerSets(_recentStickersKey, [](const Stickers::Set &set) {
 		if (set.id != Stickers::CloudRecentSetId || set.stickers.isEmpty()) {
 			return StickerSetCheckResult::Skip;
@@ -3591,9 +3801,7 @@ void writeRecentStickers() {
 	}, Stickers::Order());
 }
 
-void writeFavedStickers() {
-	if (!Global::started()) return;
-
+void _writeFavedStickers() {
 	_writeStickerSets(_favedStickersKey, [](const Stickers::Set &set) {
 		if (set.id != Stickers::FavedSetId || set.stickers.isEmpty()) {
 			return StickerSetCheckResult::Skip;
@@ -3602,9 +3810,7 @@ void writeFavedStickers() {
 	}, Stickers::Order());
 }
 
-void writeArchivedStickers() {
-	if (!Global::started()) return;
-
+void _writeArchivedStickers() {
 	_writeStickerSets(_archivedStickersKey, [](const Stickers::Set &set) {
 		if (!(set.flags & MTPDstickerSet::Flag::f_archived) || set.stickers.isEmpty()) {
 			return StickerSetCheckResult::Skip;
@@ -3613,6 +3819,67 @@ void writeArchivedStickers() {
 	}, Auth().data().archivedStickerSetsOrder());
 }
 
+void _writeStickers(int kinds, WriteMapWhen when = WriteMapWhen::Soon) {
+	if (!_working()) return;
+
+	_stickersWritePending |= kinds;
+	if (when != WriteMapWhen::Now) {
+		_manager->writeStickers(when == WriteMapWhen::Fast);
+		return;
+	}
+	_manager->writingStickers();
+
+	const auto pending = base::take(_stickersWritePending);
+	if (!pending || !AuthSession::Exists()) {
+		return;
+	}
+	if (pending & StickersWriteInstalled) {
+		_writeInstalledStickers();
+	}
+	if (pending & StickersWriteFeatured) {
+		_writeFeaturedStickers();
+	}
+	if (pending & StickersWriteRecent) {
+		_writeRecentStickers();
+	}
+	if (pending & StickersWriteFaved) {
+		_writeFavedStickers();
+	}
+	if (pending & StickersWriteArchived) {
+		_writeArchivedStickers();
+	}
+}
+
+void writeInstalledStickers() {
+	if (!Global::started()) return;
+
+	_writeStickers(StickersWriteInstalled);
+}
+
+void writeFeaturedStickers() {
+	if (!Global::started()) return;
+
+	_writeStickers(StickersWriteFeatured);
+}
+
+void writeRecentStickers() {
+	if (!Global::started()) return;
+
+	_writeStickers(StickersWriteRecent);
+}
+
+void writeFavedStickers() {
+	if (!Global::started()) return;
+
+	_writeStickers(StickersWriteFaved);
+}
+
+void writeArchivedStickers() {
+	if (!Global::started()) return;
+
+	_writeStickers(StickersWriteArchived);
+}
+
 void importOldRecentStickers() {
 	if (!_recentStickersKeyOld) return;
 
@@ -3710,7 +3977,8 @@ void importOldRecentStickers() {
 	}
 	if (custom.stickers.isEmpty()) sets.remove(Stickers::CustomSetId);
 
-	writeInstalledStickers();
+	// The old file is removed right below, so write the new one now.
+	_writeStickers(StickersWriteInstalled, WriteMapWhen::Now);
 	writeUserSettings();
 
 	clearKey(_recentStickersKeyOld);
@@ -4457,6 +4725,7 @@ void WriteExportSettings(const Export::Settings &settings) {
 		&& settings.path == check.path
 		&& settings.format == check.format
 		&& settings.availableAt == check.availableAt
+		&& settings.incremental == check.incremental
 		&& !settings.onlySinglePeer()) {
 		if (_exportSettingsKey) {
 			clearKey(_exportSettingsKey);
@@ -4472,7 +4741,7 @@ void WriteExportSettings(const Export::Settings &settings) {
 		}
 		quint32 size = sizeof(quint32) * 6
 			+ Serialize::stringSize(settings.path)
-			+ sizeof(qint32) * 2 + sizeof(quint64);
+			+ sizeof(qint32) * 3 + sizeof(quint64);
 		EncryptedDescriptor data(size);
 		data.stream
 			<< quint32(settings.types)
@@ -4501,6 +4770,7 @@ void WriteExportSettings(const Export::Settings &settings) {
 		});
 		data.stream << qint32(settings.singlePeerFrom);
 		data.stream << qint32(settings.singlePeerTill);
+		data.stream << qint32(settings.incremental ? 1 : 0);
 
 		FileWriteDescriptor file(_exportSettingsKey);
 		file.writeEncrypted(data);
@@ -4523,6 +4793,7 @@ Export::Settings ReadExportSettings() {
 	qint32 singlePeerType = 0, singlePeerBareId = 0;
 	quint64 singlePeerAccessHash = 0;
 	qint32 singlePeerFrom = 0, singlePeerTill = 0;
+	qint32 incremental = 0;
 	file.stream
 		>> types
 		>> fullChats
@@ -4547,6 +4818,9 @@ Export::Settings ReadExportSettings() {
 	if (!file.stream.atEnd()) {
 		file.stream >> singlePeerFrom >> singlePeerTill;
 	}
+	if (!file.stream.atEnd()) {
+		file.stream >> incremental;
+	}
 	auto result = Export::Settings();
 	result.types = Export::Settings::Types::from_raw(types);
 	result.fullChats = Export::Settings::Types::from_raw(fullChats);
@@ -4576,6 +4850,7 @@ Export::Settings ReadExportSettings() {
 	}();
 	result.singlePeerFrom = singlePeerFrom;
 	result.singlePeerTill = singlePeerTill;
+	result.incremental = (incremental == 1);
 	return (file.stream.status() == QDataStream::Ok && result.validate())
 		? result
 		: Export::Settings();
@@ -4616,6 +4891,9 @@ void writeSavedPeers() {
 }
 
 void readSavedPeers() {
+	if (_savedPeersWereRead) return;
+	_savedPeersWereRead = true;
+
 	if (!_savedPeersKey) return;
 
 	FileReadDescriptor saved;
@@ -4654,6 +4932,8 @@ void readSavedPeers() {
 }
 
 void addSavedPeer(PeerData *peer, const QDateTime &position) {
+	readSavedPeers();
+
 	auto &savedPeers = cRefSavedPeers();
 	auto i = savedPeers.find(peer);
 	if (i == savedPeers.cend()) {
@@ -4667,6 +4947,8 @@ void addSavedPeer(PeerData *peer, const QDateTime &position) {
 }
 
 void removeSavedPeer(PeerData *peer) {
+	readSavedPeers();
+
 	auto &savedPeers = cRefSavedPeers();
 	if (savedPeers.isEmpty()) return;
 
@@ -4679,6 +4961,10 @@ void removeSavedPeer(PeerData *peer) {
 	}
 }
 
+void readReportSpamStatuses() {
+	_readReportSpamStatuses();
+}
+
 void writeReportSpamStatuses() {
 	_writeReportSpamStatuses();
 }
@@ -4814,6 +5100,7 @@ bool ClearManager::addTask(int task) {
 			_mapChanged = true;
 		}
 		if (_locationsKey) {
+			_locationsJournal.close();
 			_locationsKey = 0;
 			_mapChanged = true;
 		}
@@ -4944,6 +5231,8 @@ Manager::Manager() {
 	connect(&_mapWriteTimer, SIGNAL(timeout()), this, SLOT(mapWriteTimeout()));
 	_locationsWriteTimer.setSingleShot(true);
 	connect(&_locationsWriteTimer, SIGNAL(timeout()), this, SLOT(locationsWriteTimeout()));
+	_stickersWriteTimer.setSingleShot(true);
+	connect(&_stickersWriteTimer, SIGNAL(timeout()), this, SLOT(stickersWriteTimeout()));
 }
 
 void Manager::writeMap(bool fast) {
@@ -4970,6 +5259,18 @@ void Manager::writingLocations() {
 	_locationsWriteTimer.stop();
 }
 
+void Manager::writeStickers(bool fast) {
+	if (!_stickersWriteTimer.isActive() || fast) {
+		_stickersWriteTimer.start(fast ? 1 : WriteMapTimeout);
+	} else if (_stickersWriteTimer.remainingTime() <= 0) {
+		stickersWriteTimeout();
+	}
+}
+
+void Manager::writingStickers() {
+	_stickersWriteTimer.stop();
+}
+
 void Manager::mapWriteTimeout() {
 	_writeMap(WriteMapWhen::Now);
 }
@@ -4978,7 +5279,15 @@ void Manager::locationsWriteTimeout() {
 	_writeLocations(WriteMapWhen::Now);
 }
 
+void Manager::stickersWriteTimeout() {
+	_writeStickers(0, WriteMapWhen::Now);
+}
+
 void Manager::finish() {
+	// Sticker writes may change the map, so they go first.
+	if (_stickersWriteTimer.isActive()) {
+		stickersWriteTimeout();
+	}
 	if (_mapWriteTimer.isActive()) {
 		mapWriteTimeout();
 	}
@@ -113,10 +113,6 @@ Storage::EncryptionKey cacheKey();
 Storage::Cache::Database::Settings cacheSettings();
 void updateCacheSettings(Storage::Cache::Database::SettingsUpdate &update);
 
-void countVoiceWaveform(DocumentData *document);
-
-void cancelTask(TaskId id);
-
 void writeInstalledStickers();
 void writeFeaturedStickers();
 void writeRecentStickers();
@@ -162,6 +158,7 @@ void addSavedPeer(PeerData *peer, const QDateTime &position);
 void removeSavedPeer(PeerData *peer);
 void readSavedPeers();
 
+void readReportSpamStatuses();
 void writeReportSpamStatuses();
 
 void writeSelf();
@@ -185,15 +182,19 @@ public:
 	void writingMap();
 	void writeLocations(bool fast);
 	void writingLocations();
+	void writeStickers(bool fast);
+	void writingStickers();
 	void finish();
 
 public slots:
 	void mapWriteTimeout();
 	void locationsWriteTimeout();
+	void stickersWriteTimeout();
 
 private:
 	QTimer _mapWriteTimer;
 	QTimer _locationsWriteTimer;
+	QTimer _stickersWriteTimer;
 
 };
 
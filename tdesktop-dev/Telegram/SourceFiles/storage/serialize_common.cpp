@@ -25,26 +25,6 @@ void writeStorageImageLocation(
 	stream << location.fileReference();
 }
 
-StorageImageLocation readStorageImageLocation(
-		int streamAppVersion,
-		QDataStream &stream) {
-	qint32 width, height, dc, local;
-	quint64 volume, secret;
-	QByteArray fileReference;
-	stream >> width >> height >> dc >> volume >> local >> secret;
-	if (streamAppVersion >= 1003013) {
-		stream >> fileReference;
-	}
-	return StorageImageLocation(
-		width,
-		height,
-		dc,
-		volume,
-		local,
-		secret,
-		fileReference);
-}
-
 int storageImageLocationSize(const StorageImageLocation &location) {
 	// width + height + dc + volume + local + secret + fileReference
 	return sizeof(qint32)
@@ -87,11 +87,30 @@ inline int dateTimeSize() {
 void writeStorageImageLocation(
 	QDataStream &stream,
 	const StorageImageLocation &location);
-StorageImageLocation readStorageImageLocation(
-	int streamAppVersion,
-	QDataStream &stream);
 int storageImageLocationSize(const StorageImageLocation &location);
 
+// Works both with QDataStream and with Serialize::ByteReader.
+template <typename Stream>
+StorageImageLocation readStorageImageLocation(
+		int streamAppVersion,
+		Stream &stream) {
+	qint32 width, height, dc, local;
+	quint64 volume, secret;
+	QByteArray fileReference;
+	stream >> width >> height >> dc >> volume >> local >> secret;
+	if (streamAppVersion >= 1003013) {
+		stream >> fileReference;
+	}
+	return StorageImageLocation(
+		width,
+		height,
+		dc,
+		volume,
+		local,
+		secret,
+		fileReference);
+}
+
 template <typename T>
 inline T read(QDataStream &stream) {
 	auto result = T();
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/serialize_document.h"
 
 #include "storage/serialize_common.h"
+#include "storage/serialize_stream.h"
 #include "chat_helpers/stickers.h"
 #include "data/data_session.h"
 #include "ui/image/image.h"
@@ -53,7 +54,8 @@ void Document::writeToStream(QDataStream &stream, DocumentData *document) {
 	}
 }
 
-DocumentData *Document::readFromStreamHelper(int streamAppVersion, QDataStream &stream, const StickerSetInfo *info) {
+template <typename Stream>
+DocumentData *Document::readFromStreamHelper(int streamAppVersion, Stream &stream, const StickerSetInfo *info) {
 	quint64 id, access;
 	QString name, mime;
 	qint32 date, dc, size, width, height, type, version;
@@ -147,6 +149,10 @@ DocumentData *Document::readStickerFromStream(int streamAppVersion, QDataStream
 	return readFromStreamHelper(streamAppVersion, stream, &info);
 }
 
+DocumentData *Document::readStickerFromStream(int streamAppVersion, ByteReader &stream, const StickerSetInfo &info) {
+	return readFromStreamHelper(streamAppVersion, stream, &info);
+}
+
 DocumentData *Document::readFromStream(int streamAppVersion, QDataStream &stream) {
 	return readFromStreamHelper(streamAppVersion, stream, nullptr);
 }
@@ -11,6 +11,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Serialize {
 
+class ByteReader;
+
 class Document {
 public:
 	struct StickerSetInfo {
@@ -26,11 +28,13 @@ public:
 
 	static void writeToStream(QDataStream &stream, DocumentData *document);
 	static DocumentData *readStickerFromStream(int streamAppVersion, QDataStream &stream, const StickerSetInfo &info);
+	static DocumentData *readStickerFromStream(int streamAppVersion, ByteReader &stream, const StickerSetInfo &info);
 	static DocumentData *readFromStream(int streamAppVersion, QDataStream &stream);
 	static int sizeInStream(DocumentData *document);
 
 private:
-	static DocumentData *readFromStreamHelper(int streamAppVersion, QDataStream &stream, const StickerSetInfo *info);
+	template <typename Stream>
+	static DocumentData *readFromStreamHelper(int streamAppVersion, Stream &stream, const StickerSetInfo *info);
 
 };
 
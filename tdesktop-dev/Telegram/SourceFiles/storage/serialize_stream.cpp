@@ -0,0 +1,152 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/serialize_stream.h"
+
+namespace Serialize {
+namespace {
+
+constexpr auto kNullSize = quint32(0xFFFFFFFF);
+constexpr auto kNullTime = quint32(0xFFFFFFFF);
+
+// QDateTimePrivate::Spec values used by Qt_4_0 till Qt_5_1 streams.
+enum class TimeSpec : qint8 {
+	LocalUnknown = -1,
+	LocalStandard = 0,
+	LocalDST = 1,
+	UTC = 2,
+	OffsetFromUTC = 3,
+	TimeZone = 4,
+};
+
+} // namespace
+
+bytes::const_span ByteReader::readRaw(size_type size) {
+	if (_failed || size < 0 || size > _data.size() - _offset) {
+		_failed = true;
+		return bytes::const_span();
+	}
+	const auto result = _data.subspan(_offset, size);
+	_offset += size;
+	return result;
+}
+
+void ByteReader::skipRaw(size_type size) {
+	readRaw(size);
+}
+
+ByteReader &ByteReader::operator>>(QString &value) {
+	value = QString();
+	auto size = quint32(0);
+	*this >> size;
+	if (!ok() || size == kNullSize) {
+		return *this;
+	} else if (size & 0x01) {
+		_failed = true;
+		return *this;
+	}
+	const auto data = readRaw(size);
+	if (!ok()) {
+		return *this;
+	} else if (!size) {
+		value = QString(QLatin1String(""));
+		return *this;
+	}
+	value.resize(size / 2);
+	auto to = value.data();
+	for (auto from = data.begin(); from != data.end(); from += 2) {
+		*to++ = QChar(ushort((gsl::to_integer<unsigned char>(*from) << 8)
+			| gsl::to_integer<unsigned char>(*(from + 1))));
+	}
+	return *this;
+}
+
+ByteReader &ByteReader::operator>>(QByteArray &value) {
+	value = QByteArray();
+	auto size = quint32(0);
+	*this >> size;
+	if (!ok() || size == kNullSize) {
+		return *this;
+	}
+	const auto data = readRaw(size);
+	if (ok() && size > 0) {
+		value = QByteArray(
+			reinterpret_cast<const char*>(data.data()),
+			data.size());
+	}
+	return *this;
+}
+
+ByteReader &ByteReader::operator>>(QDateTime &value) {
+	value = QDateTime();
+	auto day = qint64(0);
+	auto time = quint32(0);
+	auto spec = qint8(0);
+	*this >> day >> time >> spec;
+	if (!ok()) {
+		return *this;
+	}
+	const auto date = QDate::fromJulianDay(day);
+	const auto moment = (time == kNullTime)
+		? QTime()
+		: QTime::fromMSecsSinceStartOfDay(time);
+	switch (TimeSpec(spec)) {
+	case TimeSpec::UTC:
+	case TimeSpec::OffsetFromUTC:
+		value = QDateTime(date, moment, Qt::UTC);
+		break;
+	default:
+		value = QDateTime(date, moment, Qt::LocalTime);
+		break;
+	}
+	return *this;
+}
+
+void ByteWriter::writeRaw(bytes::const_span data) {
+	_data.append(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+ByteWriter &ByteWriter::operator<<(const QString &value) {
+	if (value.isNull()) {
+		return *this << kNullSize;
+	}
+	*this << quint32(value.size() * 2);
+	const auto from = _data.size();
+	_data.resize(from + value.size() * 2);
+	auto to = _data.data() + from;
+	for (const auto ch : value) {
+		*to++ = char(ch.unicode() >> 8);
+		*to++ = char(ch.unicode() & 0xFF);
+	}
+	return *this;
+}
+
+ByteWriter &ByteWriter::operator<<(const QByteArray &value) {
+	if (value.isNull()) {
+		return *this << kNullSize;
+	}
+	*this << quint32(value.size());
+	_data.append(value);
+	return *this;
+}
+
+ByteWriter &ByteWriter::operator<<(const QDateTime &value) {
+	const auto date = value.date();
+	const auto time = value.time();
+	*this
+		<< qint64(date.toJulianDay())
+		<< (time.isNull() ? kNullTime : quint32(time.msecsSinceStartOfDay()));
+	switch (value.timeSpec()) {
+	case Qt::UTC: return *this << qint8(TimeSpec::UTC);
+	case Qt::OffsetFromUTC: return *this << qint8(TimeSpec::OffsetFromUTC);
+	case Qt::TimeZone: return *this << qint8(TimeSpec::TimeZone);
+	case Qt::LocalTime: break;
+	}
+	return *this << qint8(TimeSpec::LocalUnknown);
+}
+
+} // namespace Serialize
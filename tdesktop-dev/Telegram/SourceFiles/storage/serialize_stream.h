@@ -0,0 +1,183 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/bytes.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDateTime>
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+namespace Serialize {
+namespace details {
+
+template <typename Integer>
+struct Stored {
+	using type = std::make_unsigned_t<Integer>;
+};
+
+template <>
+struct Stored<bool> {
+	using type = uint8;
+};
+
+} // namespace details
+
+// Reads the same format QDataStream with Qt_5_1 version writes,
+// right from the memory span without a QBuffer in between.
+// Any read past the end fails the reader and gives zero values.
+class ByteReader {
+public:
+	explicit ByteReader(bytes::const_span data) : _data(data) {
+	}
+
+	bool ok() const {
+		return !_failed;
+	}
+	bool atEnd() const {
+		return _failed || (_offset == _data.size());
+	}
+	size_type remaining() const {
+		return _failed ? 0 : (_data.size() - _offset);
+	}
+
+	// Returns an empty span and fails the reader if there is not enough.
+	bytes::const_span readRaw(size_type size);
+	void skipRaw(size_type size);
+
+	template <
+		typename Integer,
+		typename = std::enable_if_t<std::is_integral_v<Integer>>>
+	ByteReader &operator>>(Integer &value);
+
+	ByteReader &operator>>(QString &value);
+	ByteReader &operator>>(QByteArray &value);
+	ByteReader &operator>>(QDateTime &value);
+
+	template <typename Type>
+	ByteReader &operator>>(QList<Type> &value);
+	template <typename Type>
+	ByteReader &operator>>(QVector<Type> &value);
+
+private:
+	template <typename Container>
+	ByteReader &readContainer(Container &value);
+
+	bytes::const_span _data;
+	size_type _offset = 0;
+	bool _failed = false;
+
+};
+
+// Writes the same bytes as QDataStream with Qt_5_1 version.
+class ByteWriter {
+public:
+	explicit ByteWriter(QByteArray &data) : _data(data) {
+	}
+
+	void writeRaw(bytes::const_span data);
+
+	template <
+		typename Integer,
+		typename = std::enable_if_t<std::is_integral_v<Integer>>>
+	ByteWriter &operator<<(Integer value);
+
+	ByteWriter &operator<<(const QString &value);
+	ByteWriter &operator<<(const QByteArray &value);
+	ByteWriter &operator<<(const QDateTime &value);
+
+	template <typename Type>
+	ByteWriter &operator<<(const QList<Type> &value);
+	template <typename Type>
+	ByteWriter &operator<<(const QVector<Type> &value);
+
+private:
+	template <typename Container>
+	ByteWriter &writeContainer(const Container &value);
+
+	QByteArray &_data;
+
+};
+
+// QDataStream keeps the integers in big endian and bool as one byte.
+template <typename Integer, typename>
+ByteReader &ByteReader::operator>>(Integer &value) {
+	using Stored = typename details::Stored<Integer>::type;
+	const auto data = readRaw(sizeof(Stored));
+	auto result = Stored(0);
+	for (const auto byte : data) {
+		result = Stored((uint64(result) << 8)
+			| gsl::to_integer<unsigned char>(byte));
+	}
+	value = Integer(result);
+	return *this;
+}
+
+template <typename Type>
+ByteReader &ByteReader::operator>>(QList<Type> &value) {
+	return readContainer(value);
+}
+
+template <typename Type>
+ByteReader &ByteReader::operator>>(QVector<Type> &value) {
+	return readContainer(value);
+}
+
+template <typename Container>
+ByteReader &ByteReader::readContainer(Container &value) {
+	value.clear();
+	auto count = quint32(0);
+	*this >> count;
+	for (auto i = quint32(0); ok() && i != count; ++i) {
+		auto element = typename Container::value_type();
+		*this >> element;
+		if (ok()) {
+			value.push_back(std::move(element));
+		}
+	}
+	if (!ok()) {
+		value.clear();
+	}
+	return *this;
+}
+
+template <typename Integer, typename>
+ByteWriter &ByteWriter::operator<<(Integer value) {
+	using Stored = typename details::Stored<Integer>::type;
+	const auto stored = Stored(value);
+	bytes::type data[sizeof(Stored)];
+	for (auto i = std::size_t(0); i != sizeof(Stored); ++i) {
+		const auto shift = (sizeof(Stored) - i - 1) * 8;
+		data[i] = bytes::type((uint64(stored) >> shift) & 0xFF);
+	}
+	writeRaw(data);
+	return *this;
+}
+
+template <typename Type>
+ByteWriter &ByteWriter::operator<<(const QList<Type> &value) {
+	return writeContainer(value);
+}
+
+template <typename Type>
+ByteWriter &ByteWriter::operator<<(const QVector<Type> &value) {
+	return writeContainer(value);
+}
+
+template <typename Container>
+ByteWriter &ByteWriter::writeContainer(const Container &value) {
+	*this << quint32(value.size());
+	for (const auto &element : value) {
+		*this << element;
+	}
+	return *this;
+}
+
+} // namespace Serialize
@@ -0,0 +1,198 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "storage/serialize_stream.h"
+
+#include <QtCore/QDataStream>
+
+#include <random>
+
+namespace {
+
+// The same fields the local storage files keep, with all the kinds
+// of values that are stored differently: null, empty and not ASCII.
+struct Entry {
+	quint64 first = 0;
+	quint64 second = 0;
+	qint32 type = 0;
+	QString name;
+	QByteArray bookmark;
+	QDateTime modified;
+	quint32 size = 0;
+	bool flag = false;
+	qint8 small = 0;
+	QList<quint64> order;
+};
+
+bool operator==(const Entry &a, const Entry &b) {
+	return (a.first == b.first)
+		&& (a.second == b.second)
+		&& (a.type == b.type)
+		&& (a.name == b.name)
+		&& (a.name.isNull() == b.name.isNull())
+		&& (a.bookmark == b.bookmark)
+		&& (a.modified == b.modified)
+		&& (a.modified.timeSpec() == b.modified.timeSpec())
+		&& (a.size == b.size)
+		&& (a.flag == b.flag)
+		&& (a.small == b.small)
+		&& (a.order == b.order);
+}
+
+std::vector<Entry> TestEntries() {
+	auto result = std::vector<Entry>();
+	auto entry = Entry();
+	result.push_back(entry);
+
+	entry.first = 0xFEDCBA9876543210ULL;
+	entry.second = 1;
+	entry.type = -2;
+	entry.name = QString("/home/user/Downloads/file.txt");
+	entry.bookmark = QByteArray("\x00\x01\xFF", 3);
+	entry.modified = QDateTime(QDate(2018, 10, 18), QTime(12, 34, 56, 789));
+	entry.size = 0xFFFFFFFEU;
+	entry.flag = true;
+	entry.small = -128;
+	entry.order = { 1ULL, 0xFFFFFFFFFFFFFFFFULL, 42ULL };
+	result.push_back(entry);
+
+	entry.name = QString::fromUtf8("\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82 \xF0\x9F\x98\x80");
+	entry.bookmark = QByteArray("");
+	entry.modified = QDateTime(QDate(1970, 1, 1), QTime(0, 0), Qt::UTC);
+	entry.order.clear();
+	result.push_back(entry);
+
+	entry.name = QString("");
+	entry.modified = QDateTime(QDate(2100, 12, 31), QTime());
+	result.push_back(entry);
+	return result;
+}
+
+template <typename Stream>
+void WriteEntry(Stream &stream, const Entry &entry) {
+	stream
+		<< entry.first
+		<< entry.second
+		<< entry.type
+		<< entry.name
+		<< entry.bookmark
+		<< entry.modified
+		<< entry.size
+		<< entry.flag
+		<< entry.small
+		<< entry.order;
+}
+
+template <typename Stream>
+Entry ReadEntry(Stream &stream) {
+	auto result = Entry();
+	stream
+		>> result.first
+		>> result.second
+		>> result.type
+		>> result.name
+		>> result.bookmark
+		>> result.modified
+		>> result.size
+		>> result.flag
+		>> result.small
+		>> result.order;
+	return result;
+}
+
+QByteArray WriteWithDataStream(const std::vector<Entry> &entries) {
+	auto result = QByteArray();
+	QDataStream stream(&result, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_5_1);
+	for (const auto &entry : entries) {
+		WriteEntry(stream, entry);
+	}
+	return result;
+}
+
+QByteArray WriteWithByteWriter(const std::vector<Entry> &entries) {
+	auto result = QByteArray();
+	auto stream = Serialize::ByteWriter(result);
+	for (const auto &entry : entries) {
+		WriteEntry(stream, entry);
+	}
+	return result;
+}
+
+std::vector<Entry> ReadWithDataStream(const QByteArray &data, bool &ok) {
+	QDataStream stream(data);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto result = std::vector<Entry>();
+	while (!stream.atEnd()) {
+		result.push_back(ReadEntry(stream));
+	}
+	ok = (stream.status() == QDataStream::Ok);
+	return result;
+}
+
+std::vector<Entry> ReadWithByteReader(const QByteArray &data, bool &ok) {
+	auto stream = Serialize::ByteReader(bytes::make_span(data));
+	auto result = std::vector<Entry>();
+	while (!stream.atEnd()) {
+		result.push_back(ReadEntry(stream));
+	}
+	ok = stream.ok();
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("byte writer gives the data stream bytes", "[serialize_stream]") {
+	const auto entries = TestEntries();
+	REQUIRE(WriteWithByteWriter(entries) == WriteWithDataStream(entries));
+}
+
+TEST_CASE("byte reader reads the data stream bytes", "[serialize_stream]") {
+	const auto entries = TestEntries();
+	auto ok = false;
+	const auto read = ReadWithByteReader(WriteWithDataStream(entries), ok);
+	REQUIRE(ok);
+	REQUIRE(read == entries);
+}
+
+TEST_CASE("byte reader fails on the cut data", "[serialize_stream]") {
+	const auto data = WriteWithDataStream(TestEntries());
+	for (auto size = 0; size != data.size(); ++size) {
+		const auto cut = data.mid(0, size);
+
+		auto expectedOk = false;
+		const auto expected = ReadWithDataStream(cut, expectedOk);
+		auto ok = false;
+		const auto read = ReadWithByteReader(cut, ok);
+		REQUIRE(ok == expectedOk);
+		if (ok) {
+			REQUIRE(read == expected);
+		}
+	}
+}
+
+TEST_CASE("byte reader stays in bounds on random data", "[serialize_stream]") {
+	auto generator = std::mt19937(42);
+	auto sizes = std::uniform_int_distribution<int>(0, 256);
+	auto values = std::uniform_int_distribution<int>(0, 255);
+	for (auto i = 0; i != 10000; ++i) {
+		auto data = QByteArray(sizes(generator), Qt::Uninitialized);
+		for (auto &byte : data) {
+			byte = char(values(generator));
+		}
+		auto stream = Serialize::ByteReader(bytes::make_span(data));
+		while (!stream.atEnd()) {
+			const auto entry = ReadEntry(stream);
+			REQUIRE(entry.name.size() * 2 <= data.size());
+			REQUIRE(entry.bookmark.size() <= data.size());
+			REQUIRE(entry.order.size() <= data.size());
+		}
+		REQUIRE(stream.remaining() == 0);
+	}
+}
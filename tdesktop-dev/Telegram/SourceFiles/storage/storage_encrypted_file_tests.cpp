@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "catch.hpp"
 
 #include "storage/storage_encrypted_file.h"
+#include "storage/storage_test_keys.h"
 
 #include <QtCore/QThread>
 #include <QtCore/QCoreApplication>
@@ -27,13 +28,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 extern int (*TestForkedMethod)();
 
-const auto Key = Storage::EncryptionKey(bytes::make_vector(
-	bytes::make_span("\
-abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
-abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
-abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
-abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
-").subspan(0, Storage::EncryptionKey::kSize)));
+using Storage::Tests::Key;
 
 const auto Name = QString("test.file");
 
@@ -0,0 +1,125 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/storage_journal.h"
+
+#include "base/openssl_help.h"
+
+namespace Storage {
+namespace {
+
+constexpr auto kBlockSize = CtrState::kBlockSize;
+constexpr auto kChecksumSize = 8;
+
+struct RecordHeader {
+	uint32 size = 0;
+	Journal::RecordType type = 0;
+	uint8 reserved1 = 0;
+	uint16 reserved2 = 0;
+	bytes::array<kChecksumSize> checksum = { { bytes::type() } };
+};
+static_assert(
+	sizeof(RecordHeader) == kBlockSize,
+	"Record header should fill exactly one encrypted block.");
+
+size_type PaddedSize(size_type size) {
+	return ((size + kBlockSize - 1) / kBlockSize) * kBlockSize;
+}
+
+// The checksum covers the size and the type as well,
+// so that a torn tail can't be read as a shorter record.
+bytes::array<kChecksumSize> ComputeChecksum(
+		const RecordHeader &header,
+		bytes::const_span data) {
+	const auto headerBytes = bytes::object_as_span(&header);
+	const auto full = openssl::Sha256(
+		headerBytes.subspan(0, sizeof(RecordHeader) - kChecksumSize),
+		data);
+	auto result = bytes::array<kChecksumSize>();
+	bytes::copy(result, bytes::make_span(full).subspan(0, kChecksumSize));
+	return result;
+}
+
+} // namespace
+
+File::Result Journal::open(
+		const QString &path,
+		const EncryptionKey &key,
+		FnMut<void(RecordType, bytes::const_span)> handler) {
+	const auto result = _file.open(path, File::Mode::ReadAppend, key);
+	if (result != File::Result::Success) {
+		return result;
+	}
+	auto data = bytes::vector();
+	while (true) {
+		const auto offset = _file.offset();
+		auto header = RecordHeader();
+		const auto headerBytes = bytes::object_as_span(&header);
+		if (_file.read(headerBytes) != headerBytes.size()
+			|| header.size > uint32(kMaxRecordSize)
+			|| header.reserved1 != 0
+			|| header.reserved2 != 0) {
+			_file.seek(offset);
+			break;
+		}
+		data.resize(PaddedSize(header.size));
+		if (_file.read(data) != data.size()) {
+			_file.seek(offset);
+			break;
+		}
+		const auto record = bytes::make_span(data).subspan(0, header.size);
+		const auto checksum = ComputeChecksum(header, record);
+		if (bytes::compare(checksum, header.checksum) != 0) {
+			_file.seek(offset);
+			break;
+		}
+		handler(header.type, record);
+	}
+	return File::Result::Success;
+}
+
+File::Result Journal::create(const QString &path, const EncryptionKey &key) {
+	return _file.open(path, File::Mode::Write, key);
+}
+
+bool Journal::append(RecordType type, bytes::const_span data) {
+	Expects(data.size() <= kMaxRecordSize);
+
+	if (!_file.isOpen()) {
+		return false;
+	}
+	auto header = RecordHeader();
+	header.size = uint32(data.size());
+	header.type = type;
+	header.checksum = ComputeChecksum(header, data);
+
+	// The whole record is written at once, so that a crash leaves
+	// at most one incomplete record at the end of the file.
+	const auto headerBytes = bytes::object_as_span(&header);
+	auto buffer = bytes::vector(sizeof(RecordHeader) + PaddedSize(data.size()));
+	bytes::copy(buffer, headerBytes);
+	bytes::copy(
+		bytes::make_span(buffer).subspan(sizeof(RecordHeader)),
+		data);
+	bytes::set_random(bytes::make_span(buffer).subspan(
+		sizeof(RecordHeader) + data.size()));
+	return _file.write(buffer) && _file.flush();
+}
+
+bool Journal::isOpen() const {
+	return _file.isOpen();
+}
+
+int64 Journal::size() const {
+	return _file.offset();
+}
+
+void Journal::close() {
+	_file.close();
+}
+
+} // namespace Storage
@@ -0,0 +1,44 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "storage/storage_encrypted_file.h"
+#include "base/bytes.h"
+
+namespace Storage {
+
+// Append-only encrypted file with small records of any size.
+// It keeps the changes made after the last snapshot of some structure
+// was written, so that the snapshot is rewritten only from time to time.
+class Journal {
+public:
+	using RecordType = uint8;
+	static constexpr auto kMaxRecordSize = 1024 * 1024;
+
+	// Replays all the complete records and prepares for appending.
+	// A record torn by a crash and everything after it is dropped.
+	File::Result open(
+		const QString &path,
+		const EncryptionKey &key,
+		FnMut<void(RecordType, bytes::const_span)> handler);
+
+	// Starts an empty journal, when a new snapshot was written.
+	File::Result create(const QString &path, const EncryptionKey &key);
+
+	bool append(RecordType type, bytes::const_span data);
+
+	bool isOpen() const;
+	int64 size() const;
+	void close();
+
+private:
+	File _file;
+
+};
+
+} // namespace Storage
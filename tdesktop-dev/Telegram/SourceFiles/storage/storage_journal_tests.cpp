@@ -0,0 +1,124 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "storage/storage_journal.h"
+#include "storage/storage_test_keys.h"
+
+#include <QtCore/QFile>
+
+using Storage::Tests::Key;
+using Storage::Tests::WrongKey;
+
+const auto Name = QString("test.journal");
+
+struct Record {
+	Storage::Journal::RecordType type = 0;
+	bytes::vector data;
+};
+
+inline bool operator==(const Record &a, const Record &b) {
+	return (a.type == b.type) && (a.data == b.data);
+}
+
+const auto Records = std::vector<Record>{
+	{ 1, bytes::vector() },
+	{ 2, bytes::make_vector(bytes::make_span("short").subspan(0, 5)) },
+	{ 3, bytes::vector(16, bytes::type(0x33)) },
+	{ 1, bytes::vector(1000, bytes::type(0x11)) },
+};
+
+std::vector<Record> Replay(
+		Storage::Journal &journal,
+		const Storage::EncryptionKey &key = Key) {
+	auto result = std::vector<Record>();
+	const auto opened = journal.open(Name, key, [&](
+			Storage::Journal::RecordType type,
+			bytes::const_span data) {
+		result.push_back({ type, bytes::make_vector(data) });
+	});
+	REQUIRE(opened == Storage::File::Result::Success);
+	return result;
+}
+
+TEST_CASE("journal records", "[storage_journal]") {
+	SECTION("writing records") {
+		Storage::Journal journal;
+		const auto result = journal.create(Name, Key);
+		REQUIRE(result == Storage::File::Result::Success);
+		REQUIRE(journal.size() == 0);
+
+		for (const auto &record : Records) {
+			REQUIRE(journal.append(record.type, record.data));
+		}
+		REQUIRE(journal.size() > 1000);
+	}
+	SECTION("replaying and appending records") {
+		Storage::Journal journal;
+		REQUIRE(Replay(journal) == Records);
+
+		const auto &last = Records.back();
+		REQUIRE(journal.append(last.type, last.data));
+		journal.close();
+
+		auto all = Records;
+		all.push_back(last);
+		REQUIRE(Replay(journal) == all);
+	}
+	SECTION("starting an empty journal") {
+		Storage::Journal journal;
+		const auto result = journal.create(Name, Key);
+		REQUIRE(result == Storage::File::Result::Success);
+		journal.close();
+
+		REQUIRE(Replay(journal).empty());
+		REQUIRE(journal.size() == 0);
+	}
+	SECTION("reading with a wrong key") {
+		Storage::Journal journal;
+		const auto result = journal.open(Name, WrongKey, [](
+				Storage::Journal::RecordType type,
+				bytes::const_span data) {
+		});
+		REQUIRE(result == Storage::File::Result::WrongKey);
+	}
+	SECTION("removing file") {
+		REQUIRE(QFile::remove(Name));
+	}
+}
+
+TEST_CASE("journal with a torn tail", "[storage_journal]") {
+	{
+		Storage::Journal journal;
+		REQUIRE(journal.create(Name, Key) == Storage::File::Result::Success);
+		for (const auto &record : Records) {
+			REQUIRE(journal.append(record.type, record.data));
+		}
+	}
+	{
+		// Cut the middle of the last record, as if the writing crashed.
+		auto file = QFile(Name);
+		REQUIRE(file.resize(file.size() - 100));
+	}
+	auto expected = std::vector<Record>(
+		Records.begin(),
+		Records.end() - 1);
+	{
+		Storage::Journal journal;
+		REQUIRE(Replay(journal) == expected);
+
+		const auto &record = Records[1];
+		REQUIRE(journal.append(record.type, record.data));
+		expected.push_back(record);
+	}
+	{
+		Storage::Journal journal;
+		REQUIRE(Replay(journal) == expected);
+	}
+	REQUIRE(QFile::remove(Name));
+}
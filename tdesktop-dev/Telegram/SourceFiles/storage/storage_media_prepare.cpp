@@ -42,96 +42,146 @@ bool ValidVideoForAlbum(const FileMediaInformation::Video &video) {
 	return ValidateThumbDimensions(width, height);
 }
 
-QSize PrepareShownDimensions(const QImage &preview) {
+QSize PrepareShownDimensions(QSize size) {
 	constexpr auto kMaxWidth = 1280;
 	constexpr auto kMaxHeight = 1280;
 
-	const auto result = preview.size();
-	return (result.width() > kMaxWidth || result.height() > kMaxHeight)
-		? result.scaled(kMaxWidth, kMaxHeight, Qt::KeepAspectRatio)
-		: result;
+	return (size.width() > kMaxWidth || size.height() > kMaxHeight)
+		? size.scaled(kMaxWidth, kMaxHeight, Qt::KeepAspectRatio)
+		: size;
 }
 
-bool PrepareAlbumMediaIsWaiting(
-		QSemaphore &semaphore,
-		PreparedFile &file,
-		int previewWidth) {
-	// TODO: Use some special thread queue, like a separate QThreadPool.
-	crl::async([=, &semaphore, &file] {
-		const auto guard = gsl::finally([&] { semaphore.release(); });
-		if (!file.path.isEmpty()) {
-			file.mime = Core::MimeTypeForFile(QFileInfo(file.path)).name();
-			file.information = FileLoadTask::ReadMediaInformation(
-				file.path,
-				QByteArray(),
-				file.mime);
-		} else if (!file.content.isEmpty()) {
-			file.mime = Core::MimeTypeForData(file.content).name();
-			file.information = FileLoadTask::ReadMediaInformation(
-				QString(),
-				file.content,
-				file.mime);
-		} else {
-			Assert(file.information != nullptr);
-		}
+int MaxPreparingTasks() {
+	static const auto result = std::max(QThread::idealThreadCount(), 1);
+	return result;
+}
 
-		using Image = FileMediaInformation::Image;
-		using Video = FileMediaInformation::Video;
-		if (const auto image = base::get_if<Image>(
-				&file.information->media)) {
-			if (ValidPhotoForAlbum(*image)) {
-				file.shownDimensions = PrepareShownDimensions(image->data);
-				file.preview = Images::prepareOpaque(image->data.scaledToWidth(
-					std::min(previewWidth, ConvertScale(image->data.width()))
-						* cIntRetinaFactor(),
-					Qt::SmoothTransformation));
-				Assert(!file.preview.isNull());
-				file.preview.setDevicePixelRatio(cRetinaFactor());
-				file.type = PreparedFile::AlbumType::Photo;
-			}
-		} else if (const auto video = base::get_if<Video>(
-				&file.information->media)) {
-			if (ValidVideoForAlbum(*video)) {
-				auto blurred = Images::prepareBlur(Images::prepareOpaque(video->thumbnail));
-				file.shownDimensions = PrepareShownDimensions(video->thumbnail);
-				file.preview = std::move(blurred).scaledToWidth(
-					previewWidth * cIntRetinaFactor(),
-					Qt::SmoothTransformation);
-				Assert(!file.preview.isNull());
-				file.preview.setDevicePixelRatio(cRetinaFactor());
-				file.type = PreparedFile::AlbumType::Video;
-			}
-		}
-	});
+// FileLoadTask reads photos from disk once again before sending them,
+// so for the album they are decoded right at the preview size. Formats
+// like JPEG skip most of the decoding work then.
+bool ReadScaledPhoto(PreparedFile &file, int previewWidth) {
+#ifndef OS_MAC_OLD
+	if (!file.mime.startsWith(qstr("image/"))
+		|| QFileInfo(file.path).size() > App::kImageSizeLimit) {
+		return false;
+	}
+	auto reader = QImageReader(file.path);
+	reader.setAutoTransform(true);
+	if (!reader.canRead()
+		|| (reader.supportsAnimation() && reader.imageCount() > 1)) {
+		return false;
+	}
+	const auto stored = reader.size();
+	const auto rotated = (reader.transformation()
+		& QImageIOHandler::TransformationRotate90);
+	const auto size = rotated ? stored.transposed() : stored;
+	if (!ValidateThumbDimensions(size.width(), size.height())) {
+		return false;
+	}
+	const auto width = std::min(previewWidth, ConvertScale(size.width()))
+		* cIntRetinaFactor();
+	if (width >= size.width()) {
+		return false;
+	}
+	const auto scaled = QSize(
+		width,
+		std::max(int(int64(size.height()) * width / size.width()), 1));
+	reader.setScaledSize(rotated ? scaled.transposed() : scaled);
+	auto image = QImage();
+	if (!reader.read(&image) || image.isNull()) {
+		return false;
+	}
+	file.information = std::make_unique<FileMediaInformation>();
+	file.information->filemime = file.mime;
+	const auto animated = false;
+	FileLoadTask::FillImageInformation(
+		QImage(image),
+		animated,
+		file.information);
+	file.informationIsScaled = true;
+	file.shownDimensions = PrepareShownDimensions(size);
+	file.preview = Images::prepareOpaque(std::move(image));
+	file.preview.setDevicePixelRatio(cRetinaFactor());
+	file.type = PreparedFile::AlbumType::Photo;
 	return true;
+#else // OS_MAC_OLD
+	return false;
+#endif // OS_MAC_OLD
 }
 
-void PrepareAlbum(PreparedList &result, int previewWidth) {
-	const auto count = int(result.files.size());
-	if (count > kMaxAlbumCount) {
-		return;
+void PrepareAlbumMedia(PreparedFile &file, int previewWidth) {
+	if (!file.path.isEmpty()) {
+		file.mime = Core::MimeTypeForFile(QFileInfo(file.path)).name();
+		if (ReadScaledPhoto(file, previewWidth)) {
+			return;
+		}
+		file.information = FileLoadTask::ReadMediaInformation(
+			file.path,
+			QByteArray(),
+			file.mime);
+	} else if (!file.content.isEmpty()) {
+		file.mime = Core::MimeTypeForData(file.content).name();
+		file.information = FileLoadTask::ReadMediaInformation(
+			QString(),
+			file.content,
+			file.mime);
+	} else {
+		Assert(file.information != nullptr);
 	}
 
-	result.albumIsPossible = (count > 1);
-	auto waiting = 0;
-	QSemaphore semaphore;
-	for (auto &file : result.files) {
-		if (PrepareAlbumMediaIsWaiting(semaphore, file, previewWidth)) {
-			++waiting;
+	using Image = FileMediaInformation::Image;
+	using Video = FileMediaInformation::Video;
+	if (const auto image = base::get_if<Image>(
+			&file.information->media)) {
+		if (ValidPhotoForAlbum(*image)) {
+			file.shownDimensions = PrepareShownDimensions(image->data.size());
+			file.preview = Images::prepareOpaque(image->data.scaledToWidth(
+				std::min(previewWidth, ConvertScale(image->data.width()))
+					* cIntRetinaFactor(),
+				Qt::SmoothTransformation));
+			Assert(!file.preview.isNull());
+			file.preview.setDevicePixelRatio(cRetinaFactor());
+			file.type = PreparedFile::AlbumType::Photo;
 		}
-	}
-	if (waiting > 0) {
-		semaphore.acquire(waiting);
-		if (result.albumIsPossible) {
-			const auto badIt = ranges::find(
-				result.files,
-				PreparedFile::AlbumType::None,
-				[](const PreparedFile &file) { return file.type; });
-			result.albumIsPossible = (badIt == result.files.end());
+	} else if (const auto video = base::get_if<Video>(
+			&file.information->media)) {
+		if (ValidVideoForAlbum(*video)) {
+			auto blurred = Images::prepareBlur(Images::prepareOpaque(video->thumbnail));
+			file.shownDimensions = PrepareShownDimensions(video->thumbnail.size());
+			file.preview = std::move(blurred).scaledToWidth(
+				previewWidth * cIntRetinaFactor(),
+				Qt::SmoothTransformation);
+			Assert(!file.preview.isNull());
+			file.preview.setDevicePixelRatio(cRetinaFactor());
+			file.type = PreparedFile::AlbumType::Video;
 		}
 	}
 }
 
+// Until the files are read an album is guessed from their mime types.
+// It is checked again by refreshAlbumIsPossible() when they are prepared.
+void GuessAlbumIsPossible(PreparedList &result) {
+	const auto count = int(result.files.size());
+	const auto mayBeMedia = [](const PreparedFile &file) {
+		const auto mime = Core::MimeTypeForFile(QFileInfo(file.path)).name();
+		return mime.startsWith(qstr("image/"))
+			|| mime.startsWith(qstr("video/"));
+	};
+	result.albumIsPossible = (count > 1)
+		&& (count <= kMaxAlbumCount)
+		&& std::all_of(result.files.begin(), result.files.end(), mayBeMedia);
+}
+
+PreparedFile CopyForPreparing(const PreparedFile &file) {
+	auto result = PreparedFile(file.path);
+	result.content = file.content;
+	if (file.information) {
+		result.information = std::make_unique<FileMediaInformation>(
+			*file.information);
+	}
+	return result;
+}
+
 } // namespace
 
 bool ValidateThumbDimensions(int width, int height) {
@@ -199,7 +249,7 @@ MimeDataState ComputeMimeDataState(const QMimeData *data) {
 		: MimeDataState::Files;
 }
 
-PreparedList PrepareMediaList(const QList<QUrl> &files, int previewWidth) {
+PreparedList PrepareMediaList(const QList<QUrl> &files) {
 	auto locals = QStringList();
 	locals.reserve(files.size());
 	for (const auto &url : files) {
@@ -211,10 +261,10 @@ PreparedList PrepareMediaList(const QList<QUrl> &files, int previewWidth) {
 		}
 		locals.push_back(Platform::File::UrlToLocal(url));
 	}
-	return PrepareMediaList(locals, previewWidth);
+	return PrepareMediaList(locals);
 }
 
-PreparedList PrepareMediaList(const QStringList &files, int previewWidth) {
+PreparedList PrepareMediaList(const QStringList &files) {
 	auto result = PreparedList();
 	result.files.reserve(files.size());
 	const auto extensionsToCompress = cExtensionsForCompress();
@@ -243,14 +293,13 @@ PreparedList PrepareMediaList(const QStringList &files, int previewWidth) {
 		}
 		result.files.emplace_back(file);
 	}
-	PrepareAlbum(result, previewWidth);
+	GuessAlbumIsPossible(result);
 	return result;
 }
 
 PreparedList PrepareMediaFromImage(
 		QImage &&image,
-		QByteArray &&content,
-		int previewWidth) {
+		QByteArray &&content) {
 	auto result = Storage::PreparedList();
 	result.allFilesForCompress = ValidateThumbDimensions(
 		image.width(),
@@ -266,10 +315,53 @@ PreparedList PrepareMediaFromImage(
 			file.information);
 	}
 	result.files.push_back(std::move(file));
-	PrepareAlbum(result, previewWidth);
+	GuessAlbumIsPossible(result);
 	return result;
 }
 
+// A few tasks take the files one by one, so that a large album does not
+// occupy all the threads of the pool with its decoding at once.
+void PrepareMediaInBackground(
+		const PreparedList &list,
+		int previewWidth,
+		base::binary_guard &&guard,
+		Fn<void(int index, PreparedFile &&file)> ready) {
+	struct State {
+		base::binary_guard guard;
+		Fn<void(int, PreparedFile&&)> ready;
+		std::vector<PreparedFile> files;
+		std::atomic<int> next = { 0 };
+	};
+	const auto count = int(list.files.size());
+	if (!count) {
+		return;
+	}
+	const auto state = std::make_shared<State>();
+	state->guard = std::move(guard);
+	state->ready = std::move(ready);
+	state->files.reserve(count);
+	for (const auto &file : list.files) {
+		state->files.push_back(CopyForPreparing(file));
+	}
+	const auto tasks = std::min(count, MaxPreparingTasks());
+	for (auto i = 0; i != tasks; ++i) {
+		crl::async([=] {
+			while (state->guard.alive()) {
+				const auto index = state->next++;
+				if (index >= count) {
+					return;
+				}
+				PrepareAlbumMedia(state->files[index], previewWidth);
+				crl::on_main([=] {
+					if (state->guard.alive()) {
+						state->ready(index, std::move(state->files[index]));
+					}
+				});
+			}
+		});
+	}
+}
+
 PreparedList PreparedList::Reordered(
 		PreparedList &&list,
 		std::vector<int> order) {
@@ -300,6 +392,10 @@ void PreparedList::mergeToEnd(PreparedList &&other) {
 	for (auto &file : other.files) {
 		files.push_back(std::move(file));
 	}
+	refreshAlbumIsPossible();
+}
+
+void PreparedList::refreshAlbumIsPossible() {
 	if (files.size() > 1 && files.size() <= kMaxAlbumCount) {
 		const auto badIt = ranges::find(
 			files,
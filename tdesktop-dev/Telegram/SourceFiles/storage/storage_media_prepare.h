@@ -7,6 +7,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "base/binary_guard.h"
+
 struct FileMediaInformation;
 
 namespace Storage {
@@ -36,6 +38,7 @@ struct PreparedFile {
 	QByteArray content;
 	QString mime;
 	std::unique_ptr<FileMediaInformation> information;
+	bool informationIsScaled = false;
 	QImage preview;
 	QSize shownDimensions;
 	AlbumType type = AlbumType::None;
@@ -60,6 +63,7 @@ struct PreparedList {
 		PreparedList &&list,
 		std::vector<int> order);
 	void mergeToEnd(PreparedList &&other);
+	void refreshAlbumIsPossible();
 
 	Error error = Error::None;
 	QString errorData;
@@ -70,12 +74,18 @@ struct PreparedList {
 };
 
 bool ValidateThumbDimensions(int width, int height);
-PreparedList PrepareMediaList(const QList<QUrl> &files, int previewWidth);
-PreparedList PrepareMediaList(const QStringList &files, int previewWidth);
-PreparedList PrepareMediaFromImage(
-	QImage &&image,
-	QByteArray &&content,
-	int previewWidth);
+PreparedList PrepareMediaList(const QList<QUrl> &files);
+PreparedList PrepareMediaList(const QStringList &files);
+PreparedList PrepareMediaFromImage(QImage &&image, QByteArray &&content);
+
+// Reads the media information and the previews of the files. Each file
+// is passed to ready() on the main thread as soon as it is prepared,
+// while the guard is alive.
+void PrepareMediaInBackground(
+	const PreparedList &list,
+	int previewWidth,
+	base::binary_guard &&guard,
+	Fn<void(int index, PreparedFile &&file)> ready);
 int MaxAlbumItems();
 
 } // namespace Storage
@@ -0,0 +1,33 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "storage/storage_encryption.h"
+
+namespace Storage {
+namespace Tests {
+
+// Keys shared by the encrypted file and the journal tests.
+const auto Key = EncryptionKey(bytes::make_vector(
+	bytes::make_span("\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+").subspan(0, EncryptionKey::kSize)));
+
+const auto WrongKey = EncryptionKey(bytes::make_vector(
+	bytes::make_span("\
+01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh\
+01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh\
+01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh\
+01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh\
+").subspan(0, EncryptionKey::kSize)));
+
+} // namespace Tests
+} // namespace Storage
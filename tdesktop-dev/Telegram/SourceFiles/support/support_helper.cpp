@@ -578,7 +578,7 @@ QString InterpretSendPath(const QString &path) {
 	}
 	Ui::showPeerHistory(history, ShowAtUnreadMsgId);
 	Auth().api().sendFiles(
-		Storage::PrepareMediaList(QStringList(filePath), st::sendMediaPreviewSize),
+		Storage::PrepareMediaList(QStringList(filePath)),
 		SendMediaType::File,
 		{ caption },
 		nullptr,
@@ -9,6 +9,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "media/media_clip_reader.h"
 
+#include <QtGui/QScreen>
+
 namespace Media {
 namespace Clip {
 
@@ -26,9 +28,19 @@ ReaderPointer::~ReaderPointer() {
 
 namespace {
 
+constexpr auto kDefaultRefreshRate = 60.;
+constexpr auto kMaxFrameInterval = TimeMs(1000 / 30);
+
 AnimationManager *_manager = nullptr;
 bool AnimationsDisabled = false;
 
+TimeMs ComputeFrameInterval(QScreen *screen) {
+	const auto rate = screen ? screen->refreshRate() : 0.;
+	const auto interval = TimeMs(std::round(1000.
+		/ ((rate > 0.) ? rate : kDefaultRefreshRate)));
+	return snap(interval, TimeMs(AnimationTimerDelta), kMaxFrameInterval);
+}
+
 } // namespace
 
 namespace anim {
@@ -99,6 +111,10 @@ void registerClipManager(not_null<Media::Clip::Manager*> manager) {
 	_manager->registerClip(manager);
 }
 
+FrameStats TakeFrameStats() {
+	return _manager ? _manager->takeStats() : FrameStats();
+}
+
 bool Disabled() {
 	return AnimationsDisabled;
 }
@@ -155,9 +171,32 @@ void BasicAnimation::stop() {
 	_manager->stop(this);
 }
 
-AnimationManager::AnimationManager() : _timer(this) {
-	_timer.setSingleShot(false);
+AnimationManager::AnimationManager()
+: _timer(this) {
+	_timer.setSingleShot(true);
+	_timer.setTimerType(Qt::PreciseTimer);
 	connect(&_timer, &QTimer::timeout, this, &AnimationManager::step);
+
+	const auto app = static_cast<QGuiApplication*>(
+		QCoreApplication::instance());
+	connect(
+		app,
+		&QGuiApplication::primaryScreenChanged,
+		this,
+		&AnimationManager::watchScreen);
+	watchScreen(app->primaryScreen());
+}
+
+void AnimationManager::watchScreen(QScreen *screen) {
+	disconnect(_refreshRateChanged);
+	if (screen) {
+		_refreshRateChanged = connect(
+			screen,
+			&QScreen::refreshRateChanged,
+			this,
+			[=] { _interval = ComputeFrameInterval(screen); });
+	}
+	_interval = ComputeFrameInterval(screen);
 }
 
 void AnimationManager::start(BasicAnimation *obj) {
@@ -167,10 +206,8 @@ void AnimationManager::start(BasicAnimation *obj) {
 			_stopping.erase(obj);
 		}
 	} else {
-		if (_objects.empty()) {
-			_timer.start(AnimationTimerDelta);
-		}
 		_objects.insert(obj);
+		schedule();
 	}
 }
 
@@ -184,7 +221,7 @@ void AnimationManager::stop(BasicAnimation *obj) {
 		auto i = _objects.find(obj);
 		if (i != _objects.cend()) {
 			_objects.erase(i);
-			if (_objects.empty()) {
+			if (_objects.empty() && _clipNotifications.empty()) {
 				_timer.stop();
 			}
 		}
@@ -199,9 +236,31 @@ void AnimationManager::registerClip(not_null<Media::Clip::Manager*> clip) {
 		&AnimationManager::clipCallback);
 }
 
+void AnimationManager::schedule() {
+	if (_timer.isActive()) {
+		return;
+	}
+
+	// Fire on a multiple of the frame interval, so that the steps started
+	// at different moments are still done in a single tick. This is a grid
+	// on the getms() clock, it is not synchronized with the display vsync.
+	const auto now = getms();
+	const auto delay = _interval - (now % _interval);
+	_scheduledFor = now + delay;
+	_timer.start(delay);
+}
+
 void AnimationManager::step() {
-	_iterating = true;
 	const auto ms = getms();
+	if (_scheduledFor && ms - _scheduledFor >= _interval) {
+		++_stats.late;
+	}
+	_scheduledFor = 0;
+	_timer.stop();
+
+	deliverClipNotifications();
+
+	_iterating = true;
 	for (const auto object : _objects) {
 		if (!_stopping.contains(object)) {
 			object->step(ms, true);
@@ -221,8 +280,50 @@ void AnimationManager::step() {
 		}
 		_stopping.clear();
 	}
-	if (_objects.empty()) {
-		_timer.stop();
+	if (!_objects.empty() || !_clipNotifications.empty()) {
+		schedule();
+	}
+
+	const auto duration = getms() - ms;
+	++_stats.frames;
+	_stats.stepsDuration += duration;
+	accumulate_max(_stats.maxStepDuration, duration);
+}
+
+anim::FrameStats AnimationManager::takeStats() {
+	auto result = base::take(_stats);
+	result.interval = _interval;
+	return result;
+}
+
+void AnimationManager::deliverClipNotifications() {
+	if (_clipNotifications.empty()) {
+		return;
+	}
+	const auto same = [](
+			const ClipNotification &a,
+			const ClipNotification &b) {
+		return (a.reader == b.reader)
+			&& (a.threadIndex == b.threadIndex)
+			&& (a.notification == b.notification);
+	};
+
+	// The callbacks could push new notifications, they wait for the next tick.
+	const auto list = base::take(_clipNotifications);
+	for (auto i = begin(list); i != end(list); ++i) {
+		const auto already = std::find_if(begin(list), i, [&](
+				const ClipNotification &entry) {
+			return same(entry, *i);
+		});
+		if (already != i) {
+			// Several frames were ready till the tick, one repaint is enough.
+			++_stats.clipNotificationsSkipped;
+			continue;
+		}
+		Media::Clip::Reader::callback(
+			i->reader,
+			i->threadIndex,
+			Media::Clip::Notification(i->notification));
 	}
 }
 
@@ -230,9 +331,8 @@ void AnimationManager::clipCallback(
 		Media::Clip::Reader *reader,
 		qint32 threadIndex,
 		qint32 notification) {
-	Media::Clip::Reader::callback(
-		reader,
-		threadIndex,
-		Media::Clip::Notification(notification));
+	++_stats.clipNotifications;
+	_clipNotifications.push_back({ reader, threadIndex, notification });
+	schedule();
 }
 
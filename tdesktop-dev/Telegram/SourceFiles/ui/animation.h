@@ -12,6 +12,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/binary_guard.h"
 #include "base/flat_set.h"
 
+class QScreen;
+
 namespace Media {
 namespace Clip {
 
@@ -165,6 +167,19 @@ void startManager();
 void stopManager();
 void registerClipManager(not_null<Media::Clip::Manager*> manager);
 
+struct FrameStats {
+	TimeMs interval = 0;
+	int frames = 0;
+	int late = 0;
+	TimeMs stepsDuration = 0;
+	TimeMs maxStepDuration = 0;
+	int clipNotifications = 0;
+	int clipNotificationsSkipped = 0;
+};
+
+// Returns the stats collected since the previous call.
+FrameStats TakeFrameStats();
+
 TG_FORCE_INLINE int interpolate(int a, int b, float64 b_ratio) {
 	return qRound(a + float64(b - a) * b_ratio);
 }
@@ -700,6 +715,10 @@ private:
 
 };
 
+// All the animation steps and clip notifications are done in one tick,
+// once per primary screen refresh interval. The ticks are aligned to a
+// common time grid, not to the display vsync, and the timer doesn't run
+// while idle. Widgets driving their own base::Timer are not affected.
 class AnimationManager : public QObject {
 public:
 	AnimationManager();
@@ -710,14 +729,30 @@ public:
 	void registerClip(not_null<Media::Clip::Manager*> clip);
 	void step();
 
+	anim::FrameStats takeStats();
+
 private:
+	struct ClipNotification {
+		Media::Clip::Reader *reader = nullptr;
+		qint32 threadIndex = 0;
+		qint32 notification = 0;
+	};
+
+	void watchScreen(QScreen *screen);
+	void schedule();
+	void deliverClipNotifications();
 	void clipCallback(
 		Media::Clip::Reader *reader,
 		qint32 threadIndex,
 		qint32 notification);
 
 	base::flat_set<BasicAnimation*> _objects, _starting, _stopping;
+	std::vector<ClipNotification> _clipNotifications;
 	QTimer _timer;
+	QMetaObject::Connection _refreshRateChanged;
+	TimeMs _interval = 0;
+	TimeMs _scheduledFor = 0;
 	bool _iterating = false;
+	anim::FrameStats _stats;
 
 };
@@ -0,0 +1,114 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/emoji_benchmark.h"
+
+#include "ui/emoji_config.h"
+
+#include <random>
+
+namespace Ui {
+namespace Emoji {
+namespace {
+
+constexpr auto kMaxWords = 200;
+
+QString GenerateMessage(std::mt19937 &generator) {
+	static const auto words = std::vector<QString>{
+		qsl("the"),
+		qsl("message"),
+		qsl("telegram"),
+		qsl("https://telegram.org/blog"),
+		qsl("12:30"),
+		qsl("#hashtag"),
+		qsl(":-)"),
+		qsl("<3"),
+		qsl(":thumbs_up:"),
+		QString::fromUtf8("\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82"),
+		QString::fromUtf8("\xd1\x81\xd0\xbe\xd0\xbe\xd0\xb1\xd1\x89\xd0\xb5\xd0\xbd\xd0\xb8\xd0\xb5"),
+		QString::fromUtf8("\xe4\xbd\xa0\xe5\xa5\xbd\xe4\xb8\x96\xe7\x95\x8c"),
+		QString::fromUtf8("\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7"),
+		QString::fromUtf8("\xe0\xa4\xa8\xe0\xa4\xae\xe0\xa4\xb8\xe0\xa5\x8d\xe0\xa4\xa4\xe0\xa5\x87"),
+		QString::fromUtf8("\xf0\x9f\x98\x82"),
+		QString::fromUtf8("\xf0\x9f\x91\x8d\xf0\x9f\x8f\xbd"),
+		QString::fromUtf8("\xe2\x9d\xa4\xef\xb8\x8f"),
+		QString::fromUtf8("\xf0\x9f\x87\xa9\xf0\x9f\x87\xaa"),
+	};
+	auto wordIndex = std::uniform_int_distribution<int>(
+		0,
+		int(words.size()) - 1);
+	auto wordsCount = std::uniform_int_distribution<int>(1, kMaxWords);
+	auto newline = std::uniform_int_distribution<int>(0, 15);
+
+	auto result = QString();
+	for (auto i = 0, count = wordsCount(generator); i != count; ++i) {
+		if (!result.isEmpty()) {
+			result.append(newline(generator) ? ' ' : '\n');
+		}
+		result.append(words[wordIndex(generator)]);
+	}
+	return result;
+}
+
+} // namespace
+
+QString BenchmarkFind(int count) {
+	auto generator = std::mt19937(count);
+	auto texts = std::vector<QString>();
+	texts.reserve(count);
+	auto characters = int64(0);
+	for (auto i = 0; i != count; ++i) {
+		texts.push_back(GenerateMessage(generator));
+		characters += texts.back().size();
+	}
+
+	// The text parser looks for an emoji at every position.
+	auto found = int64(0);
+	const auto findStart = getms(true);
+	for (const auto &text : texts) {
+		const auto end = text.constData() + text.size();
+		for (auto ch = text.constData(); ch != end;) {
+			auto length = 0;
+			if (Find(ch, end, &length)) {
+				++found;
+				ch += length;
+			} else {
+				++ch;
+			}
+		}
+	}
+	const auto find = getms(true) - findStart;
+
+	auto replaced = int64(0);
+	const auto replaceStart = getms(true);
+	for (const auto &text : texts) {
+		auto copy = TextWithEntities{ text };
+		ReplaceInText(copy);
+		replaced += copy.text.size();
+	}
+	const auto replace = getms(true) - replaceStart;
+
+	const auto megabytes = double(characters * sizeof(QChar))
+		/ (1024. * 1024.);
+	const auto speed = [&](TimeMs ms) {
+		return ms ? (megabytes * 1000. / ms) : 0.;
+	};
+	return qsl("Texts: %1, %2 MB\n"
+		"Find: %3 ms (%4 MB/s), %5 emoji\n"
+		"Replace: %6 ms (%7 MB/s), %8 chars"
+		).arg(count
+		).arg(megabytes, 0, 'f', 1
+		).arg(find
+		).arg(speed(find), 0, 'f', 1
+		).arg(found
+		).arg(replace
+		).arg(speed(replace), 0, 'f', 1
+		).arg(replaced);
+}
+
+} // namespace Emoji
+} // namespace Ui
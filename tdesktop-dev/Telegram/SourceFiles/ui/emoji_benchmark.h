@@ -0,0 +1,19 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Ui {
+namespace Emoji {
+
+// Runs the emoji lookups of the text parser and the emoji replacement
+// of the message field over count multilingual message-like texts.
+// Returns a human readable report with the timings.
+QString BenchmarkFind(int count);
+
+} // namespace Emoji
+} // namespace Ui
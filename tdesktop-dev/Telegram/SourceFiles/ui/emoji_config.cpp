@@ -25,21 +25,40 @@ constexpr auto kImagesPerRow = 32;
 constexpr auto kImageRowsPerSprite = 16;
 
 constexpr auto kVersion = 3;
+constexpr auto kCheckedVersion = 1;
 
+// The sprites are decoded one by one when they are first needed.
 class UniversalImages {
 public:
-	void ensureLoaded();
 	void clear();
 
-	void draw(QPainter &p, EmojiPtr emoji, int size, int x, int y) const;
+	void draw(QPainter &p, EmojiPtr emoji, int size, int x, int y);
 
-	QImage generate(int size, int index) const;
+	QImage generate(int size, int index);
 
 private:
+	QImage sprite(int index);
+
+	QMutex _mutex;
 	std::vector<QImage> _sprites;
 
 };
 
+struct MappedFile {
+	QImage image;
+	bytes::const_span header;
+	bytes::const_span data;
+	bytes::const_span signature;
+	qint64 modified = 0;
+};
+
+struct CheckedSprite {
+	qint64 modified = 0;
+	bytes::vector signature;
+	bool good = false;
+};
+using CheckedSprites = base::flat_map<int, CheckedSprite>;
+
 auto SizeNormal = -1;
 auto SizeLarge = -1;
 auto SpritesCount = -1;
@@ -76,7 +95,11 @@ QString CacheFilePath(int size, int index) {
 		+ QString::number(index);
 }
 
-void SaveToFile(const QImage &image, int size, int index) {
+QString CheckedFilePath(int size) {
+	return CacheFileFolder() + '/' + CacheFileNameMask(size) + "checked";
+}
+
+bool SaveToFile(const QImage &image, int size, int index) {
 	Expects(image.bytesPerLine() == image.width() * 4);
 
 	QFile f(CacheFilePath(size, index));
@@ -87,7 +110,7 @@ void SaveToFile(const QImage &image, int size, int index) {
 				).arg(f.fileName()
 				).arg(size
 				).arg(index));
-			return;
+			return false;
 		}
 	}
 	const auto write = [&](bytes::const_span data) {
@@ -112,85 +135,161 @@ void SaveToFile(const QImage &image, int size, int index) {
 		LOG(("App Error: Could not write emoji cache '%1' for size %2"
 			).arg(f.fileName()
 			).arg(size));
+		return false;
 	}
+	return true;
+}
+
+void UnmapFile(void *file) {
+	delete static_cast<QFile*>(file);
 }
 
-QImage LoadFromFile(int size, int index) {
+// The image doesn't own a copy of the pixels, it draws right from
+// the mapped file, so only the rows with the drawn emoji are read.
+MappedFile MapFromFile(int size, int index) {
 	const auto rows = RowsCount(index);
 	const auto width = kImagesPerRow * size;
 	const auto height = rows * size;
-	const auto fileSize = 4 * sizeof(uint32)
-		+ (width * height * 4)
-		+ openssl::kSha256Size;
-	QFile f(CacheFilePath(size, index));
-	if (!f.exists()
-		|| f.size() != fileSize
-		|| !f.open(QIODevice::ReadOnly)) {
-		return QImage();
-	}
-	const auto read = [&](bytes::span data) {
-		return f.read(
-			reinterpret_cast<char*>(data.data()),
-			data.size()
-		) == data.size();
-	};
+	const auto headerSize = int(4 * sizeof(uint32));
+	const auto dataSize = width * height * 4;
+	const auto fileSize = headerSize + dataSize + openssl::kSha256Size;
+	auto file = std::make_unique<QFile>(CacheFilePath(size, index));
+	if (!file->exists()
+		|| file->size() != fileSize
+		|| !file->open(QIODevice::ReadOnly)) {
+		return MappedFile();
+	}
+	const auto mapped = static_cast<const uchar*>(file->map(0, fileSize));
+	if (!mapped) {
+		return MappedFile();
+	}
+	const auto all = bytes::const_span(
+		reinterpret_cast<const bytes::type*>(mapped),
+		fileSize);
 	uint32 header[4] = { 0 };
-	if (!read(bytes::make_span(header))
-		|| header[0] != kVersion
+	bytes::copy(bytes::make_span(header), all.subspan(0, headerSize));
+	if (header[0] != kVersion
 		|| header[1] != size
 		|| header[2] != width
 		|| header[3] != height) {
-		return QImage();
+		return MappedFile();
 	}
-	auto result = QImage(
+	auto result = MappedFile();
+	result.header = all.subspan(0, headerSize);
+	result.data = all.subspan(headerSize, dataSize);
+	result.signature = all.subspan(headerSize + dataSize);
+	result.modified = QFileInfo(*file).lastModified().toMSecsSinceEpoch();
+	result.image = QImage(
+		mapped + headerSize,
 		width,
 		height,
-		QImage::Format_ARGB32_Premultiplied);
-	Assert(result.bytesPerLine() == width * 4);
-	const auto data = bytes::make_span(
-		reinterpret_cast<bytes::type*>(result.bits()),
-		width * height * 4);
-	auto signature = bytes::vector(openssl::kSha256Size);
-	if (!read(data)
-		|| !read(signature)
-		//|| (bytes::compare(
-		//	signature,
-		//	openssl::Sha256(bytes::make_span(header), data)) != 0)
-		|| false) {
-		return QImage();
-	}
-	crl::async([=, signature = std::move(signature)] {
-		// This should not happen (invalid signature),
-		// so we delay this check and fix only the next launch.
-		const auto data = bytes::make_span(
-			reinterpret_cast<const bytes::type*>(result.bits()),
-			width * height * 4);
-		const auto result = bytes::compare(
-			signature,
-			openssl::Sha256(bytes::make_span(header), data));
-		if (result != 0) {
-			QFile(CacheFilePath(size, index)).remove();
-		}
-	});
+		width * 4,
+		QImage::Format_ARGB32_Premultiplied,
+		UnmapFile,
+		file.release());
 	return result;
 }
 
-void UniversalImages::ensureLoaded() {
-	Expects(SpritesCount > 0);
+bool GoodSignature(const MappedFile &file) {
+	const auto counted = openssl::Sha256(file.header, file.data);
+	return (bytes::compare(file.signature, counted) == 0);
+}
+
+CheckedSprites ReadChecked(int size) {
+	QFile f(CheckedFilePath(size));
+	if (!f.open(QIODevice::ReadOnly)) {
+		return CheckedSprites();
+	}
+	QDataStream stream(&f);
+	stream.setVersion(QDataStream::Qt_5_1);
+
+	auto version = qint32(0);
+	auto count = qint32(0);
+	stream >> version >> count;
+	if (stream.status() != QDataStream::Ok
+		|| version != kCheckedVersion
+		|| count < 0
+		|| count > SpritesCount) {
+		return CheckedSprites();
+	}
+	auto result = CheckedSprites();
+	for (auto i = 0; i != count; ++i) {
+		auto index = qint32(0);
+		auto checked = CheckedSprite();
+		auto signature = QByteArray();
+		stream >> index >> checked.modified >> signature >> checked.good;
+		if (stream.status() != QDataStream::Ok) {
+			return CheckedSprites();
+		}
+		checked.signature = bytes::make_vector(signature);
+		result.emplace(index, std::move(checked));
+	}
+	return result;
+}
 
-	if (!_sprites.empty()) {
+void WriteChecked(int size, const CheckedSprites &checked) {
+	QFile f(CheckedFilePath(size));
+	if (!f.open(QIODevice::WriteOnly)) {
 		return;
 	}
-	_sprites.reserve(SpritesCount);
-	const auto base = qsl(":/gui/emoji/emoji_");
-	for (auto i = 0; i != SpritesCount; ++i) {
-		auto image = QImage();
-		image.load(base + QString::number(i + 1) + ".webp", "WEBP");
-		_sprites.push_back(std::move(image));
+	QDataStream stream(&f);
+	stream.setVersion(QDataStream::Qt_5_1);
+
+	stream << qint32(kCheckedVersion) << qint32(checked.size());
+	for (const auto &[index, sprite] : checked) {
+		stream
+			<< qint32(index)
+			<< sprite.modified
+			<< QByteArray(
+				reinterpret_cast<const char*>(sprite.signature.data()),
+				sprite.signature.size())
+			<< sprite.good;
+	}
+}
+
+// The signatures are counted only for the files that were not checked
+// before, so the whole sprite is read once and not on every launch.
+void CheckInBackground(
+		int size,
+		CheckedSprites &&checked,
+		std::vector<std::pair<int, MappedFile>> &&files) {
+	crl::async([
+		size,
+		checked = std::move(checked),
+		files = std::move(files)
+	]() mutable {
+		for (const auto &[index, file] : files) {
+			auto &entry = checked[index];
+			entry.modified = file.modified;
+			entry.signature = bytes::make_vector(file.signature);
+			entry.good = GoodSignature(file);
+			if (!entry.good) {
+				// This should not happen (invalid signature),
+				// so we delay this check and fix only the next launch.
+				QFile(CacheFilePath(size, index)).remove();
+			}
+		}
+		WriteChecked(size, checked);
+	});
+}
+
+QImage UniversalImages::sprite(int index) {
+	Expects(index >= 0 && index < SpritesCount);
+
+	QMutexLocker lock(&_mutex);
+	if (_sprites.empty()) {
+		_sprites.resize(SpritesCount);
+	}
+	auto &result = _sprites[index];
+	if (result.isNull()) {
+		const auto base = qsl(":/gui/emoji/emoji_");
+		result.load(base + QString::number(index + 1) + ".webp", "WEBP");
 	}
+	return result;
 }
 
 void UniversalImages::clear() {
+	QMutexLocker lock(&_mutex);
 	_sprites.clear();
 }
 
@@ -199,26 +298,23 @@ void UniversalImages::draw(
 		EmojiPtr emoji,
 		int size,
 		int x,
-		int y) const {
-	Expects(emoji->sprite() < _sprites.size());
-
+		int y) {
 	const auto factored = (size / p.device()->devicePixelRatio());
 	const auto large = kUniversalSize;
 
 	PainterHighQualityEnabler hq(p);
 	p.drawImage(
 		QRect(x, y, factored, factored),
-		_sprites[emoji->sprite()],
+		sprite(emoji->sprite()),
 		QRect(emoji->column() * large, emoji->row() * large, large, large));
 }
 
-QImage UniversalImages::generate(int size, int index) const {
+QImage UniversalImages::generate(int size, int index) {
 	Expects(size > 0);
-	Expects(index < _sprites.size());
 
 	const auto rows = RowsCount(index);
 	const auto large = kUniversalSize;
-	const auto &original = _sprites[index];
+	const auto original = sprite(index);
 	const auto data = original.bits();
 	const auto stride = original.bytesPerLine();
 	const auto format = original.format();
@@ -250,7 +346,6 @@ QImage UniversalImages::generate(int size, int index) const {
 			}
 		}
 	}
-	SaveToFile(result, size, index);
 	return result;
 }
 
@@ -295,6 +390,17 @@ EmojiPtr FindReplacement(const QChar *start, const QChar *end, int *outLength) {
 	return internal::FindReplace(start, end, outLength);
 }
 
+// Only a few code units can start a replacement, the others are skipped
+// with a table lookup instead of the full FindReplacement() call.
+const QChar *SkipToReplacement(const QChar *from, const QChar *end) {
+	while (from != end
+		&& from->unicode() != ':'
+		&& !internal::IsReplaceStart(from->unicode())) {
+		++from;
+	}
+	return from;
+}
+
 void ClearUniversalChecked() {
 	Expects(InstanceNormal != nullptr && InstanceLarge != nullptr);
 
@@ -456,6 +562,12 @@ void ReplaceInText(TextWithEntities &result) {
 				canFindEmoji = false;
 			}
 			++ch;
+
+			const auto next = SkipToReplacement(ch, end);
+			if (next != ch) {
+				canFindEmoji = internal::IsReplaceEdge(next - 1);
+				ch = next;
+			}
 		}
 	}
 	if (newText.text.isEmpty()) {
@@ -618,7 +730,6 @@ void Draw(QPainter &p, EmojiPtr emoji, int size, int x, int y) {
 Instance::Instance(int size) : _size(size) {
 	readCache();
 	if (!cached()) {
-		Universal.ensureLoaded();
 		generateCache();
 	}
 }
@@ -633,19 +744,36 @@ void Instance::draw(QPainter &p, EmojiPtr emoji, int x, int y) {
 		Universal.draw(p, emoji, _size, x, y);
 		return;
 	}
-	p.drawPixmap(
-		QPoint(x, y),
+	const auto factored = _size / cRetinaFactor();
+	p.drawImage(
+		QRectF(x, y, factored, factored),
 		_sprites[sprite],
 		QRect(emoji->column() * _size, emoji->row() * _size, _size, _size));
 }
 
 void Instance::readCache() {
+	auto checked = ReadChecked(_size);
+	auto unchecked = std::vector<std::pair<int, MappedFile>>();
 	for (auto i = 0; i != SpritesCount; ++i) {
-		auto image = LoadFromFile(_size, i);
-		if (image.isNull()) {
-			return;
+		auto file = MapFromFile(_size, i);
+		if (file.image.isNull()) {
+			break;
+		}
+		const auto known = checked.find(i);
+		if (known == checked.end()
+			|| known->second.modified != file.modified
+			|| bytes::compare(known->second.signature, file.signature)) {
+			unchecked.emplace_back(i, file);
+		} else if (!known->second.good) {
+			// The file was in use when it was found bad, remove it now.
+			file = MappedFile();
+			QFile(CacheFilePath(_size, i)).remove();
+			break;
 		}
-		pushSprite(std::move(image));
+		pushSprite(std::move(file.image));
+	}
+	if (!unchecked.empty()) {
+		CheckInBackground(_size, std::move(checked), std::move(unchecked));
 	}
 }
 
@@ -655,9 +783,18 @@ void Instance::generateCache() {
 	auto [left, right] = base::make_binary_guard();
 	_generating = std::move(left);
 	crl::async([=, guard = std::move(right)]() mutable {
+		auto image = Universal.generate(size, index);
+		if (SaveToFile(image, size, index)) {
+			// Draw from the file we've just written, so that the memory
+			// keeps only the pages with the emoji that are really used.
+			auto mapped = MapFromFile(size, index);
+			if (!mapped.image.isNull()) {
+				image = std::move(mapped.image);
+			}
+		}
 		crl::on_main([
 			this,
-			image = Universal.generate(size, index),
+			image = std::move(image),
 			guard = std::move(guard)
 		]() mutable {
 			if (!guard.alive()) {
@@ -674,8 +811,8 @@ void Instance::generateCache() {
 }
 
 void Instance::pushSprite(QImage &&data) {
-	_sprites.push_back(App::pixmapFromImageInPlace(std::move(data)));
-	_sprites.back().setDevicePixelRatio(cRetinaFactor());
+	// No device pixel ratio here, it would detach the mapped image.
+	_sprites.push_back(std::move(data));
 }
 
 } // namespace Emoji
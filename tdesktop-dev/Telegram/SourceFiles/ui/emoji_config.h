@@ -151,7 +151,7 @@ private:
 	void pushSprite(QImage &&data);
 
 	int _size = 0;
-	std::vector<QPixmap> _sprites;
+	std::vector<QImage> _sprites;
 	base::binary_guard _generating;
 
 };
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/image/image.h"
 
 #include "ui/image/image_source.h"
+#include "ui/image/image_pixmap_cache.h"
 #include "core/media_active_cache.h"
 #include "storage/cache/storage_cache_database.h"
 #include "data/data_session.h"
@@ -31,10 +32,6 @@ int64 ComputeUsage(QSize size) {
 	return int64(size.width()) * size.height() * 4;
 }
 
-int64 ComputeUsage(const QPixmap &image) {
-	return ComputeUsage(image.size());
-}
-
 int64 ComputeUsage(const QImage &image) {
 	return ComputeUsage(image.size());
 }
@@ -75,6 +72,7 @@ void ClearRemote() {
 
 void ClearAll() {
 	ActiveCache().clear();
+	Pixmaps().clear();
 	for (auto image : base::take(LocalFileImages)) {
 		delete image;
 	}
@@ -370,14 +368,12 @@ const QPixmap &Image::pix(
     }
 	auto options = Option::Smooth | Option::None;
 	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-        p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixRounded(
@@ -409,14 +405,12 @@ const QPixmap &Image::pixRounded(
 		options |= Option::Circled | cornerOptions(corners);
 	}
 	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixCircled(
@@ -433,14 +427,12 @@ const QPixmap &Image::pixCircled(
 	}
 	auto options = Option::Smooth | Option::Circled;
 	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurredCircled(
@@ -457,14 +449,12 @@ const QPixmap &Image::pixBlurredCircled(
 	}
 	auto options = Option::Smooth | Option::Circled | Option::Blurred;
 	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurred(
@@ -481,14 +471,12 @@ const QPixmap &Image::pixBlurred(
 	}
 	auto options = Option::Smooth | Option::Blurred;
 	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixColored(
@@ -506,14 +494,12 @@ const QPixmap &Image::pixColored(
 	}
 	auto options = Option::Smooth | Option::Colored;
 	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixColoredNoCache(origin, add, w, h, true);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixColoredNoCache(origin, add, w, h, true);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurredColored(
@@ -531,14 +517,12 @@ const QPixmap &Image::pixBlurredColored(
 	}
 	auto options = Option::Blurred | Option::Smooth | Option::Colored;
 	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixBlurredColoredNoCache(origin, add, w, h);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixBlurredColoredNoCache(origin, add, w, h);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixSingle(
@@ -578,17 +562,13 @@ const QPixmap &Image::pixSingle(
 	}
 
 	auto k = SinglePixKey(options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
-		if (i != _sizesCache.cend()) {
-			ActiveCache().decrement(ComputeUsage(*i));
-		}
-		auto p = pixNoCache(origin, w, h, options, outerw, outerh, colored);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto size = QSize(outerw, outerh) * cIntRetinaFactor();
+	if (const auto cached = Pixmaps().find(this, k, size)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options, outerw, outerh, colored);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurredSingle(
@@ -624,17 +604,13 @@ const QPixmap &Image::pixBlurredSingle(
 	}
 
 	auto k = SinglePixKey(options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
-		if (i != _sizesCache.cend()) {
-			ActiveCache().decrement(ComputeUsage(*i));
-		}
-		auto p = pixNoCache(origin, w, h, options, outerw, outerh);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto size = QSize(outerw, outerh) * cIntRetinaFactor();
+	if (const auto cached = Pixmaps().find(this, k, size)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options, outerw, outerh);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 QPixmap Image::pixNoCache(
@@ -791,11 +767,7 @@ void Image::setImageBytes(const QByteArray &bytes) {
 }
 
 void Image::invalidateSizeCache() const {
-	auto &cache = ActiveCache();
-	for (const auto &image : std::as_const(_sizesCache)) {
-		cache.decrement(ComputeUsage(image));
-	}
-	_sizesCache.clear();
+	Pixmaps().remove(this);
 }
 
 Image::~Image() {
@@ -251,7 +251,6 @@ private:
 	void invalidateSizeCache() const;
 
 	std::unique_ptr<Images::Source> _source;
-	mutable QMap<uint64, QPixmap> _sizesCache;
 	mutable QImage _data;
 
 };
@@ -0,0 +1,79 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/image/image_decoder.h"
+
+namespace Images {
+namespace {
+
+constexpr auto kRenewTimeout = crl::time_type(1000);
+
+DecodeResult Decode(const QByteArray &bytes, QSize shrinkBox) {
+	auto result = DecodeResult();
+	auto image = App::readImage(bytes, &result.format, false);
+	if (!image.isNull()
+		&& !shrinkBox.isEmpty()
+		&& (image.width() > shrinkBox.width()
+			|| image.height() > shrinkBox.height())) {
+		result.image = image.scaled(
+			shrinkBox,
+			Qt::KeepAspectRatio,
+			Qt::SmoothTransformation);
+	} else {
+		result.image = std::move(image);
+	}
+	return result;
+}
+
+} // namespace
+
+struct DecodeRequest::State {
+	std::atomic<bool> alive = true;
+	std::atomic<crl::time_type> renewed = 0;
+};
+
+DecodeRequest::DecodeRequest(
+	const QByteArray &bytes,
+	QSize shrinkBox,
+	FnMut<void(DecodeResult&&)> done)
+: _state(std::make_shared<State>()) {
+	renew();
+	crl::async([
+		state = _state,
+		bytes,
+		shrinkBox,
+		done = std::move(done)
+	]() mutable {
+		auto result = DecodeResult();
+		if (!state->alive) {
+			return;
+		} else if (crl::time() - state->renewed > kRenewTimeout) {
+			result.cancelled = true;
+		} else {
+			result = Decode(bytes, shrinkBox);
+		}
+		crl::on_main([
+			state = std::move(state),
+			result = std::move(result),
+			done = std::move(done)
+		]() mutable {
+			if (state->alive) {
+				done(std::move(result));
+			}
+		});
+	});
+}
+
+void DecodeRequest::renew() {
+	_state->renewed = crl::time();
+}
+
+DecodeRequest::~DecodeRequest() {
+	_state->alive = false;
+}
+
+} // namespace Images
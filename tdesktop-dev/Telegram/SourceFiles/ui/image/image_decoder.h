@@ -0,0 +1,44 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Images {
+
+struct DecodeResult {
+	QImage image;
+	QByteArray format;
+	bool cancelled = false;
+};
+
+// Decodes the image and shrinks it to fit in the box (if not empty)
+// in a background thread. The callback is called in the main thread
+// unless the request is destroyed before that.
+//
+// If the request was not renewed for some time when a thread takes it,
+// for example the image was scrolled out of view and is not painted,
+// it is cancelled without decoding.
+class DecodeRequest {
+public:
+	DecodeRequest(
+		const QByteArray &bytes,
+		QSize shrinkBox,
+		FnMut<void(DecodeResult&&)> done);
+	DecodeRequest(const DecodeRequest &other) = delete;
+	DecodeRequest &operator=(const DecodeRequest &other) = delete;
+	~DecodeRequest();
+
+	void renew();
+
+private:
+	struct State;
+
+	std::shared_ptr<State> _state;
+
+};
+
+} // namespace Images
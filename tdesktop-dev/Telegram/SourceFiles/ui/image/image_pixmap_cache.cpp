@@ -0,0 +1,123 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/image/image_pixmap_cache.h"
+
+namespace Images {
+namespace {
+
+// After 64 MB of rendered variants we drop the least recently used ones.
+constexpr auto kDefaultLimit = 64 * 1024 * 1024;
+
+int64 ComputeUsage(const QPixmap &pixmap) {
+	return int64(pixmap.width()) * pixmap.height() * 4;
+}
+
+} // namespace
+
+PixmapCache::PixmapCache(int64 limit)
+: _delayedCheck([=] { checkLimit(); })
+, _limit(limit) {
+}
+
+const QPixmap *PixmapCache::find(
+		not_null<const Image*> image,
+		uint64 key,
+		QSize size) {
+	const auto i = _entries.find(Key(image, key));
+	if (i == end(_entries)
+		|| (!size.isEmpty() && i->second.pixmap.size() != size)) {
+		++_misses;
+		return nullptr;
+	}
+	++_hits;
+	up(i);
+	return &i->second.pixmap;
+}
+
+const QPixmap &PixmapCache::insert(
+		not_null<const Image*> image,
+		uint64 key,
+		QPixmap &&pixmap) {
+	const auto bytes = ComputeUsage(pixmap);
+	auto i = _entries.find(Key(image, key));
+	if (i != end(_entries)) {
+		_usage -= i->second.bytes;
+		i->second.pixmap = std::move(pixmap);
+		i->second.bytes = bytes;
+		up(i);
+	} else {
+		const auto position = _lastUsed.insert(
+			end(_lastUsed),
+			Key(image, key));
+		i = _entries.emplace(
+			Key(image, key),
+			Entry{ std::move(pixmap), bytes, position }).first;
+	}
+	_usage += bytes;
+	if (_usage > _limit) {
+		_delayedCheck.call();
+	}
+	return i->second.pixmap;
+}
+
+void PixmapCache::remove(not_null<const Image*> image) {
+	const auto from = _entries.lower_bound(Key(image, 0));
+	auto i = from;
+	while (i != end(_entries) && i->first.first == image.get()) {
+		_usage -= i->second.bytes;
+		_lastUsed.erase(i->second.position);
+		++i;
+	}
+	_entries.erase(from, i);
+}
+
+void PixmapCache::clear() {
+	_entries.clear();
+	_lastUsed.clear();
+	_usage = 0;
+}
+
+PixmapCache::Stats PixmapCache::stats() const {
+	auto result = Stats();
+	result.usage = _usage;
+	result.limit = _limit;
+	result.count = int(_entries.size());
+	result.hits = _hits;
+	result.misses = _misses;
+	result.evicted = _evicted;
+	result.evictedBytes = _evictedBytes;
+	return result;
+}
+
+void PixmapCache::up(Entries::iterator i) {
+	_lastUsed.splice(end(_lastUsed), _lastUsed, i->second.position);
+}
+
+void PixmapCache::erase(Entries::iterator i) {
+	_usage -= i->second.bytes;
+	_lastUsed.erase(i->second.position);
+	_entries.erase(i);
+}
+
+void PixmapCache::checkLimit() {
+	while (_usage > _limit && !_lastUsed.empty()) {
+		const auto i = _entries.find(_lastUsed.front());
+		Assert(i != end(_entries));
+
+		++_evicted;
+		_evictedBytes += i->second.bytes;
+		erase(i);
+	}
+}
+
+PixmapCache &Pixmaps() {
+	static auto Instance = PixmapCache(kDefaultLimit);
+	return Instance;
+}
+
+} // namespace Images
@@ -0,0 +1,81 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <list>
+#include <map>
+
+class Image;
+
+namespace Images {
+
+// Rendered (scaled, rounded, blurred, colored) variants of all images.
+//
+// Each variant is accounted by the bytes of its pixels, because that is
+// what gets uploaded to the graphics system when the pixmap is painted.
+// The least recently used variants are dropped when the limit is exceeded.
+class PixmapCache final {
+public:
+	struct Stats {
+		int64 usage = 0;
+		int64 limit = 0;
+		int count = 0;
+		int64 hits = 0;
+		int64 misses = 0;
+		int64 evicted = 0;
+		int64 evictedBytes = 0;
+	};
+
+	explicit PixmapCache(int64 limit);
+
+	// If size is not empty the cached variant should have the same size.
+	const QPixmap *find(
+		not_null<const Image*> image,
+		uint64 key,
+		QSize size = QSize());
+
+	// The returned reference stays valid until the next event loop
+	// iteration, because eviction is delayed until then.
+	const QPixmap &insert(
+		not_null<const Image*> image,
+		uint64 key,
+		QPixmap &&pixmap);
+
+	void remove(not_null<const Image*> image);
+	void clear();
+
+	Stats stats() const;
+
+private:
+	using Key = std::pair<const Image*, uint64>;
+	struct Entry {
+		QPixmap pixmap;
+		int64 bytes = 0;
+		std::list<Key>::iterator position;
+	};
+	using Entries = std::map<Key, Entry>;
+
+	void up(Entries::iterator i);
+	void erase(Entries::iterator i);
+	void checkLimit();
+
+	Entries _entries;
+	std::list<Key> _lastUsed;
+	SingleQueuedInvokation _delayedCheck;
+	int64 _usage = 0;
+	int64 _limit = 0;
+	int64 _hits = 0;
+	int64 _misses = 0;
+	int64 _evicted = 0;
+	int64 _evictedBytes = 0;
+
+};
+
+PixmapCache &Pixmaps();
+
+} // namespace Images
@@ -0,0 +1,106 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/image/image_prepare_benchmark.h"
+
+#include "ui/image/image_prepare_kernels.h"
+
+#include <random>
+
+namespace Images {
+namespace {
+
+using Kernels::Instructions;
+
+// Roughly a blurred photo thumbnail and a large corner mask.
+constexpr auto kBlurSize = 320;
+constexpr auto kMaskSize = 32;
+
+QString InstructionsName(Instructions instructions) {
+	switch (instructions) {
+	case Instructions::Scalar: return qsl("Scalar");
+	case Instructions::SSE2: return qsl("SSE2");
+	case Instructions::AVX2: return qsl("AVX2");
+	}
+	Unexpected("Instructions in InstructionsName.");
+}
+
+QByteArray RandomBytes(std::mt19937 &generator, int size) {
+	auto distribution = std::uniform_int_distribution<int>(0, 255);
+	auto result = QByteArray(size, Qt::Uninitialized);
+	for (auto &byte : result) {
+		byte = char(distribution(generator));
+	}
+	return result;
+}
+
+} // namespace
+
+QString BenchmarkPrepare(int count) {
+	auto generator = std::mt19937(count);
+	const auto blurSource = RandomBytes(generator, kBlurSize * kBlurSize * 4);
+	const auto maskSource = RandomBytes(generator, kMaskSize * kMaskSize * 4);
+	const auto mask = RandomBytes(generator, kMaskSize * kMaskSize * 4);
+
+	auto result = QStringList();
+	auto blurExpected = QByteArray();
+	auto maskExpected = QByteArray();
+	const auto supported = Kernels::SupportedInstructions();
+	for (const auto instructions : {
+			Instructions::Scalar,
+			Instructions::SSE2,
+			Instructions::AVX2 }) {
+		if (int(instructions) > int(supported)) {
+			break;
+		}
+		auto blur = blurSource;
+		const auto blurStart = getms(true);
+		for (auto i = 0; i != count; ++i) {
+			blur = blurSource;
+			Kernels::Blur(
+				reinterpret_cast<uchar*>(blur.data()),
+				kBlurSize,
+				kBlurSize,
+				kBlurSize * 4,
+				instructions);
+		}
+		const auto blurTime = getms(true) - blurStart;
+
+		auto masked = maskSource;
+		const auto maskStart = getms(true);
+		for (auto i = 0; i != count; ++i) {
+			masked = maskSource;
+			Kernels::Mask(
+				reinterpret_cast<uint32*>(masked.data()),
+				kMaskSize,
+				reinterpret_cast<const uchar*>(mask.constData()),
+				kMaskSize,
+				kMaskSize,
+				4,
+				kMaskSize * 4,
+				instructions);
+		}
+		const auto maskTime = getms(true) - maskStart;
+
+		if (instructions == Instructions::Scalar) {
+			blurExpected = blur;
+			maskExpected = masked;
+		}
+		const auto same = (blur == blurExpected && masked == maskExpected);
+		result.push_back(qsl("%1: blur %2 ms, mask %3 ms%4"
+			).arg(InstructionsName(instructions)
+			).arg(blurTime
+			).arg(maskTime
+			).arg(same ? QString() : qsl(", DIFFERENT OUTPUT")));
+	}
+	return qsl("Images: %1, blur %2x%2, mask %3x%3\n"
+		).arg(count
+		).arg(kBlurSize
+		).arg(kMaskSize) + result.join('\n');
+}
+
+} // namespace Images
@@ -0,0 +1,17 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Images {
+
+// Runs the blur and corner masking kernels count times on random images
+// with each instruction set supported by the processor.
+// Returns a human readable report with the timings.
+QString BenchmarkPrepare(int count);
+
+} // namespace Images
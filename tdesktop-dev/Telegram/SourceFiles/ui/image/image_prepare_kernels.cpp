@@ -0,0 +1,757 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/image/image_prepare_kernels.h"
+
+#include "base/assertion.h"
+
+#include <vector>
+
+#ifdef ARCH_CPU_X86_FAMILY
+#define TDESKTOP_IMAGE_KERNELS_X86
+
+#include <immintrin.h>
+
+#ifdef COMPILER_MSVC
+#include <intrin.h>
+#define KERNELS_TARGET(name)
+#else // COMPILER_MSVC
+#include <cpuid.h>
+#define KERNELS_TARGET(name) __attribute__((target(name)))
+#endif // COMPILER_MSVC
+#endif // ARCH_CPU_X86_FAMILY
+
+// The SIMD versions process several rows (in the horizontal pass) or
+// several columns (in the vertical pass) at once, each channel in its
+// own 16 bit lane, exactly as the scalar version packs four channels
+// in an uint64. All the sums wrap around the same way, so the results
+// are identical to the scalar ones.
+//
+// Lambdas don't inherit the target attribute of the enclosing function
+// in GCC, so the passes are written with macros, like the original code.
+
+namespace Images {
+namespace Kernels {
+namespace {
+
+constexpr auto kBlurRadiusPlusOne = kBlurRadius + 1;
+constexpr auto kBlurFirstWeight = (kBlurRadiusPlusOne * (kBlurRadiusPlusOne + 1)) >> 1;
+constexpr auto kBlurShift = 4;
+static_assert(
+	kBlurRadiusPlusOne * kBlurRadiusPlusOne == (1 << kBlurShift),
+	"Blur weights should sum up to a power of two.");
+
+TG_FORCE_INLINE uint64 BlurGetColors(const uchar *p) {
+	return (uint64)p[0] + ((uint64)p[1] << 16) + ((uint64)p[2] << 32) + ((uint64)p[3] << 48);
+}
+
+void BlurRowScalar(const uchar *row, uint64 *out, int width) {
+	const auto first = BlurGetColors(row);
+	auto allsum = uint64(0) - kBlurRadius * first;
+	auto sum = first * kBlurFirstWeight;
+	for (auto i = 1; i <= kBlurRadius; ++i) {
+		const auto cur = BlurGetColors(row + i * 4);
+		sum += cur * (kBlurRadiusPlusOne - i);
+		allsum += cur;
+	}
+
+	auto x = 0;
+
+#define update(start, middle, end) \
+out[x] = (sum >> kBlurShift) & 0x00FF00FF00FF00FFULL; \
+allsum += BlurGetColors(row + (start) * 4) - 2 * BlurGetColors(row + (middle) * 4) + BlurGetColors(row + (end) * 4); \
+sum += allsum; \
+++x;
+
+	const auto we = width - kBlurRadiusPlusOne;
+	while (x < kBlurRadiusPlusOne) {
+		update(0, x, x + kBlurRadiusPlusOne);
+	}
+	while (x < we) {
+		update(x - kBlurRadiusPlusOne, x, x + kBlurRadiusPlusOne);
+	}
+	while (x < width) {
+		update(x - kBlurRadiusPlusOne, x, width - 1);
+	}
+
+#undef update
+}
+
+void BlurColumnScalar(
+		const uint64 *rgb,
+		int width,
+		uchar *column,
+		int bytesPerLine,
+		int height) {
+	auto allsum = uint64(0) - kBlurRadius * rgb[0];
+	auto sum = rgb[0] * kBlurFirstWeight;
+	for (auto i = 1; i <= kBlurRadius; ++i) {
+		sum += rgb[i * width] * (kBlurRadiusPlusOne - i);
+		allsum += rgb[i * width];
+	}
+
+	auto y = 0;
+	auto yi = 0;
+
+#define update(start, middle, end) \
+const auto res = sum >> kBlurShift; \
+column[yi] = res & 0xFF; \
+column[yi + 1] = (res >> 16) & 0xFF; \
+column[yi + 2] = (res >> 32) & 0xFF; \
+column[yi + 3] = (res >> 48) & 0xFF; \
+allsum += rgb[(start) * width] - 2 * rgb[(middle) * width] + rgb[(end) * width]; \
+sum += allsum; \
+++y; \
+yi += bytesPerLine;
+
+	const auto he = height - kBlurRadiusPlusOne;
+	while (y < kBlurRadiusPlusOne) {
+		update(0, y, y + kBlurRadiusPlusOne);
+	}
+	while (y < he) {
+		update(y - kBlurRadiusPlusOne, y, y + kBlurRadiusPlusOne);
+	}
+	while (y < height) {
+		update(y - kBlurRadiusPlusOne, y, height - 1);
+	}
+
+#undef update
+}
+
+void BlurScalar(uchar *pixels, int width, int height, int bytesPerLine) {
+	auto rgb = std::vector<uint64>(width * height);
+	for (auto y = 0; y != height; ++y) {
+		BlurRowScalar(
+			pixels + y * bytesPerLine,
+			rgb.data() + y * width,
+			width);
+	}
+	for (auto x = 0; x != width; ++x) {
+		BlurColumnScalar(
+			rgb.data() + x,
+			width,
+			pixels + x * 4,
+			bytesPerLine,
+			height);
+	}
+}
+
+void MaskScalar(
+		uint32 *image,
+		int imageIntsPerLine,
+		const uchar *mask,
+		int maskWidth,
+		int maskHeight,
+		int maskBytesPerPixel,
+		int maskBytesPerLine) {
+	for (auto y = 0; y != maskHeight; ++y) {
+		auto maskBytes = mask + y * maskBytesPerLine;
+		auto imageInts = image + y * imageIntsPerLine;
+		for (auto x = 0; x != maskWidth; ++x) {
+			// Same as anim::unshifted(anim::shifted(*imageInts) * opacity).
+			const auto opacity = static_cast<uint32>(*maskBytes) + 1;
+			const auto components = *imageInts;
+			const auto low = ((components & 0x000000FFU) | ((components & 0x0000FF00U) << 8)) * opacity;
+			const auto high = (((components & 0x00FF0000U) >> 16) | ((components & 0xFF000000U) >> 8)) * opacity;
+			*imageInts = ((low & 0x0000FF00U) >> 8)
+				| ((low & 0xFF000000U) >> 16)
+				| ((high & 0x0000FF00U) << 8)
+				| (high & 0xFF000000U);
+			maskBytes += maskBytesPerPixel;
+			++imageInts;
+		}
+	}
+}
+
+#ifdef TDESKTOP_IMAGE_KERNELS_X86
+
+TG_FORCE_INLINE int32 LoadPixel(const uchar *p) {
+	return *reinterpret_cast<const int32*>(p);
+}
+
+// Two rows at once: the low half is the first row, the high half the second.
+KERNELS_TARGET("sse2") TG_FORCE_INLINE __m128i BlurLoadRows2(
+		const uchar *rows,
+		int bytesPerLine,
+		int index) {
+	return _mm_unpacklo_epi8(
+		_mm_unpacklo_epi32(
+			_mm_cvtsi32_si128(LoadPixel(rows + index * 4)),
+			_mm_cvtsi32_si128(LoadPixel(rows + bytesPerLine + index * 4))),
+		_mm_setzero_si128());
+}
+
+KERNELS_TARGET("sse2") void BlurRowsSSE2(
+		const uchar *rows,
+		int bytesPerLine,
+		uint64 *out,
+		int width) {
+	const auto first = BlurLoadRows2(rows, bytesPerLine, 0);
+	auto allsum = _mm_sub_epi16(
+		_mm_setzero_si128(),
+		_mm_mullo_epi16(first, _mm_set1_epi16(kBlurRadius)));
+	auto sum = _mm_mullo_epi16(first, _mm_set1_epi16(kBlurFirstWeight));
+	for (auto i = 1; i <= kBlurRadius; ++i) {
+		const auto cur = BlurLoadRows2(rows, bytesPerLine, i);
+		sum = _mm_add_epi16(
+			sum,
+			_mm_mullo_epi16(cur, _mm_set1_epi16(kBlurRadiusPlusOne - i)));
+		allsum = _mm_add_epi16(allsum, cur);
+	}
+
+	auto x = 0;
+
+#define update(start, middle, end) \
+const auto res = _mm_srli_epi16(sum, kBlurShift); \
+_mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), res); \
+_mm_storel_epi64(reinterpret_cast<__m128i*>(out + width + x), _mm_unpackhi_epi64(res, res)); \
+const auto middleColors = BlurLoadRows2(rows, bytesPerLine, (middle)); \
+allsum = _mm_add_epi16(allsum, _mm_sub_epi16( \
+	_mm_add_epi16(BlurLoadRows2(rows, bytesPerLine, (start)), BlurLoadRows2(rows, bytesPerLine, (end))), \
+	_mm_add_epi16(middleColors, middleColors))); \
+sum = _mm_add_epi16(sum, allsum); \
+++x;
+
+	const auto we = width - kBlurRadiusPlusOne;
+	while (x < kBlurRadiusPlusOne) {
+		update(0, x, x + kBlurRadiusPlusOne);
+	}
+	while (x < we) {
+		update(x - kBlurRadiusPlusOne, x, x + kBlurRadiusPlusOne);
+	}
+	while (x < width) {
+		update(x - kBlurRadiusPlusOne, x, width - 1);
+	}
+
+#undef update
+}
+
+// Two columns at once, one uint64 of rgb for each of them.
+KERNELS_TARGET("sse2") void BlurColumnsSSE2(
+		const uint64 *rgb,
+		int width,
+		uchar *columns,
+		int bytesPerLine,
+		int height) {
+#define load(index) _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + (index) * width))
+
+	const auto first = load(0);
+	auto allsum = _mm_sub_epi16(
+		_mm_setzero_si128(),
+		_mm_mullo_epi16(first, _mm_set1_epi16(kBlurRadius)));
+	auto sum = _mm_mullo_epi16(first, _mm_set1_epi16(kBlurFirstWeight));
+	for (auto i = 1; i <= kBlurRadius; ++i) {
+		const auto cur = load(i);
+		sum = _mm_add_epi16(
+			sum,
+			_mm_mullo_epi16(cur, _mm_set1_epi16(kBlurRadiusPlusOne - i)));
+		allsum = _mm_add_epi16(allsum, cur);
+	}
+
+	auto y = 0;
+	auto yi = 0;
+
+#define update(start, middle, end) \
+const auto res = _mm_srli_epi16(sum, kBlurShift); \
+_mm_storel_epi64(reinterpret_cast<__m128i*>(columns + yi), _mm_packus_epi16(res, res)); \
+const auto middleColors = load(middle); \
+allsum = _mm_add_epi16(allsum, _mm_sub_epi16( \
+	_mm_add_epi16(load(start), load(end)), \
+	_mm_add_epi16(middleColors, middleColors))); \
+sum = _mm_add_epi16(sum, allsum); \
+++y; \
+yi += bytesPerLine;
+
+	const auto he = height - kBlurRadiusPlusOne;
+	while (y < kBlurRadiusPlusOne) {
+		update(0, y, y + kBlurRadiusPlusOne);
+	}
+	while (y < he) {
+		update(y - kBlurRadiusPlusOne, y, y + kBlurRadiusPlusOne);
+	}
+	while (y < height) {
+		update(y - kBlurRadiusPlusOne, y, height - 1);
+	}
+
+#undef update
+#undef load
+}
+
+KERNELS_TARGET("sse2") void BlurSSE2(
+		uchar *pixels,
+		int width,
+		int height,
+		int bytesPerLine) {
+	auto rgb = std::vector<uint64>(width * height);
+	auto y = 0;
+	for (; y + 2 <= height; y += 2) {
+		BlurRowsSSE2(
+			pixels + y * bytesPerLine,
+			bytesPerLine,
+			rgb.data() + y * width,
+			width);
+	}
+	for (; y != height; ++y) {
+		BlurRowScalar(
+			pixels + y * bytesPerLine,
+			rgb.data() + y * width,
+			width);
+	}
+	auto x = 0;
+	for (; x + 2 <= width; x += 2) {
+		BlurColumnsSSE2(
+			rgb.data() + x,
+			width,
+			pixels + x * 4,
+			bytesPerLine,
+			height);
+	}
+	for (; x != width; ++x) {
+		BlurColumnScalar(
+			rgb.data() + x,
+			width,
+			pixels + x * 4,
+			bytesPerLine,
+			height);
+	}
+}
+
+// Four rows at once, one 64 bit quarter for each of them.
+KERNELS_TARGET("avx2") TG_FORCE_INLINE __m256i BlurLoadRows4(
+		const uchar *rows,
+		int bytesPerLine,
+		int index) {
+	const auto pixel = rows + index * 4;
+	return _mm256_cvtepu8_epi16(_mm_set_epi32(
+		LoadPixel(pixel + 3 * bytesPerLine),
+		LoadPixel(pixel + 2 * bytesPerLine),
+		LoadPixel(pixel + bytesPerLine),
+		LoadPixel(pixel)));
+}
+
+KERNELS_TARGET("avx2") void BlurRowsAVX2(
+		const uchar *rows,
+		int bytesPerLine,
+		uint64 *out,
+		int width) {
+	const auto first = BlurLoadRows4(rows, bytesPerLine, 0);
+	auto allsum = _mm256_sub_epi16(
+		_mm256_setzero_si256(),
+		_mm256_mullo_epi16(first, _mm256_set1_epi16(kBlurRadius)));
+	auto sum = _mm256_mullo_epi16(
+		first,
+		_mm256_set1_epi16(kBlurFirstWeight));
+	for (auto i = 1; i <= kBlurRadius; ++i) {
+		const auto cur = BlurLoadRows4(rows, bytesPerLine, i);
+		sum = _mm256_add_epi16(
+			sum,
+			_mm256_mullo_epi16(
+				cur,
+				_mm256_set1_epi16(kBlurRadiusPlusOne - i)));
+		allsum = _mm256_add_epi16(allsum, cur);
+	}
+
+	auto x = 0;
+
+#define update(start, middle, end) \
+const auto res = _mm256_srli_epi16(sum, kBlurShift); \
+const auto low = _mm256_castsi256_si128(res); \
+const auto high = _mm256_extracti128_si256(res, 1); \
+_mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), low); \
+_mm_storel_epi64(reinterpret_cast<__m128i*>(out + width + x), _mm_unpackhi_epi64(low, low)); \
+_mm_storel_epi64(reinterpret_cast<__m128i*>(out + 2 * width + x), high); \
+_mm_storel_epi64(reinterpret_cast<__m128i*>(out + 3 * width + x), _mm_unpackhi_epi64(high, high)); \
+const auto middleColors = BlurLoadRows4(rows, bytesPerLine, (middle)); \
+allsum = _mm256_add_epi16(allsum, _mm256_sub_epi16( \
+	_mm256_add_epi16(BlurLoadRows4(rows, bytesPerLine, (start)), BlurLoadRows4(rows, bytesPerLine, (end))), \
+	_mm256_add_epi16(middleColors, middleColors))); \
+sum = _mm256_add_epi16(sum, allsum); \
+++x;
+
+	const auto we = width - kBlurRadiusPlusOne;
+	while (x < kBlurRadiusPlusOne) {
+		update(0, x, x + kBlurRadiusPlusOne);
+	}
+	while (x < we) {
+		update(x - kBlurRadiusPlusOne, x, x + kBlurRadiusPlusOne);
+	}
+	while (x < width) {
+		update(x - kBlurRadiusPlusOne, x, width - 1);
+	}
+
+#undef update
+}
+
+// Four columns at once, one uint64 of rgb for each of them.
+KERNELS_TARGET("avx2") void BlurColumnsAVX2(
+		const uint64 *rgb,
+		int width,
+		uchar *columns,
+		int bytesPerLine,
+		int height) {
+#define load(index) _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgb + (index) * width))
+
+	const auto first = load(0);
+	auto allsum = _mm256_sub_epi16(
+		_mm256_setzero_si256(),
+		_mm256_mullo_epi16(first, _mm256_set1_epi16(kBlurRadius)));
+	auto sum = _mm256_mullo_epi16(
+		first,
+		_mm256_set1_epi16(kBlurFirstWeight));
+	for (auto i = 1; i <= kBlurRadius; ++i) {
+		const auto cur = load(i);
+		sum = _mm256_add_epi16(
+			sum,
+			_mm256_mullo_epi16(
+				cur,
+				_mm256_set1_epi16(kBlurRadiusPlusOne - i)));
+		allsum = _mm256_add_epi16(allsum, cur);
+	}
+
+	auto y = 0;
+	auto yi = 0;
+
+	// Packing works inside 128 bit lanes, so we gather the 64 bit
+	// quarters 0 and 2 with the resulting bytes in the low half.
+#define update(start, middle, end) \
+const auto res = _mm256_srli_epi16(sum, kBlurShift); \
+const auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(res, res), 0x08); \
+_mm_storeu_si128(reinterpret_cast<__m128i*>(columns + yi), _mm256_castsi256_si128(packed)); \
+const auto middleColors = load(middle); \
+allsum = _mm256_add_epi16(allsum, _mm256_sub_epi16( \
+	_mm256_add_epi16(load(start), load(end)), \
+	_mm256_add_epi16(middleColors, middleColors))); \
+sum = _mm256_add_epi16(sum, allsum); \
+++y; \
+yi += bytesPerLine;
+
+	const auto he = height - kBlurRadiusPlusOne;
+	while (y < kBlurRadiusPlusOne) {
+		update(0, y, y + kBlurRadiusPlusOne);
+	}
+	while (y < he) {
+		update(y - kBlurRadiusPlusOne, y, y + kBlurRadiusPlusOne);
+	}
+	while (y < height) {
+		update(y - kBlurRadiusPlusOne, y, height - 1);
+	}
+
+#undef update
+#undef load
+}
+
+KERNELS_TARGET("avx2") void BlurAVX2(
+		uchar *pixels,
+		int width,
+		int height,
+		int bytesPerLine) {
+	auto rgb = std::vector<uint64>(width * height);
+	auto y = 0;
+	for (; y + 4 <= height; y += 4) {
+		BlurRowsAVX2(
+			pixels + y * bytesPerLine,
+			bytesPerLine,
+			rgb.data() + y * width,
+			width);
+	}
+	for (; y + 2 <= height; y += 2) {
+		BlurRowsSSE2(
+			pixels + y * bytesPerLine,
+			bytesPerLine,
+			rgb.data() + y * width,
+			width);
+	}
+	for (; y != height; ++y) {
+		BlurRowScalar(
+			pixels + y * bytesPerLine,
+			rgb.data() + y * width,
+			width);
+	}
+	auto x = 0;
+	for (; x + 4 <= width; x += 4) {
+		BlurColumnsAVX2(
+			rgb.data() + x,
+			width,
+			pixels + x * 4,
+			bytesPerLine,
+			height);
+	}
+	for (; x + 2 <= width; x += 2) {
+		BlurColumnsSSE2(
+			rgb.data() + x,
+			width,
+			pixels + x * 4,
+			bytesPerLine,
+			height);
+	}
+	for (; x != width; ++x) {
+		BlurColumnScalar(
+			rgb.data() + x,
+			width,
+			pixels + x * 4,
+			bytesPerLine,
+			height);
+	}
+}
+
+// Channel values are not larger than 255 and opacities are not larger
+// than 256, so the products fit in the 16 bit lanes without overflow.
+KERNELS_TARGET("sse2") void MaskSSE2(
+		uint32 *image,
+		int imageIntsPerLine,
+		const uchar *mask,
+		int maskWidth,
+		int maskHeight,
+		int maskBytesPerPixel,
+		int maskBytesPerLine) {
+	const auto zero = _mm_setzero_si128();
+	for (auto y = 0; y != maskHeight; ++y) {
+		const auto maskBytes = mask + y * maskBytesPerLine;
+		const auto imageInts = image + y * imageIntsPerLine;
+		auto x = 0;
+		for (; x + 4 <= maskWidth; x += 4) {
+			const auto opacity = [&](int index) {
+				const auto offset = (x + index) * maskBytesPerPixel;
+				return short(maskBytes[offset] + 1);
+			};
+			const auto o0 = opacity(0);
+			const auto o1 = opacity(1);
+			const auto o2 = opacity(2);
+			const auto o3 = opacity(3);
+			const auto pointer = reinterpret_cast<__m128i*>(imageInts + x);
+			const auto pixels = _mm_loadu_si128(pointer);
+			const auto low = _mm_mullo_epi16(
+				_mm_unpacklo_epi8(pixels, zero),
+				_mm_set_epi16(o1, o1, o1, o1, o0, o0, o0, o0));
+			const auto high = _mm_mullo_epi16(
+				_mm_unpackhi_epi8(pixels, zero),
+				_mm_set_epi16(o3, o3, o3, o3, o2, o2, o2, o2));
+			_mm_storeu_si128(pointer, _mm_packus_epi16(
+				_mm_srli_epi16(low, 8),
+				_mm_srli_epi16(high, 8)));
+		}
+		if (x != maskWidth) {
+			MaskScalar(
+				imageInts + x,
+				imageIntsPerLine,
+				maskBytes + x * maskBytesPerPixel,
+				maskWidth - x,
+				1,
+				maskBytesPerPixel,
+				maskBytesPerLine);
+		}
+	}
+}
+
+// Unpacking works inside 128 bit lanes, so the low part holds
+// pixels 0, 1, 4, 5 and the high part holds pixels 2, 3, 6, 7.
+KERNELS_TARGET("avx2") void MaskAVX2(
+		uint32 *image,
+		int imageIntsPerLine,
+		const uchar *mask,
+		int maskWidth,
+		int maskHeight,
+		int maskBytesPerPixel,
+		int maskBytesPerLine) {
+	const auto zero = _mm256_setzero_si256();
+	for (auto y = 0; y != maskHeight; ++y) {
+		const auto maskBytes = mask + y * maskBytesPerLine;
+		const auto imageInts = image + y * imageIntsPerLine;
+		auto x = 0;
+		for (; x + 8 <= maskWidth; x += 8) {
+			short o[8];
+			for (auto i = 0; i != 8; ++i) {
+				o[i] = short(maskBytes[(x + i) * maskBytesPerPixel] + 1);
+			}
+			const auto pointer = reinterpret_cast<__m256i*>(imageInts + x);
+			const auto pixels = _mm256_loadu_si256(pointer);
+			const auto low = _mm256_mullo_epi16(
+				_mm256_unpacklo_epi8(pixels, zero),
+				_mm256_set_epi16(
+					o[5], o[5], o[5], o[5], o[4], o[4], o[4], o[4],
+					o[1], o[1], o[1], o[1], o[0], o[0], o[0], o[0]));
+			const auto high = _mm256_mullo_epi16(
+				_mm256_unpackhi_epi8(pixels, zero),
+				_mm256_set_epi16(
+					o[7], o[7], o[7], o[7], o[6], o[6], o[6], o[6],
+					o[3], o[3], o[3], o[3], o[2], o[2], o[2], o[2]));
+			_mm256_storeu_si256(pointer, _mm256_packus_epi16(
+				_mm256_srli_epi16(low, 8),
+				_mm256_srli_epi16(high, 8)));
+		}
+		if (x != maskWidth) {
+			MaskSSE2(
+				imageInts + x,
+				imageIntsPerLine,
+				maskBytes + x * maskBytesPerPixel,
+				maskWidth - x,
+				1,
+				maskBytesPerPixel,
+				maskBytesPerLine);
+		}
+	}
+}
+
+void Cpuid(int result[4], int leaf) {
+#ifdef COMPILER_MSVC
+	__cpuidex(result, leaf, 0);
+#else // COMPILER_MSVC
+	auto a = 0U, b = 0U, c = 0U, d = 0U;
+	__cpuid_count(leaf, 0, a, b, c, d);
+	result[0] = int(a);
+	result[1] = int(b);
+	result[2] = int(c);
+	result[3] = int(d);
+#endif // COMPILER_MSVC
+}
+
+uint64 ExtendedControlRegister() {
+#ifdef COMPILER_MSVC
+	return _xgetbv(0);
+#else // COMPILER_MSVC
+	auto a = 0U, d = 0U;
+	__asm__ volatile("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+	return (uint64(d) << 32) | a;
+#endif // COMPILER_MSVC
+}
+
+#endif // TDESKTOP_IMAGE_KERNELS_X86
+
+Instructions ComputeSupportedInstructions() {
+#ifdef TDESKTOP_IMAGE_KERNELS_X86
+	int info[4] = { 0 };
+	Cpuid(info, 0);
+	const auto maxLeaf = info[0];
+	if (maxLeaf < 1) {
+		return Instructions::Scalar;
+	}
+	Cpuid(info, 1);
+	const auto sse2 = (info[3] & (1 << 26)) != 0;
+	const auto osxsave = (info[2] & (1 << 27)) != 0;
+	const auto avx = (info[2] & (1 << 28)) != 0;
+	if (!sse2) {
+		return Instructions::Scalar;
+	} else if (maxLeaf < 7 || !osxsave || !avx) {
+		return Instructions::SSE2;
+	}
+
+	// The OS should save the YMM registers on context switches.
+	const auto ymmSaved = ((ExtendedControlRegister() & 0x06) == 0x06);
+	Cpuid(info, 7);
+	const auto avx2 = (info[1] & (1 << 5)) != 0;
+	return (ymmSaved && avx2) ? Instructions::AVX2 : Instructions::SSE2;
+#else // TDESKTOP_IMAGE_KERNELS_X86
+	return Instructions::Scalar;
+#endif // TDESKTOP_IMAGE_KERNELS_X86
+}
+
+} // namespace
+
+Instructions SupportedInstructions() {
+	static const auto result = ComputeSupportedInstructions();
+	return result;
+}
+
+void Blur(uchar *pixels, int width, int height, int bytesPerLine) {
+	Blur(pixels, width, height, bytesPerLine, SupportedInstructions());
+}
+
+void Blur(
+		uchar *pixels,
+		int width,
+		int height,
+		int bytesPerLine,
+		Instructions instructions) {
+	Expects(width > 2 * kBlurRadius + 1);
+	Expects(height > 2 * kBlurRadius + 1);
+	Expects(bytesPerLine >= width * 4);
+
+#ifdef TDESKTOP_IMAGE_KERNELS_X86
+	switch (instructions) {
+	case Instructions::AVX2:
+		BlurAVX2(pixels, width, height, bytesPerLine);
+		return;
+	case Instructions::SSE2:
+		BlurSSE2(pixels, width, height, bytesPerLine);
+		return;
+	case Instructions::Scalar:
+		break;
+	}
+#endif // TDESKTOP_IMAGE_KERNELS_X86
+	BlurScalar(pixels, width, height, bytesPerLine);
+}
+
+void Mask(
+		uint32 *image,
+		int imageIntsPerLine,
+		const uchar *mask,
+		int maskWidth,
+		int maskHeight,
+		int maskBytesPerPixel,
+		int maskBytesPerLine) {
+	Mask(
+		image,
+		imageIntsPerLine,
+		mask,
+		maskWidth,
+		maskHeight,
+		maskBytesPerPixel,
+		maskBytesPerLine,
+		SupportedInstructions());
+}
+
+void Mask(
+		uint32 *image,
+		int imageIntsPerLine,
+		const uchar *mask,
+		int maskWidth,
+		int maskHeight,
+		int maskBytesPerPixel,
+		int maskBytesPerLine,
+		Instructions instructions) {
+	Expects(imageIntsPerLine >= maskWidth);
+	Expects(maskBytesPerPixel > 0);
+	Expects(maskBytesPerLine >= maskWidth * maskBytesPerPixel);
+
+#ifdef TDESKTOP_IMAGE_KERNELS_X86
+	switch (instructions) {
+	case Instructions::AVX2:
+		MaskAVX2(
+			image,
+			imageIntsPerLine,
+			mask,
+			maskWidth,
+			maskHeight,
+			maskBytesPerPixel,
+			maskBytesPerLine);
+		return;
+	case Instructions::SSE2:
+		MaskSSE2(
+			image,
+			imageIntsPerLine,
+			mask,
+			maskWidth,
+			maskHeight,
+			maskBytesPerPixel,
+			maskBytesPerLine);
+		return;
+	case Instructions::Scalar:
+		break;
+	}
+#endif // TDESKTOP_IMAGE_KERNELS_X86
+	MaskScalar(
+		image,
+		imageIntsPerLine,
+		mask,
+		maskWidth,
+		maskHeight,
+		maskBytesPerPixel,
+		maskBytesPerLine);
+}
+
+} // namespace Kernels
+} // namespace Images
@@ -0,0 +1,59 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+namespace Images {
+namespace Kernels {
+
+// All the implementations give exactly the same output,
+// so the choice between them is made only by the speed.
+enum class Instructions {
+	Scalar,
+	SSE2,
+	AVX2,
+};
+
+// The best instruction set available on this processor.
+Instructions SupportedInstructions();
+
+constexpr auto kBlurRadius = 3;
+
+// Stack blur with kBlurRadius of an ARGB32 (or RGB32) image in place.
+// Requires width and height to be larger than 2 * kBlurRadius + 1.
+void Blur(uchar *pixels, int width, int height, int bytesPerLine);
+void Blur(
+	uchar *pixels,
+	int width,
+	int height,
+	int bytesPerLine,
+	Instructions instructions);
+
+// Multiplies each ARGB32 pixel of the image by the first byte (+ 1) / 256
+// of the corresponding mask pixel, as the corner rounding does it.
+void Mask(
+	uint32 *image,
+	int imageIntsPerLine,
+	const uchar *mask,
+	int maskWidth,
+	int maskHeight,
+	int maskBytesPerPixel,
+	int maskBytesPerLine);
+void Mask(
+	uint32 *image,
+	int imageIntsPerLine,
+	const uchar *mask,
+	int maskWidth,
+	int maskHeight,
+	int maskBytesPerPixel,
+	int maskBytesPerLine,
+	Instructions instructions);
+
+} // namespace Kernels
+} // namespace Images
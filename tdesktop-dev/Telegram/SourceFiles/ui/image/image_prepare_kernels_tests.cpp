@@ -0,0 +1,130 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "ui/image/image_prepare_kernels.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Images::Kernels::Instructions;
+
+std::vector<Instructions> AvailableInstructions() {
+	const auto supported = Images::Kernels::SupportedInstructions();
+	auto result = std::vector<Instructions>();
+	for (const auto instructions : {
+			Instructions::SSE2,
+			Instructions::AVX2 }) {
+		if (int(instructions) <= int(supported)) {
+			result.push_back(instructions);
+		}
+	}
+	return result;
+}
+
+std::vector<uchar> RandomBytes(std::mt19937 &generator, int size) {
+	auto distribution = std::uniform_int_distribution<int>(0, 255);
+	auto result = std::vector<uchar>(size);
+	for (auto &byte : result) {
+		byte = uchar(distribution(generator));
+	}
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("blur kernels give identical output", "[image_prepare]") {
+	auto generator = std::mt19937(42);
+	const auto minSize = 2 * Images::Kernels::kBlurRadius + 2;
+	for (const auto instructions : AvailableInstructions()) {
+		for (auto width = minSize; width != minSize + 9; ++width) {
+			for (auto height = minSize; height != minSize + 9; ++height) {
+				const auto bytesPerLine = width * 4 + 8 * (height % 2);
+				const auto original = RandomBytes(
+					generator,
+					bytesPerLine * height);
+				auto scalar = original;
+				Images::Kernels::Blur(
+					scalar.data(),
+					width,
+					height,
+					bytesPerLine,
+					Instructions::Scalar);
+				auto vector = original;
+				Images::Kernels::Blur(
+					vector.data(),
+					width,
+					height,
+					bytesPerLine,
+					instructions);
+				REQUIRE(vector == scalar);
+			}
+		}
+	}
+}
+
+TEST_CASE("mask kernels give identical output", "[image_prepare]") {
+	auto generator = std::mt19937(42);
+	for (const auto instructions : AvailableInstructions()) {
+		for (auto size = 1; size != 40; ++size) {
+			const auto maskBytesPerPixel = (size % 2) ? 4 : 1;
+			const auto maskBytesPerLine = size * maskBytesPerPixel + 3;
+			const auto mask = RandomBytes(generator, maskBytesPerLine * size);
+			const auto imageIntsPerLine = size + 5;
+			const auto bytes = RandomBytes(
+				generator,
+				imageIntsPerLine * size * 4);
+			auto original = std::vector<uint32>(imageIntsPerLine * size);
+			memcpy(original.data(), bytes.data(), bytes.size());
+
+			auto scalar = original;
+			Images::Kernels::Mask(
+				scalar.data(),
+				imageIntsPerLine,
+				mask.data(),
+				size,
+				size,
+				maskBytesPerPixel,
+				maskBytesPerLine,
+				Instructions::Scalar);
+			auto vector = original;
+			Images::Kernels::Mask(
+				vector.data(),
+				imageIntsPerLine,
+				mask.data(),
+				size,
+				size,
+				maskBytesPerPixel,
+				maskBytesPerLine,
+				instructions);
+			REQUIRE(vector == scalar);
+		}
+	}
+}
+
+TEST_CASE("mask kernel keeps opaque pixels", "[image_prepare]") {
+	const auto size = 16;
+	const auto mask = std::vector<uchar>(size * size, uchar(255));
+	const auto original = std::vector<uint32>(size * size, 0xFF336699U);
+	for (const auto instructions : AvailableInstructions()) {
+		auto image = original;
+		Images::Kernels::Mask(
+			image.data(),
+			size,
+			mask.data(),
+			size,
+			size,
+			1,
+			size,
+			instructions);
+		REQUIRE(image == original);
+	}
+}
@@ -281,7 +281,9 @@ QByteArray LocalFileSource::bytesForCache() {
 }
 
 QImage RemoteSource::takeLoaded() {
-	if (!loaderValid() || !_loader->finished()) {
+	if (!loaderValid()
+		|| !_loader->finished()
+		|| !_loader->prepareImage(shrinkBox())) {
 		return QImage();
 	}
 
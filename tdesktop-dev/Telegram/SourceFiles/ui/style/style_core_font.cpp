@@ -11,6 +11,9 @@ namespace style {
 namespace internal {
 namespace {
 
+constexpr auto kMaxCachedWidths = 4096;
+constexpr auto kMaxCachedWidthLength = 64;
+
 typedef QMap<QString, int> FontFamilyMap;
 FontFamilyMap fontFamilyMap;
 
@@ -20,10 +23,44 @@ FontFamilies fontFamilies;
 typedef QMap<uint32, FontData*> FontDatas;
 FontDatas fontsMap;
 
+// Fonts are created lazily, also from the text parsing threads.
+QMutex FontsMutex(QMutex::Recursive);
+
+struct ThreadFont {
+	explicit ThreadFont(const QFont &font) : f(font), m(f) {
+	}
+
+	QFont f;
+	QFontMetrics m;
+};
+
+// Keyed by fontKey() and not by FontData pointer, because the FontData
+// objects are recreated after destroyFonts() and the addresses reused.
+using ThreadFonts = std::map<uint32, std::unique_ptr<ThreadFont>>;
+QThreadStorage<ThreadFonts> ThreadFontsStorage;
+
 uint32 fontKey(int size, uint32 flags, int family) {
 	return (((uint32(family) << 10) | uint32(size)) << 3) | flags;
 }
 
+bool InMainThread() {
+	return (QThread::currentThread() == QCoreApplication::instance()->thread());
+}
+
+QFont ResolveFont(const QString &family, int size, uint32 flags) {
+	auto result = QFont(family);
+	result.setPixelSize(size);
+	if (flags & FontBold) {
+		result.setBold(true);
+	//} else if (fontFamilies[family] == "Open Sans Semibold") {
+	//	result.setWeight(QFont::DemiBold);
+	}
+	result.setItalic(flags & FontItalic);
+	result.setUnderline(flags & FontUnderline);
+	result.setStyleStrategy(QFont::PreferQuality);
+	return result;
+}
+
 } // namespace
 
 void destroyFonts() {
@@ -34,6 +71,7 @@ void destroyFonts() {
 }
 
 int registerFontFamily(const QString &family) {
+	QMutexLocker lock(&FontsMutex);
 	auto result = fontFamilyMap.value(family, -1);
 	if (result < 0) {
 		result = fontFamilies.size();
@@ -44,8 +82,9 @@ int registerFontFamily(const QString &family) {
 }
 
 FontData::FontData(int size, uint32 flags, int family, Font *other)
-: f(Fonts::GetOverride(fontFamilies[family]))
+: f(ResolveFont(Fonts::GetOverride(fontFamilies[family]), size, flags))
 , m(f)
+, _familyOverride(f.family())
 , _size(size)
 , _flags(flags)
 , _family(family) {
@@ -56,17 +95,6 @@ FontData::FontData(int size, uint32 flags, int family, Font *other)
 	}
 	modified[_flags] = Font(this);
 
-	f.setPixelSize(size);
-	if (_flags & FontBold) {
-		f.setBold(true);
-	//} else if (fontFamilies[family] == "Open Sans Semibold") {
-	//	f.setWeight(QFont::DemiBold);
-	}
-	f.setItalic(_flags & FontItalic);
-	f.setUnderline(_flags & FontUnderline);
-	f.setStyleStrategy(QFont::PreferQuality);
-
-	m = QFontMetrics(f);
 	height = m.height();
 	ascent = m.ascent();
 	descent = m.descent();
@@ -74,6 +102,45 @@ FontData::FontData(int size, uint32 flags, int family, Font *other)
 	elidew = width(qsl("..."));
 }
 
+const QFont &FontData::threadFont() const {
+	if (InMainThread()) {
+		return f;
+	}
+	auto &fonts = ThreadFontsStorage.localData();
+	auto &result = fonts[fontKey(_size, _flags, _family)];
+	if (!result) {
+		result = std::make_unique<ThreadFont>(
+			ResolveFont(_familyOverride, _size, _flags));
+	}
+	return result->f;
+}
+
+const QFontMetrics &FontData::threadMetrics() const {
+	if (InMainThread()) {
+		return m;
+	}
+	threadFont();
+	return ThreadFontsStorage.localData()[
+		fontKey(_size, _flags, _family)]->m;
+}
+
+int32 FontData::width(const QString &str) const {
+	// Names, dates and short labels are measured again on each repaint.
+	if (str.size() > kMaxCachedWidthLength || !InMainThread()) {
+		return threadMetrics().width(str);
+	}
+	const auto i = _widths.constFind(str);
+	if (i != _widths.cend()) {
+		return i.value();
+	}
+	if (_widths.size() >= kMaxCachedWidths) {
+		_widths.clear();
+	}
+	const auto result = m.width(str);
+	_widths.insert(str, result);
+	return result;
+}
+
 Font FontData::bold(bool set) const {
 	return otherFlagsFont(FontBold, set);
 }
@@ -99,6 +166,7 @@ int FontData::family() const {
 }
 
 Font FontData::otherFlagsFont(uint32 flag, bool set) const {
+	QMutexLocker lock(&FontsMutex);
 	int32 newFlags = set ? (_flags | flag) : (_flags & ~flag);
 	if (!modified[newFlags].v()) {
 		modified[newFlags] = Font(_size, newFlags, _family, modified);
@@ -107,6 +175,7 @@ Font FontData::otherFlagsFont(uint32 flag, bool set) const {
 }
 
 Font::Font(int size, uint32 flags, const QString &family) {
+	QMutexLocker lock(&FontsMutex);
 	if (fontFamilyMap.isEmpty()) {
 		for (uint32 i = 0, s = fontFamilies.size(); i != s; ++i) {
 			fontFamilyMap.insert(fontFamilies.at(i), i);
@@ -130,6 +199,7 @@ Font::Font(int size, uint32 flags, int family, Font *modified) {
 }
 
 void Font::init(int size, uint32 flags, int family, Font *modified) {
+	QMutexLocker lock(&FontsMutex);
 	uint32 key = fontKey(size, flags, family);
 	auto i = fontsMap.constFind(key);
 	if (i == fontsMap.cend()) {
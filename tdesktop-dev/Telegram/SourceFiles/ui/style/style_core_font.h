@@ -63,19 +63,22 @@ enum FontFlags {
 class FontData {
 public:
 
-	int32 width(const QString &str) const {
-		return m.width(str);
-	}
+	int32 width(const QString &str) const;
 	int32 width(const QString &str, int32 from, int32 to) const {
 		return width(str.mid(from, to));
 	}
 	int32 width(QChar ch) const {
-		return m.width(ch);
+		return threadMetrics().width(ch);
 	}
 	QString elided(const QString &str, int32 width, Qt::TextElideMode mode = Qt::ElideRight) const {
-		return m.elidedText(str, mode, width);
+		return threadMetrics().elidedText(str, mode, width);
 	}
 
+	// Copies of f and m share the font engine cache with the originals,
+	// so outside of the main thread separate instances are used.
+	const QFont &threadFont() const;
+	const QFontMetrics &threadMetrics() const;
+
 	Font bold(bool set = true) const;
 	Font italic(bool set = true) const;
 	Font underline(bool set = true) const;
@@ -90,11 +93,13 @@ public:
 
 private:
 	mutable Font modified[FontDifferentFlags];
+	mutable QHash<QString, int32> _widths;
 
 	Font otherFlagsFont(uint32 flag, bool set) const;
 	FontData(int size, uint32 flags, int family, Font *other);
 
 	friend class Font;
+	QString _familyOverride;
 	int _size;
 	uint32 _flags;
 	int _family;
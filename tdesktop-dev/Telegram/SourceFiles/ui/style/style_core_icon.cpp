@@ -91,6 +91,10 @@ MonoIcon::MonoIcon(const IconMask *mask, Color color, QPoint offset)
 }
 
 void MonoIcon::reset() const {
+	// After a palette change only the icons with changed colors are redone.
+	if (!_pixmap.isNull() && colorKey(_color->c) == _pixmapColorKey) {
+		return;
+	}
 	_pixmap = QPixmap();
 	_size = QSize();
 }
@@ -274,6 +278,7 @@ void MonoIcon::createCachedPixmap() const {
 		j = iconPixmaps->insert(key, App::pixmapFromImageInPlace(std::move(image)));
 	}
 	_pixmap = j.value();
+	_pixmapColorKey = key.second;
 	_size = _pixmap.size() / cIntRetinaFactor();
 }
 
@@ -73,6 +73,7 @@ private:
 	QPoint _offset = { 0, 0 };
 	mutable QImage _maskImage, _colorizedImage;
 	mutable QPixmap _pixmap; // for pixmaps
+	mutable uint32 _pixmapColorKey = 0;
 	mutable QSize _size; // for rects
 
 };
@@ -605,7 +605,7 @@ public:
 		lastSkipped = false;
 		checkTilde = (_t->_st->font->size() * cIntRetinaFactor() == 13)
 			&& (_t->_st->font->flags() == 0)
-			&& (_t->_st->font->f.family() == qstr("Open Sans")); // tilde Open Sans fix
+			&& (_t->_st->font->threadFont().family() == qstr("Open Sans")); // tilde Open Sans fix
 		for (; ptr <= end; ++ptr) {
 			while (checkEntities() || (rich && checkCommand())) {
 			}
@@ -2502,7 +2502,8 @@ Text::Text(Text &&other)
 , _st(other._st)
 , _blocks(std::move(other._blocks))
 , _links(other._links)
-, _startDir(other._startDir) {
+, _startDir(other._startDir)
+, _layoutCache(std::move(other._layoutCache)) {
 	other.clearFields();
 }
 
@@ -2515,6 +2516,7 @@ Text &Text::operator=(const Text &other) {
 	_blocks = TextBlocks(other._blocks.size());
 	_links = other._links;
 	_startDir = other._startDir;
+	_layoutCache = nullptr;
 	for (int32 i = 0, l = _blocks.size(); i < l; ++i) {
 		_blocks[i] = other._blocks.at(i)->clone();
 	}
@@ -2530,6 +2532,7 @@ Text &Text::operator=(Text &&other) {
 	_blocks = std::move(other._blocks);
 	_links = other._links;
 	_startDir = other._startDir;
+	_layoutCache = std::move(other._layoutCache);
 	other.clearFields();
 	return *this;
 }
@@ -2546,6 +2549,8 @@ void Text::setText(const style::TextStyle &st, const QString &text, const TextPa
 void Text::recountNaturalSize(bool initial, Qt::LayoutDirection optionsDir) {
 	NewlineBlock *lastNewline = 0;
 
+	_layoutCache = nullptr;
+
 	_maxWidth = _minHeight = 0;
 	int32 lineHeight = 0;
 	int32 result = 0, lastNewlineStart = 0;
@@ -2779,11 +2784,11 @@ int Text::countWidth(int width) const {
 	}
 
 	QFixed maxLineWidth = 0;
-	enumerateLines(width, [&maxLineWidth](QFixed lineWidth, int lineHeight) {
-		if (lineWidth > maxLineWidth) {
-			maxLineWidth = lineWidth;
+	for (const auto &line : layoutLines(width)) {
+		if (line.width > maxLineWidth) {
+			maxLineWidth = line.width;
 		}
-	});
+	}
 	return maxLineWidth.ceil().toInt();
 }
 
@@ -2792,25 +2797,46 @@ int Text::countHeight(int width) const {
 		return _minHeight;
 	}
 	int result = 0;
-	enumerateLines(width, [&result](QFixed lineWidth, int lineHeight) {
-		result += lineHeight;
-	});
+	for (const auto &line : layoutLines(width)) {
+		result += line.height;
+	}
 	return result;
 }
 
 void Text::countLineWidths(int width, QVector<int> *lineWidths) const {
-	enumerateLines(width, [lineWidths](QFixed lineWidth, int lineHeight) {
-		lineWidths->push_back(lineWidth.ceil().toInt());
-	});
+	for (const auto &line : layoutLines(width)) {
+		lineWidths->push_back(line.width.ceil().toInt());
+	}
 }
 
-template <typename Callback>
-void Text::enumerateLines(int w, Callback callback) const {
+const std::vector<Text::LayoutLine> &Text::layoutLines(int w) const {
 	QFixed width = w;
 	if (width < _minResizeWidth) width = _minResizeWidth;
 
+	// While all the words that fit in width still fit and all the words
+	// that didn't fit still don't fit the greedy line breaking is the same.
+	if (_layoutCache
+		&& width >= _layoutCache->minWidth
+		&& width <= _layoutCache->maxWidth) {
+		return _layoutCache->lines;
+	}
+	if (!_layoutCache) {
+		_layoutCache = std::make_unique<LayoutCache>();
+	}
+	auto &lines = _layoutCache->lines;
+	lines.clear();
+	_layoutCache->minWidth = enumerateLines(width, [&lines](QFixed lineWidth, int lineHeight) {
+		lines.push_back({ lineWidth, lineHeight });
+	});
+	_layoutCache->maxWidth = width;
+	return lines;
+}
+
+template <typename Callback>
+QFixed Text::enumerateLines(QFixed width, Callback callback) const {
 	int lineHeight = 0;
 	QFixed widthLeft = width, last_rBearing = 0, last_rPadding = 0;
+	QFixed minWidthLeft = width;
 	bool longWordLine = true;
 	for (auto &b : _blocks) {
 		auto _btype = b->type();
@@ -2834,6 +2860,7 @@ void Text::enumerateLines(int w, Callback callback) const {
 			last_rBearing = b__f_rbearing;
 			last_rPadding = b->f_rpadding();
 			widthLeft = newWidthLeft;
+			accumulate_min(minWidthLeft, widthLeft);
 
 			lineHeight = qMax(lineHeight, blockHeight);
 
@@ -2863,6 +2890,7 @@ void Text::enumerateLines(int w, Callback callback) const {
 					last_rBearing = j->f_rbearing();
 					last_rPadding = j->f_rpadding();
 					widthLeft = newWidthLeft;
+					accumulate_min(minWidthLeft, widthLeft);
 
 					lineHeight = qMax(lineHeight, blockHeight);
 
@@ -2912,6 +2940,7 @@ void Text::enumerateLines(int w, Callback callback) const {
 	if (widthLeft < width) {
 		callback(width - widthLeft, lineHeight);
 	}
+	return width - minWidthLeft;
 }
 
 void Text::draw(Painter &painter, int32 left, int32 top, int32 w, style::align align, int32 yFrom, int32 yTo, TextSelection selection, bool fullWidthSelection) const {
@@ -3131,6 +3160,7 @@ void Text::clearFields() {
 	_links.clear();
 	_maxWidth = _minHeight = 0;
 	_startDir = Qt::LayoutDirectionAuto;
+	_layoutCache = nullptr;
 }
 
 Text::~Text() = default;
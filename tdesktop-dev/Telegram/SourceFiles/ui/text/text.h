@@ -204,11 +204,26 @@ private:
 	template <typename AppendPartCallback, typename ClickHandlerStartCallback, typename ClickHandlerFinishCallback, typename FlagsChangeCallback>
 	void enumerateText(TextSelection selection, AppendPartCallback appendPartCallback, ClickHandlerStartCallback clickHandlerStartCallback, ClickHandlerFinishCallback clickHandlerFinishCallback, FlagsChangeCallback flagsChangeCallback) const;
 
-	// Template method for countWidth(), countHeight(), countLineWidths().
+	// Line breaks of the last layout, reused while the width changes
+	// in the range where the greedy line breaking gives the same result.
+	struct LayoutLine {
+		QFixed width;
+		int height = 0;
+	};
+	struct LayoutCache {
+		QFixed minWidth;
+		QFixed maxWidth;
+		std::vector<LayoutLine> lines;
+	};
+
+	// Returns the cached lines for countWidth(), countHeight(), countLineWidths().
+	const std::vector<LayoutLine> &layoutLines(int w) const;
+
 	// callback(lineWidth, lineHeight) will be called for all lines with:
 	// QFixed lineWidth, int lineHeight
+	// Returns the minimal width that gives the same line breaks.
 	template <typename Callback>
-	void enumerateLines(int w, Callback callback) const;
+	QFixed enumerateLines(QFixed width, Callback callback) const;
 
 	void recountNaturalSize(bool initial, Qt::LayoutDirection optionsDir = Qt::LayoutDirectionAuto);
 
@@ -228,6 +243,8 @@ private:
 
 	Qt::LayoutDirection _startDir = Qt::LayoutDirectionAuto;
 
+	mutable std::unique_ptr<LayoutCache> _layoutCache;
+
 	friend class TextParser;
 	friend class TextPainter;
 
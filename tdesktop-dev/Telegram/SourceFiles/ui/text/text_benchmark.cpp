@@ -0,0 +1,106 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/text/text_benchmark.h"
+
+#include "ui/text/text.h"
+#include "styles/style_basic.h"
+
+#include <random>
+
+namespace Ui {
+namespace {
+
+constexpr auto kMaxWidth = 640;
+constexpr auto kMinWidth = 240;
+constexpr auto kMaxWords = 120;
+
+QString GenerateMessage(std::mt19937 &generator) {
+	static const auto words = std::vector<QString>{
+		qsl("the"),
+		qsl("message"),
+		qsl("window"),
+		qsl("resize"),
+		qsl("layout"),
+		qsl("a"),
+		qsl("telegram"),
+		qsl("desktop"),
+		qsl("quick"),
+		qsl("https://telegram.org"),
+		qsl("supercalifragilisticexpialidocious"),
+		QString::fromUtf8("\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82"),
+	};
+	auto wordIndex = std::uniform_int_distribution<int>(
+		0,
+		int(words.size()) - 1);
+	auto wordsCount = std::uniform_int_distribution<int>(1, kMaxWords);
+	auto newline = std::uniform_int_distribution<int>(0, 15);
+
+	auto result = QString();
+	for (auto i = 0, count = wordsCount(generator); i != count; ++i) {
+		if (!result.isEmpty()) {
+			result.append(newline(generator) ? ' ' : '\n');
+		}
+		result.append(words[wordIndex(generator)]);
+	}
+	return result;
+}
+
+} // namespace
+
+QString BenchmarkTextResize(int count) {
+	auto generator = std::mt19937(count);
+	auto texts = std::vector<Text>();
+	texts.reserve(count);
+
+	const auto parseStart = getms(true);
+	for (auto i = 0; i != count; ++i) {
+		texts.emplace_back(
+			st::messageTextStyle,
+			GenerateMessage(generator),
+			_textPlainOptions);
+	}
+	const auto parsed = getms(true) - parseStart;
+
+	const auto layoutAll = [&](int width) {
+		auto result = int64(0);
+		for (const auto &text : texts) {
+			result += text.countHeight(width);
+		}
+		return result;
+	};
+
+	const auto firstStart = getms(true);
+	auto checksum = layoutAll(kMaxWidth);
+	const auto first = getms(true) - firstStart;
+
+	// Dragging the window edge gives many small width changes.
+	auto steps = 0;
+	const auto resizeStart = getms(true);
+	for (auto width = kMaxWidth; width >= kMinWidth; --width, ++steps) {
+		checksum += layoutAll(width);
+	}
+	for (auto width = kMinWidth; width <= kMaxWidth; ++width, ++steps) {
+		checksum += layoutAll(width);
+	}
+	const auto resize = getms(true) - resizeStart;
+
+	return qsl("Texts: %1\n"
+		"Parse: %2 ms\n"
+		"First layout: %3 ms\n"
+		"Resize, %4 steps: %5 ms (%6 ms per step)\n"
+		"Checksum: %7"
+		).arg(count
+		).arg(parsed
+		).arg(first
+		).arg(steps
+		).arg(resize
+		).arg(steps ? (double(resize) / steps) : 0.
+		).arg(checksum);
+}
+
+} // namespace Ui
@@ -0,0 +1,17 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Ui {
+
+// Lays out count message-like texts for a sequence of widths the way
+// the history does while the window is being resized by the user.
+// Returns a human readable report with the timings.
+QString BenchmarkTextResize(int count);
+
+} // namespace Ui
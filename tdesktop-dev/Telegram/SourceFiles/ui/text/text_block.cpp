@@ -327,13 +327,20 @@ TextBlock::TextBlock(const style::font &font, const QString &str, QFixed minResi
 
 		const auto part = str.mid(_from, length);
 
-		// Attempt to catch a crash in text processing
-		CrashReports::SetAnnotationRef("CrashString", &part);
+		// Attempt to catch a crash in text processing. The annotations
+		// are global, so text parsed in the worker threads is skipped.
+		const auto annotate = (QThread::currentThread()
+			== QCoreApplication::instance()->thread());
+		if (annotate) {
+			CrashReports::SetAnnotationRef("CrashString", &part);
+		}
 
-		QStackTextEngine engine(part, blockFont->f);
+		QStackTextEngine engine(part, blockFont->threadFont());
 		BlockParser parser(&engine, this, minResizeWidth, _from, part);
 
-		CrashReports::ClearAnnotationRef("CrashString");
+		if (annotate) {
+			CrashReports::ClearAnnotationRef("CrashString");
+		}
 	}
 }
 
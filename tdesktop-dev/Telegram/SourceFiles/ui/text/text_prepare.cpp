@@ -0,0 +1,77 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/text/text_prepare.h"
+
+#include <mutex>
+#include <condition_variable>
+
+namespace Ui {
+namespace {
+
+// Workers may start after the calling thread already took all the texts,
+// so the state is shared and outlives PrepareTexts() if needed.
+struct PrepareState {
+	explicit PrepareState(std::vector<TextPrepareRequest> &&requests)
+	: requests(std::move(requests)) {
+		results.reserve(this->requests.size());
+		for (const auto &request : this->requests) {
+			results.emplace_back(request.minResizeWidth);
+		}
+	}
+
+	void work() {
+		const auto count = int(requests.size());
+		for (auto index = next++; index < count; index = next++) {
+			const auto &request = requests[index];
+			results[index].setMarkedText(
+				*request.st,
+				request.text,
+				*request.options);
+			if (++done == count) {
+				std::unique_lock<std::mutex> lock(mutex);
+				finished.notify_all();
+			}
+		}
+	}
+
+	void wait() {
+		const auto count = int(requests.size());
+		std::unique_lock<std::mutex> lock(mutex);
+		while (done < count) {
+			finished.wait(lock);
+		}
+	}
+
+	std::vector<TextPrepareRequest> requests;
+	std::vector<Text> results;
+	std::atomic<int> next = 0;
+	std::atomic<int> done = 0;
+	std::mutex mutex;
+	std::condition_variable finished;
+
+};
+
+} // namespace
+
+std::vector<Text> PrepareTexts(std::vector<TextPrepareRequest> &&requests) {
+	const auto count = int(requests.size());
+	const auto state = std::make_shared<PrepareState>(std::move(requests));
+	const auto workers = std::min(
+		count - 1,
+		std::max(QThread::idealThreadCount() - 1, 0));
+	for (auto i = 0; i < workers; ++i) {
+		crl::async([=] {
+			state->work();
+		});
+	}
+	state->work();
+	state->wait();
+	return std::move(state->results);
+}
+
+} // namespace Ui
@@ -0,0 +1,23 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Ui {
+
+struct TextPrepareRequest {
+	not_null<const style::TextStyle*> st;
+	TextWithEntities text;
+	not_null<const TextParseOptions*> options;
+	int minResizeWidth = QFIXED_MAX;
+};
+
+// Parses the texts in the background threads. The calling thread takes
+// the remaining texts itself and returns when all of them are parsed.
+std::vector<Text> PrepareTexts(std::vector<TextPrepareRequest> &&requests);
+
+} // namespace Ui
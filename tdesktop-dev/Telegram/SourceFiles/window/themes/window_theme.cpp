@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/localstorage.h"
 #include "base/parse_helper.h"
 #include "base/zlib_help.h"
+#include "base/binary_guard.h"
 #include "styles/style_widgets.h"
 #include "styles/style_history.h"
 #include "boxes/background_box.h"
@@ -25,6 +26,7 @@ constexpr auto kThemeBackgroundSizeLimit = 4 * 1024 * 1024;
 constexpr auto kBackgroundSizeLimit = 25 * 1024 * 1024;
 constexpr auto kThemeSchemeSizeLimit = 1024 * 1024;
 constexpr auto kMinimumTiledSize = 512;
+constexpr auto kAveragePixelsChunk = 1 << 16;
 constexpr auto kNightThemeFile = str_const(":/gui/night.tdesktop-theme");
 
 struct Data {
@@ -39,6 +41,11 @@ struct Data {
 
 	ChatBackground background;
 	Applying applying;
+
+	// Night mode switch loads the theme in the background.
+	base::binary_guard loading;
+	bool loadingNightMode = false;
+	bool keepWhenLoaded = false;
 };
 NeverFreedPointer<Data> instance;
 
@@ -192,14 +199,21 @@ bool loadColorScheme(const QByteArray &content, Instance *out) {
 
 void applyBackground(QImage &&background, bool tiled, Instance *out) {
 	if (out) {
-		out->background = std::move(background);
+		// Convert it here, so that it is not done when it is shown.
+		out->background = std::move(background).convertToFormat(
+			QImage::Format_ARGB32_Premultiplied);
 		out->tiled = tiled;
 	} else {
 		Background()->setThemeData(std::move(background), tiled);
 	}
 }
 
-bool loadThemeFromCache(const QByteArray &content, const Cached &cache) {
+// The cached colors are applied in the palette order, without any lookups
+// by the color names, so it is preferred to parsing the theme content.
+bool loadThemeFromCache(
+		const QByteArray &content,
+		const Cached &cache,
+		Instance *out = nullptr) {
 	if (cache.paletteChecksum != style::palette::Checksum()) {
 		return false;
 	}
@@ -219,12 +233,17 @@ bool loadThemeFromCache(const QByteArray &content, const Cached &cache) {
 		}
 	}
 
-	if (!style::main_palette::load(cache.colors)) {
+	if (out) {
+		if (!out->palette.load(cache.colors)) {
+			return false;
+		}
+	} else if (!style::main_palette::load(cache.colors)) {
 		return false;
+	} else {
+		Background()->saveAdjustableColors();
 	}
-	Background()->saveAdjustableColors();
 	if (!background.isNull()) {
-		applyBackground(std::move(background), cache.tiled, nullptr);
+		applyBackground(std::move(background), cache.tiled, out);
 	}
 
 	return true;
@@ -264,6 +283,8 @@ bool loadBackground(zlib::FileToRead &file, QByteArray *outBackground, bool *out
 	return true;
 }
 
+// With the out instance it doesn't touch the main palette,
+// so it can be called from any thread.
 bool loadTheme(const QByteArray &content, Cached &cache, Instance *out = nullptr) {
 	cache = Cached();
 	zlib::FileToRead file(content);
@@ -283,7 +304,9 @@ bool loadTheme(const QByteArray &content, Cached &cache, Instance *out = nullptr
 		if (!loadColorScheme(schemeContent, out)) {
 			return false;
 		}
-		Background()->saveAdjustableColors();
+		if (!out) {
+			Background()->saveAdjustableColors();
+		}
 
 		auto backgroundTiled = false;
 		auto backgroundContent = QByteArray();
@@ -319,7 +342,9 @@ bool loadTheme(const QByteArray &content, Cached &cache, Instance *out = nullptr
 		if (!loadColorScheme(content, out)) {
 			return false;
 		}
-		Background()->saveAdjustableColors();
+		if (!out) {
+			Background()->saveAdjustableColors();
+		}
 	}
 	if (out) {
 		cache.colors = out->palette.save();
@@ -332,6 +357,26 @@ bool loadTheme(const QByteArray &content, Cached &cache, Instance *out = nullptr
 	return true;
 }
 
+std::unique_ptr<Preview> PreviewFromSaved(Saved &&saved) {
+	auto result = std::make_unique<Preview>();
+	result->pathAbsolute = std::move(saved.pathAbsolute);
+	result->pathRelative = std::move(saved.pathRelative);
+	result->content = std::move(saved.content);
+	result->instance.cached = std::move(saved.cache);
+	const auto loaded = loadThemeFromCache(
+		result->content,
+		result->instance.cached,
+		&result->instance)
+		|| loadTheme(
+			result->content,
+			result->instance.cached,
+			&result->instance);
+	if (!loaded) {
+		return nullptr;
+	}
+	return result;
+}
+
 QImage prepareBackgroundImage(QImage &&image) {
 	if (image.format() != QImage::Format_ARGB32 && image.format() != QImage::Format_ARGB32_Premultiplied && image.format() != QImage::Format_RGB32) {
 		image = std::move(image).convertToFormat(QImage::Format_RGB32);
@@ -340,6 +385,38 @@ QImage prepareBackgroundImage(QImage &&image) {
 	return std::move(image);
 }
 
+// Red and blue are summed in the two halves of one 64 bit value, so the
+// loop has no byte shuffling and can be vectorized by the compiler.
+// The sums are flushed in chunks before any of the halves can overflow.
+QColor CountAverageColor(const QImage &image) {
+	Expects(image.format() == QImage::Format_ARGB32_Premultiplied);
+
+	uint64 components[3] = { 0 };
+	const auto size = image.width() * image.height();
+	const auto pixels = reinterpret_cast<const uint32*>(image.constBits());
+	if (!size || !pixels) {
+		return QColor(0, 0, 0);
+	}
+	for (auto from = 0; from < size; from += kAveragePixelsChunk) {
+		const auto till = std::min(from + kAveragePixelsChunk, size);
+		auto redBlue = uint64(0);
+		auto green = uint64(0);
+		for (auto i = from; i != till; ++i) {
+			const auto pixel = pixels[i];
+			redBlue += (uint64(pixel & 0x00FF0000U) << 16)
+				| (pixel & 0x000000FFU);
+			green += (pixel & 0x0000FF00U);
+		}
+		components[0] += (redBlue >> 32);
+		components[1] += (green >> 8);
+		components[2] += (redBlue & 0xFFFFFFFFULL);
+	}
+	for (auto i = 0; i != 3; ++i) {
+		components[i] /= size;
+	}
+	return QColor(components[0], components[1], components[2]);
+}
+
 void adjustColor(style::color color, float64 hue, float64 saturation) {
 	auto original = color->c;
 	original.setHslF(hue, saturation, original.lightnessF(), original.alphaF());
@@ -501,26 +578,7 @@ void ChatBackground::setPreparedImage(QImage &&image) {
 void ChatBackground::adjustPaletteUsingBackground(const QImage &img) {
 	Assert(img.format() == QImage::Format_ARGB32_Premultiplied);
 
-	uint64 components[3] = { 0 };
-	uint64 componentsScroll[3] = { 0 };
-	auto w = img.width();
-	auto h = img.height();
-	auto size = w * h;
-	if (auto pix = img.constBits()) {
-		for (auto i = 0, l = size * 4; i != l; i += 4) {
-			components[2] += pix[i + 0];
-			components[1] += pix[i + 1];
-			components[0] += pix[i + 2];
-		}
-	}
-
-	if (size) {
-		for (auto i = 0; i != 3; ++i) {
-			components[i] /= size;
-		}
-	}
-
-	auto bgColor = QColor(components[0], components[1], components[2]);
+	auto bgColor = CountAverageColor(img);
 	auto hue = bgColor.hslHueF();
 	auto saturation = bgColor.hslSaturationF();
 	for (const auto &color : _adjustableColors) {
@@ -755,39 +813,89 @@ bool ChatBackground::nightMode() const {
 
 void ChatBackground::toggleNightMode(std::optional<QString> themePath) {
 	const auto settingDefault = themePath.has_value();
+	if (instance->loading.alive() && !settingDefault) {
+		// Toggled back before the loaded theme was applied,
+		// so the current mode is kept and the loading is cancelled.
+		instance->loading.kill();
+		instance->keepWhenLoaded = false;
+		return;
+	}
 	const auto oldNightMode = _nightMode;
 	const auto newNightMode = !_nightMode;
 	_nightMode = newNightMode;
 	auto read = settingDefault ? Saved() : Local::readThemeAfterSwitch();
-	auto path = read.pathAbsolute;
-
 	_nightMode = oldNightMode;
-	auto oldTileValue = (_nightMode ? _tileNightValue : _tileDayValue);
-	const auto alreadyOnDisk = [&] {
-		if (read.content.isEmpty()) {
-			return false;
+
+	const auto defaultPath = themePath
+		? *themePath
+		: (newNightMode ? NightThemePath() : QString());
+	if (read.content.isEmpty() && defaultPath.isEmpty()) {
+		const auto oldTileValue = tile();
+		instance->loading.kill();
+		instance->keepWhenLoaded = false;
+		ApplyDefaultWithPath(defaultPath);
+		finishToggleNightMode(
+			defaultPath,
+			false,
+			settingDefault,
+			oldTileValue);
+		return;
+	}
+
+	// Unpacking the theme and decoding its background takes a while,
+	// so it is done in the background and applied all at once later.
+	auto [left, right] = base::make_binary_guard();
+	instance->loading = std::move(left);
+	instance->loadingNightMode = newNightMode;
+	instance->keepWhenLoaded = false;
+	crl::async([
+		=,
+		read = std::move(read),
+		guard = std::move(right)
+	]() mutable {
+		const auto savedPath = read.pathAbsolute;
+		auto preview = std::unique_ptr<Preview>();
+		if (!read.content.isEmpty()) {
+			preview = PreviewFromSaved(std::move(read));
 		}
-		auto preview = std::make_unique<Preview>();
-		preview->pathAbsolute = std::move(read.pathAbsolute);
-		preview->pathRelative = std::move(read.pathRelative);
-		preview->content = std::move(read.content);
-		preview->instance.cached = std::move(read.cache);
-		const auto loaded = loadTheme(
-			preview->content,
-			preview->instance.cached,
-			&preview->instance);
-		if (!loaded) {
-			return false;
+		const auto alreadyOnDisk = (preview != nullptr);
+		if (!alreadyOnDisk && !defaultPath.isEmpty()) {
+			preview = PreviewFromFile(defaultPath);
 		}
-		Apply(std::move(preview));
-		return true;
-	}();
-	if (!alreadyOnDisk) {
-		path = themePath
-			? *themePath
-			: (newNightMode ? NightThemePath() : QString());
-		ApplyDefaultWithPath(path);
-	}
+		crl::on_main([
+			=,
+			preview = std::move(preview),
+			guard = std::move(guard)
+		]() mutable {
+			if (!guard.alive()) {
+				return;
+			}
+			guard.kill();
+			const auto oldTileValue = tile();
+			if (preview) {
+				Apply(std::move(preview));
+			} else if (defaultPath.isEmpty()) {
+				ApplyDefaultWithPath(defaultPath);
+			}
+			finishToggleNightMode(
+				alreadyOnDisk ? savedPath : defaultPath,
+				alreadyOnDisk,
+				settingDefault,
+				oldTileValue);
+			if (base::take(instance->keepWhenLoaded)) {
+				KeepApplied();
+			}
+		});
+	});
+}
+
+void ChatBackground::finishToggleNightMode(
+		const QString &path,
+		bool alreadyOnDisk,
+		bool settingDefault,
+		bool oldTileValue) {
+	const auto oldNightMode = _nightMode;
+	const auto newNightMode = !_nightMode;
 
 	// Theme editor could have already reverted the testing of this toggle.
 	if (AreTestingTheme()) {
@@ -854,6 +962,7 @@ bool Apply(const QString &filepath) {
 
 bool Apply(std::unique_ptr<Preview> preview) {
 	instance.createIfNull();
+	instance->loading.kill();
 	instance->applying.pathRelative = std::move(preview->pathRelative);
 	instance->applying.pathAbsolute = std::move(preview->pathAbsolute);
 	instance->applying.content = std::move(preview->content);
@@ -872,6 +981,7 @@ void ApplyDefaultWithPath(const QString &themePath) {
 		}
 	} else {
 		instance.createIfNull();
+		instance->loading.kill();
 		instance->applying.pathRelative = QString();
 		instance->applying.pathAbsolute = QString();
 		instance->applying.content = QByteArray();
@@ -910,7 +1020,11 @@ bool ApplyEditedPalette(const QString &path, const QByteArray &content) {
 }
 
 void KeepApplied() {
-	if (!AreTestingTheme()) {
+	if (instance && instance->loading.alive()) {
+		// The night mode theme is still loading, keep it when it is applied.
+		instance->keepWhenLoaded = true;
+		return;
+	} else if (!AreTestingTheme()) {
 		return;
 	} else if (instance->applying.overrideKeep) {
 		// This callback will be destroyed while running.
@@ -949,6 +1063,13 @@ bool IsNightMode() {
 	return instance ? Background()->nightMode() : false;
 }
 
+bool IsNightModeTarget() {
+	if (instance && instance->loading.alive()) {
+		return instance->loadingNightMode;
+	}
+	return IsNightMode();
+}
+
 void SetNightModeValue(bool nightMode) {
 	if (instance || nightMode) {
 		Background()->setNightModeValue(nightMode);
@@ -61,6 +61,9 @@ bool ApplyEditedPalette(const QString &path, const QByteArray &content);
 void KeepApplied();
 QString NightThemePath();
 bool IsNightMode();
+
+// While the night mode switch is loading the theme it returns the new mode.
+bool IsNightModeTarget();
 void SetNightModeValue(bool nightMode);
 void ToggleNightMode();
 void ToggleNightMode(const QString &themePath);
@@ -141,6 +144,11 @@ private:
 	void setNightModeValue(bool nightMode);
 	bool nightMode() const;
 	void toggleNightMode(std::optional<QString> themePath);
+	void finishToggleNightMode(
+		const QString &path,
+		bool alreadyOnDisk,
+		bool settingDefault,
+		bool oldTileValue);
 	void keepApplied(const QString &path, bool write);
 	bool isNonDefaultThemeOrBackground();
 	bool isNonDefaultBackground();
@@ -138,7 +138,7 @@ MainMenu::MainMenu(
 
 	_nightThemeSwitch.setCallback([this] {
 		if (const auto action = *_nightThemeAction) {
-			const auto nightMode = Window::Theme::IsNightMode();
+			const auto nightMode = Window::Theme::IsNightModeTarget();
 			if (action->isChecked() != nightMode) {
 				Window::Theme::ToggleNightMode();
 				Window::Theme::KeepApplied();
@@ -228,7 +228,7 @@ void MainMenu::refreshMenu() {
 	}, &st::mainMenuNightMode, &st::mainMenuNightModeOver);
 	*_nightThemeAction = action;
 	action->setCheckable(true);
-	action->setChecked(Window::Theme::IsNightMode());
+	action->setChecked(Window::Theme::IsNightModeTarget());
 	_menu->finishAnimating();
 
 	updatePhone();
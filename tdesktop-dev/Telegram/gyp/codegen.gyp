@@ -152,5 +152,23 @@
       '<(src_loc)/codegen/emoji/replaces.cpp',
       '<(src_loc)/codegen/emoji/replaces.h',
     ],
+  }, {
+    'target_name': 'trace_decoder',
+    'variables': {
+      'src_loc': '../SourceFiles',
+      'mac_target': '10.10',
+    },
+    'includes': [
+      'common_executable.gypi',
+      'qt.gypi',
+    ],
+
+    'include_dirs': [
+      '<(src_loc)',
+    ],
+    'sources': [
+      '<(src_loc)/_other/trace_decoder.cpp',
+      '<(src_loc)/mtproto/mtp_trace_format.h',
+    ],
   }],
 }
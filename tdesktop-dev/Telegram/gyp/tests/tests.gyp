@@ -52,6 +52,27 @@
       '<(src_loc)/base/algorithm.h',
       '<(src_loc)/base/algorithm_tests.cpp',
     ],
+  }, {
+    'target_name': 'tests_audio_kernels',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/media/media_audio_kernels.cpp',
+      '<(src_loc)/media/media_audio_kernels.h',
+      '<(src_loc)/media/media_audio_kernels_tests.cpp',
+      '<(src_loc)/media/media_audio_queue.h',
+    ],
+  }, {
+    'target_name': 'tests_export_incremental',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/export/export_incremental.cpp',
+      '<(src_loc)/export/export_incremental.h',
+      '<(src_loc)/export/export_incremental_tests.cpp',
+    ],
   }, {
     'target_name': 'tests_flags',
     'includes': [
@@ -79,6 +100,16 @@
       '<(src_loc)/base/flat_set.h',
       '<(src_loc)/base/flat_set_tests.cpp',
     ],
+  }, {
+    'target_name': 'tests_image_prepare',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/ui/image/image_prepare_kernels.cpp',
+      '<(src_loc)/ui/image/image_prepare_kernels.h',
+      '<(src_loc)/ui/image/image_prepare_kernels_tests.cpp',
+    ],
   }, {
     'target_name': 'tests_rpl',
     'includes': [
@@ -117,6 +148,28 @@
       '<(src_loc)/rpl/variable.h',
       '<(src_loc)/rpl/variable_tests.cpp',
     ],
+  }, {
+    'target_name': 'tests_serialize',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/storage/serialize_stream.cpp',
+      '<(src_loc)/storage/serialize_stream.h',
+      '<(src_loc)/storage/serialize_stream_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_streaming',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/media/streaming/media_streaming_loader.cpp',
+      '<(src_loc)/media/streaming/media_streaming_loader.h',
+      '<(src_loc)/media/streaming/media_streaming_reader.cpp',
+      '<(src_loc)/media/streaming/media_streaming_reader.h',
+      '<(src_loc)/media/streaming/media_streaming_reader_tests.cpp',
+    ],
   }, {
     'target_name': 'tests_storage',
     'includes': [
@@ -128,6 +181,8 @@
     ],
     'sources': [
       '<(src_loc)/storage/storage_encrypted_file_tests.cpp',
+      '<(src_loc)/storage/storage_journal_tests.cpp',
+      '<(src_loc)/storage/storage_test_keys.h',
       '<(src_loc)/storage/cache/storage_cache_database_tests.cpp',
       '<(src_loc)/platform/win/windows_dlls.cpp',
       '<(src_loc)/platform/win/windows_dlls.h',